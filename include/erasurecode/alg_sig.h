@@ -26,6 +26,7 @@
 #define _ALG_SIG_H
 
 #include <stddef.h>
+#include <stdint.h>
 typedef int (*galois_single_multiply_func)(int, int, int);
 typedef void (*galois_uninit_field_func)(int);
 
@@ -57,6 +58,11 @@ alg_sig_t *init_alg_sig(int sig_len, int gf_w);
 void destroy_alg_sig(alg_sig_t *alg_sig_handle);
 
 int compute_alg_sig(alg_sig_t *alg_sig_handle, char *buf, int len, char *sig);
+int liberasurecode_crc32(int crc, const void *buf, size_t size);
 int liberasurecode_crc32_alt(int crc, const void *buf, size_t size);
+uint32_t crc32_trim_zeros(uint32_t crc, uint64_t len);
+uint32_t liberasurecode_crc32c(uint32_t crc, const void *buf, size_t size);
+uint64_t liberasurecode_xxh64(uint64_t seed, const void *buf, size_t size);
+void liberasurecode_md5(const void *buf, size_t size, unsigned char *digest);
 
 #endif
@@ -31,9 +31,13 @@
 
 #include "erasurecode_stdinc.h"
 #include "erasurecode_version.h"
+#include <sys/uio.h>
 
 #define EC_MAX_FRAGMENTS 256
 
+/* Required alignment of caller-supplied fragment buffers */
+#define LIBERASURECODE_FRAGMENT_ALIGNMENT 16
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -62,9 +66,52 @@ typedef enum {
     CHKSUM_NONE = 1,
     CHKSUM_CRC32 = 2,
     CHKSUM_MD5 = 3,
+    CHKSUM_CRC32C = 4, /* Castagnoli CRC32, in chksum[0] */
+    CHKSUM_XXH64 = 5, /* xxHash64, low word in chksum[0], high in chksum[1] */
     CHKSUM_TYPES_MAX,
 } ec_checksum_type_t;
 
+/* =~=*=~==~=*=~==~=*=~==~= EC instance options =~=*=~==~=*=~==~=*=~==~=*=~== */
+
+/**
+ * Frontend options that may be changed on a live instance
+ * with liberasurecode_instance_set_option()
+ */
+typedef enum {
+    EC_OPT_SLAB_ALLOC = 0, /* allocate all fragments of one encode in a
+                            * single slab (0 = off, default) */
+    EC_OPT_BUFFER_POOL, /* keep up to this many released fragment buffers
+                         * per size class in a per-thread pool for reuse
+                         * (0 = off, default); the calling thread's pool
+                         * is freed once no instance uses it */
+    EC_OPT_WORKER_THREADS, /* split batched reconstructs, and the encode of
+                            * large fragments column-wise, across up to
+                            * this many threads (0 = calling thread only,
+                            * default) */
+    EC_OPTS_MAX,
+} ec_instance_option_t;
+
+/**
+ * Fragment buffer pool statistics, see EC_OPT_BUFFER_POOL
+ */
+struct ec_buffer_pool_stats {
+    uint64_t hits; /* allocations served from a pool */
+    uint64_t misses; /* allocations that had to go to malloc */
+    uint64_t recycled; /* releases kept in a pool */
+    uint64_t released; /* releases handed back to free, pool full */
+};
+
+/**
+ * Statistics of a backend's cache of decode and reconstruct tables (ISA-L
+ * backends keep the tables for recently seen erasure patterns, see
+ * liberasurecode_get_table_cache_stats())
+ */
+struct ec_table_cache_stats {
+    uint64_t hits; /* decodes/reconstructs that reused cached tables */
+    uint64_t misses; /* decodes/reconstructs that had to build them */
+    uint64_t evictions; /* cached tables dropped to make room */
+};
+
 /* =~=*=~==~=*=~== EC Arguments - Common and backend-specific =~=*=~==~=*=~== */
 
 /**
@@ -138,6 +185,50 @@ int liberasurecode_instance_create(const ec_backend_id_t id, struct ec_args *arg
  */
 int liberasurecode_instance_destroy(int desc);
 
+/**
+ * Set a frontend option on a liberasurecode instance
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param opt - one of the options defined by ec_instance_option_t
+ * @param value - new value for the option
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_instance_set_option(int desc, ec_instance_option_t opt, int value);
+
+/**
+ * Get the fragment buffer pool statistics, summed over all threads
+ *
+ * @param stats - _output_ pool statistics
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_get_buffer_pool_stats(struct ec_buffer_pool_stats *stats);
+
+/**
+ * Get the decode/reconstruct table cache statistics of a liberasurecode
+ * instance
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param stats - _output_ cache statistics
+ *
+ * @return 0 on success, -EBACKENDNOTSUPP if the backend keeps no such
+ *         cache, -error code otherwise
+ */
+int liberasurecode_get_table_cache_stats(int desc, struct ec_table_cache_stats *stats);
+
+/**
+ * Release all fragment buffers cached by the calling thread's pool
+ *
+ * Cached buffers are released automatically when a thread exits; this
+ * lets long-lived threads give the memory back earlier.
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_buffer_pool_flush(void);
+
 /**
  * Erasure encode a data buffer
  *
@@ -158,6 +249,197 @@ int liberasurecode_encode(int desc, const char *orig_data, uint64_t orig_data_si
     char ***encoded_data, char ***encoded_parity, /* output */
     uint64_t *fragment_len); /* output */
 
+/**
+ * Erasure encode data scattered over a list of segments
+ *
+ * Same as liberasurecode_encode(), but the data to encode is the
+ * concatenation of the iovcnt segments in iov.  Segments are copied straight
+ * into the data fragments, so they need not be coalesced first.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param iov - segments of data to encode, in order
+ * @param iovcnt - number of segments in iov
+ * @param encoded_data - pointer to _output_ array (char **) of k data
+ *        fragments (char *), allocated by the callee
+ * @param encoded_parity - pointer to _output_ array (char **) of m parity
+ *        fragments (char *), allocated by the callee
+ * @param fragment_len - pointer to _output_ length of each fragment, assuming
+ *        all fragments are the same length
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_iov(int desc, const struct iovec *iov, int iovcnt, /* input */
+    char ***encoded_data, char ***encoded_parity, /* output */
+    uint64_t *fragment_len); /* output */
+
+/**
+ * Result of encoding one object with liberasurecode_encode_batch()
+ */
+struct ec_encode_output {
+    char **encoded_data; /* array of k data fragments */
+    char **encoded_parity; /* array of m parity fragments */
+    uint64_t fragment_len; /* length of each fragment */
+};
+
+/**
+ * Erasure encode a batch of data buffers
+ *
+ * Equivalent to calling liberasurecode_encode() on each buffer, but the
+ * instance is looked up and the arguments validated only once, and the
+ * fragments of each object are allocated as one block unless the buffer
+ * pool is enabled. Either all objects are encoded or, on error, none.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param objs - array of n data buffers to encode
+ * @param lens - array of n data buffer lengths
+ * @param n - number of data buffers
+ * @param outputs - _output_ array of n encode results; release each with
+ *        liberasurecode_encode_cleanup()
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_batch(int desc, const char **objs, const uint64_t *lens, /* input */
+    int n, /* input */
+    struct ec_encode_output *outputs); /* output */
+
+/* =~=*=~==~=*=~==~=*=~==~=*=~= streaming encode =~=*=~==~=*=~==~=*=~==~=*=~= */
+
+/**
+ * A streaming encoder splits an object of unknown length into segments
+ * of a fixed size and encodes each one as soon as it is complete, so only
+ * one segment is ever buffered.  Each segment is an independent stripe:
+ * its fragments decode with liberasurecode_decode() on their own.
+ */
+typedef struct ec_stream_encoder ec_stream_encoder_t;
+
+/**
+ * Called with the fragments of each encoded segment, in index order (k
+ * data then m parity).  The fragments are only valid during the call.
+ * A non-zero return aborts the stream and is passed back to the caller
+ * of ec_stream_encoder_feed() / ec_stream_encoder_finish().
+ */
+typedef int (*ec_stream_emit_fn)(
+    void *ctx, char **fragments, int num_fragments, uint64_t fragment_len);
+
+/**
+ * Create a streaming encoder
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param segment_size - number of input bytes encoded together; all but
+ *        the last segment produce fragments of the same length
+ * @param emit - callback receiving the fragments of each segment
+ * @param ctx - opaque pointer passed to emit
+ * @param encoder - _output_ new streaming encoder
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int ec_stream_encoder_create(int desc, uint64_t segment_size, ec_stream_emit_fn emit, void *ctx,
+    ec_stream_encoder_t **encoder);
+
+/**
+ * Feed the next bytes of the object to a streaming encoder; writes may
+ * have any size
+ *
+ * @param encoder - streaming encoder from ec_stream_encoder_create()
+ * @param data - next bytes of the object
+ * @param len - number of bytes in data
+ *
+ * @return 0 on success, -error code or the emit callback's non-zero
+ *         return otherwise
+ */
+int ec_stream_encoder_feed(ec_stream_encoder_t *encoder, const char *data, uint64_t len);
+
+/**
+ * Encode and emit the last, possibly short, segment and release the
+ * encoder (even on error)
+ *
+ * @param encoder - streaming encoder from ec_stream_encoder_create()
+ *
+ * @return 0 on success, -error code or the emit callback's non-zero
+ *         return otherwise
+ */
+int ec_stream_encoder_finish(ec_stream_encoder_t *encoder);
+
+/**
+ * Release a streaming encoder, dropping any data not yet emitted
+ *
+ * @param encoder - streaming encoder from ec_stream_encoder_create()
+ */
+void ec_stream_encoder_destroy(ec_stream_encoder_t *encoder);
+
+/* =~=*=~==~=*=~==~=*=~==~=*=~= streaming decode =~=*=~==~=*=~==~=*=~==~=*=~= */
+
+/**
+ * A streaming decoder reads the fragment streams written by a streaming
+ * encoder (one stream per fragment index, each a sequence of per-segment
+ * fragments) and hands out the object bytes one segment at a time, as
+ * soon as enough streams (k for MDS codes) have delivered their fragment
+ * of it.  At most one fragment per stream is buffered.
+ */
+typedef struct ec_stream_decoder ec_stream_decoder_t;
+
+/**
+ * Called with the next decoded bytes of the object; the data is only
+ * valid during the call.  A non-zero return aborts the stream and is
+ * passed back to the caller of ec_stream_decoder_feed().
+ */
+typedef int (*ec_stream_output_fn)(void *ctx, const char *data, uint64_t len);
+
+/**
+ * Create a streaming decoder
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param output - callback receiving the decoded object bytes in order
+ * @param ctx - opaque pointer passed to output
+ * @param decoder - _output_ new streaming decoder
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int ec_stream_decoder_create(
+    int desc, ec_stream_output_fn output, void *ctx, ec_stream_decoder_t **decoder);
+
+/**
+ * Feed the next bytes of one fragment stream to a streaming decoder
+ *
+ * A stream that runs ahead of the current segment is not buffered any
+ * further: fewer than 'len' bytes are consumed and the caller feeds the
+ * rest again once other streams have caught up.  Streams that fall
+ * behind have their fragments of already decoded segments skipped.
+ *
+ * @param decoder - streaming decoder from ec_stream_decoder_create()
+ * @param source - stream the bytes belong to, 0 <= source < k + m
+ * @param data - next bytes of that stream
+ * @param len - number of bytes in data
+ * @param consumed - _output_ number of bytes taken from data
+ *
+ * @return 0 on success, -error code or the output callback's non-zero
+ *         return otherwise
+ */
+int ec_stream_decoder_feed(ec_stream_decoder_t *decoder, int source, const char *data,
+    uint64_t len, uint64_t *consumed);
+
+/**
+ * Release a streaming decoder, checking that no segment was left
+ * incomplete
+ *
+ * @param decoder - streaming decoder from ec_stream_decoder_create()
+ *
+ * @return 0 on success, -EINSUFFFRAGS if the streams ended in the middle
+ *         of a segment, -error code otherwise
+ */
+int ec_stream_decoder_finish(ec_stream_decoder_t *decoder);
+
+/**
+ * Release a streaming decoder without any checks
+ *
+ * @param decoder - streaming decoder from ec_stream_decoder_create()
+ */
+void ec_stream_decoder_destroy(ec_stream_decoder_t *decoder);
+
 /**
  * Cleanup structures allocated by librasurecode_encode
  *
@@ -176,6 +458,43 @@ int liberasurecode_encode(int desc, const char *orig_data, uint64_t orig_data_si
  */
 int liberasurecode_encode_cleanup(int desc, char **encoded_data, char **encoded_parity);
 
+/**
+ * Compute the length of each fragment liberasurecode_encode_into() writes
+ * for a given data size.  This is the same fragment_len that
+ * liberasurecode_encode() reports.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param orig_data_size - length of data to encode
+ * @param fragment_len - pointer to _output_ length of each fragment, header
+ *        included
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_get_encoded_fragment_len(
+    int desc, uint64_t orig_data_size, uint64_t *fragment_len);
+
+/**
+ * Erasure encode a data buffer into caller-owned fragment buffers
+ *
+ * Same as liberasurecode_encode(), but headers and payloads are written
+ * directly into the buffers passed in, so nothing needs to be cleaned up
+ * afterwards.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param orig_data - data to encode
+ * @param orig_data_size - length of data to encode
+ * @param fragments - array of k + m _output_ buffers (k data followed by m
+ *        parity), each aligned to LIBERASURECODE_FRAGMENT_ALIGNMENT bytes
+ * @param fragment_len - size of each buffer in fragments, at least the
+ *        length returned by liberasurecode_get_encoded_fragment_len()
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_into(int desc, const char *orig_data, uint64_t orig_data_size, /* input */
+    char **fragments, uint64_t fragment_len); /* output */
+
 /**
  * Reconstruct original data from a set of k encoded fragments
  *
@@ -198,6 +517,88 @@ int liberasurecode_decode(int desc, char **available_fragments, /* input */
     int force_metadata_checks, /* input */
     char **out_data, uint64_t *out_data_len); /* output */
 
+/**
+ * Reconstruct original data from a set of k encoded fragments into a
+ * caller-owned buffer
+ *
+ * Behaves like liberasurecode_decode(), but writes the decoded data into
+ * 'out_buf' instead of allocating it, so no liberasurecode_decode_cleanup()
+ * call is needed.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param fragments - erasure encoded fragments (> = k)
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - length of each fragment (assume they are the same)
+ * @param force_metadata_checks - force fragment metadata checks (default: 0)
+ * @param out_buf - caller-owned buffer receiving the decoded data
+ * @param out_cap - size in bytes of 'out_buf'
+ * @param out_len - _output_ length of decoded output; if 'out_cap' is too
+ *          small this is set to the required size and -EINVALIDPARAMS is
+ *          returned
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_decode_into(int desc, char **available_fragments, /* input */
+    int num_fragments, uint64_t fragment_len, /* input */
+    int force_metadata_checks, /* input */
+    char *out_buf, uint64_t out_cap, /* output */
+    uint64_t *out_len); /* output */
+
+/**
+ * Describe the original data as segments of the data fragments (zero-copy)
+ *
+ * For systematic backends with all k data fragments available, fill 'iov'
+ * with pointer/length pairs referencing the payloads of the data fragments
+ * in index order, trimmed to the original data size, so that the data can
+ * be written out (e.g. with writev) without reassembling it first. The
+ * segments stay valid as long as 'available_fragments' do.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param fragments - erasure encoded fragments (> = k)
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - length of each fragment (assume they are the same)
+ * @param iov - _output_ segments referencing the data fragments
+ * @param iovcnt - number of entries in 'iov' (k always suffices);
+ *          _output_ number of entries used
+ * @param out_data_len - _output_ length of the original data
+ *
+ * @return 0 on success, -EINSUFFFRAGS if data fragments are missing,
+ *          -EBACKENDNOTSUPP for non-systematic backends (use
+ *          liberasurecode_decode() in both cases), -error code otherwise
+ */
+int liberasurecode_decode_iov(int desc, char **available_fragments, /* input */
+    int num_fragments, uint64_t fragment_len, /* input */
+    struct iovec *iov, int *iovcnt, /* output */
+    uint64_t *out_data_len); /* output */
+
+/**
+ * Compute the CRC-32 of the original data from the data fragment checksums
+ *
+ * For systematic backends with all k data fragments available, combine the
+ * CRC32 checksums stored in the data fragment headers into the CRC-32
+ * (as computed by zlib's crc32()) of the original data, trimmed to the
+ * original data size.  No payload is read, so the checksums are trusted
+ * as stored; use liberasurecode_get_fragment_metadata() to check them.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param fragments - erasure encoded fragments (> = k)
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - length of each fragment (assume they are the same)
+ * @param out_crc - _output_ CRC-32 of the original data
+ *
+ * @return 0 on success, -EBADCHKSUM if the data fragments were not
+ *          encoded with CHKSUM_CRC32 or were written with
+ *          LIBERASURECODE_WRITE_LEGACY_CRC set, -EINSUFFFRAGS if data
+ *          fragments are missing, -EBACKENDNOTSUPP for non-systematic
+ *          backends, -error code otherwise
+ */
+int liberasurecode_get_object_crc32(int desc, char **available_fragments, /* input */
+    int num_fragments, uint64_t fragment_len, /* input */
+    uint32_t *out_crc); /* output */
+
 /**
  * Cleanup structures allocated by librasurecode_decode
  *
@@ -231,6 +632,80 @@ int liberasurecode_reconstruct_fragment(int desc, char **available_fragments, /*
     int destination_idx, /* input */
     char *out_fragment); /* output */
 
+/**
+ * Reconstruct several missing fragments of a stripe at once, sharing the
+ * fragment preparation and, where the backend supports it, a single pass
+ * over the available fragments
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param available_fragments - erasure encoded fragments
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - size in bytes of the fragments
+ * @param destination_idxs - -1 terminated list of the idxs to reconstruct
+ * @param out_fragments - one output buffer of fragment_len bytes per
+ *        entry of destination_idxs
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_reconstruct_fragments(int desc, char **available_fragments, /* input */
+    int num_fragments, uint64_t fragment_len, /* input */
+    int *destination_idxs, /* input */
+    char **out_fragments); /* output */
+
+/**
+ * Reconstruct the same fragment of many stripes that all lost the same
+ * fragments, e.g. when rebuilding a disk
+ *
+ * Arguments are checked once for the whole batch, and backends that can
+ * share their reconstruct tables across stripes build them once.  The
+ * stripes are split across EC_OPT_WORKER_THREADS threads when that option
+ * is set and the batch is large enough.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param available_fragments - per stripe, an array of num_fragments
+ *        erasure encoded fragments; every stripe has to provide the same
+ *        fragment idxs
+ * @param num_stripes - number of stripes in the batch
+ * @param num_fragments - number of fragments passed in per stripe
+ * @param fragment_len - size in bytes of the fragments, the same for every
+ *        stripe
+ * @param destination_idx - missing idx to reconstruct in every stripe
+ * @param out_fragments - one output buffer of fragment_len bytes per stripe
+ *
+ * @return 0 on success, -error code otherwise, in which case the contents
+ *         of out_fragments are undefined
+ */
+int liberasurecode_reconstruct_fragment_batch(int desc, char ***available_fragments, /* input */
+    int num_stripes, int num_fragments, uint64_t fragment_len, /* input */
+    int destination_idx, /* input */
+    char **out_fragments); /* output */
+
+/**
+ * Bring the parity of a stripe up to date after one of its data fragments
+ * was overwritten, without reading the rest of the stripe
+ *
+ * The backend folds the difference between the old and the new data into
+ * each parity fragment in place; the headers and checksums of the parity
+ * fragments and of new_fragment are refreshed afterwards.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param data_idx - idx of the data fragment that changed
+ * @param old_fragment - the data fragment as it was
+ * @param new_fragment - the data fragment as it is now; only its payload
+ *        needs to be current, its header is rewritten from old_fragment's
+ * @param parity_fragments - the m parity fragments of the stripe, in idx
+ *        order, updated in place
+ *
+ * @return 0 on success, -EBACKENDNOTSUPP if the backend can not update
+ *         parity in place, -error code otherwise
+ */
+int liberasurecode_update_parity(int desc, int data_idx, char *old_fragment, /* input */
+    char *new_fragment, /* input/output */
+    char **parity_fragments); /* input/output */
+
 /**
  * Return a list of lists with valid rebuild indexes given
  * a list of missing indexes.
@@ -62,10 +62,19 @@ struct ec_backend_args {
 #define DECODE decode
 #define FRAGSNEEDED fragments_needed
 #define RECONSTRUCT reconstruct
+#define RECONSTRUCTMULTI reconstruct_multi
+#define RECONSTRUCTPREPARE reconstruct_prepare
+#define RECONSTRUCTPREPARED reconstruct_prepared
+#define RECONSTRUCTRELEASE reconstruct_release
+#define UPDATEPARITY update_parity
 #define CHECKRECONSTRUCTFRAGMENTS check_reconstruct_fragments
+#define GETTABLECACHESTATS get_table_cache_stats
 #define ELEMENTSIZE element_size
 #define ISCOMPATIBLEWITH is_compatible_with
 #define ISSYSTEMATIC is_systematic
+#define DECODESDATAONLY decodes_data_only
+#define ENCODESBYCOLUMN encodes_by_column
+#define CHKSUMSBYCHUNK chksums_by_chunk
 #define GETMETADATASIZE get_backend_metadata_size
 #define GETENCODEOFFSET get_encode_offset
 
@@ -85,6 +94,25 @@ struct ec_backend_op_stubs {
     /* Flag for quick-decode optimization */
     bool ISSYSTEMATIC;
 
+    /*
+     * Flag for backends whose DECODE only rebuilds missing data and leaves
+     * the buffers of missing parity alone; the frontend passes NULL for them
+     */
+    bool DECODESDATAONLY;
+
+    /*
+     * Flag for backends whose ENCODE computes every byte offset of the
+     * fragments on its own, so that column ranges can be encoded in parallel
+     */
+    bool ENCODESBYCOLUMN;
+
+    /*
+     * Flag for ENCODESBYCOLUMN backends whose ENCODE is cheap enough that,
+     * with fused checksums, encoding a chunk at a time and checksumming it
+     * while cache-hot beats one call followed by a checksum pass
+     */
+    bool CHKSUMSBYCHUNK;
+
     /* Backend stub declarations */
     int (*ENCODE)(void *desc, char **data, char **parity, int blocksize);
     int (*DECODE)(void *desc, char **data, char **parity, int *missing_idxs, int blocksize);
@@ -105,6 +133,40 @@ struct ec_backend_op_stubs {
      * default to checking for at least k fragments.
      */
     int (*CHECKRECONSTRUCTFRAGMENTS)(void *desc, int *missing_idxs, int destination_idx);
+
+    /**
+     * Optional function to report the statistics of the backend's decode
+     * and reconstruct table cache. If NULL, the backend keeps no such cache.
+     */
+    int (*GETTABLECACHESTATS)(void *desc, struct ec_table_cache_stats *stats);
+
+    /**
+     * Optional function to rebuild several missing fragments, listed in
+     * destination_idxs (-1 terminated, ascending), in one pass over the
+     * available ones. If NULL, RECONSTRUCT is called once per destination.
+     */
+    int (*RECONSTRUCTMULTI)(void *desc, char **data, char **parity, int *missing_idxs,
+        int *destination_idxs, int blocksize);
+
+    /**
+     * Optional functions to rebuild destination_idx in many stripes that
+     * all lost the fragments in missing_idxs.  RECONSTRUCTPREPARE builds
+     * the tables once (NULL on failure), RECONSTRUCTPREPARED applies them
+     * to one stripe and may run on several threads at once, and
+     * RECONSTRUCTRELEASE frees them.  If NULL, RECONSTRUCT is called once
+     * per stripe.
+     */
+    void *(*RECONSTRUCTPREPARE)(void *desc, int *missing_idxs, int destination_idx);
+    int (*RECONSTRUCTPREPARED)(void *desc, void *tables, char **data, char **parity, int blocksize);
+    void (*RECONSTRUCTRELEASE)(void *desc, void *tables);
+
+    /**
+     * Optional function to bring the parity up to date, in place, after the
+     * data fragment data_idx changed from old_data to new_data. If NULL,
+     * the stripe has to be encoded again.
+     */
+    int (*UPDATEPARITY)(
+        void *desc, int data_idx, char *old_data, char *new_data, char **parity, int blocksize);
 };
 
 /* ==~=*=~==~=*=~==~=*=~= backend struct definitions =~=*=~==~=*=~==~=*==~== */
@@ -136,9 +198,8 @@ typedef struct ec_backend {
     struct ec_backend_args args; /* EC backend instance data (private) */
 
     int idesc; /* liberasurecode instance handle */
+    int opts[EC_OPTS_MAX]; /* frontend options, see ec_instance_option_t */
     struct ec_backend_desc desc; /* EC backend instance handle */
-
-    SLIST_ENTRY(ec_backend) link;
 } *ec_backend_t;
 
 /* ~=*=~==~=*=~==~=*=~==~=*= frontend <-> backend API =*=~==~=*=~==~=*=~==~= */
@@ -147,10 +208,17 @@ typedef struct ec_backend {
  * Look up a backend instance by descriptor
  *
  * Returns pointer to a registered liberasurecode instance
- * The caller must hold active_instances_rwlock
+ * The caller must hold the instance registry lock
  */
 ec_backend_t liberasurecode_backend_instance_get_by_desc(int desc);
 
+/**
+ * Check fragment metadata against a backend instance
+ *
+ * Returns 0 if the fragment may belong to the instance, 1 otherwise
+ */
+int liberasurecode_verify_fragment_metadata(ec_backend_t be, fragment_metadata_t *md);
+
 /* Common function for backends */
 /**
  * A function to return 0 for generic usage on backends for get_encode_offset
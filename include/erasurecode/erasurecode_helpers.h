@@ -37,6 +37,11 @@
 
 #define talloc(type, num) (type *)malloc(sizeof(type) * (num))
 
+#define EC_CACHELINE_SIZE 64
+
+/* Round size up to the next multiple of align (a power of two) */
+#define EC_ALIGN_UP(size, align) (((size) + (align) - 1) & ~((uint64_t)(align) - 1))
+
 /* Determine if an address is aligned to a particular boundary */
 static inline int is_addr_aligned(unsigned long addr, int align)
 {
@@ -88,6 +93,10 @@ static inline uint64_t bm_any(struct ec_bm *bm)
 {
     return bm->v[0] | bm->v[1] | bm->v[2] | bm->v[3];
 }
+static inline int bm_equal(struct ec_bm *a, struct ec_bm *b)
+{
+    return a->v[0] == b->v[0] && a->v[1] == b->v[1] && a->v[2] == b->v[2] && a->v[3] == b->v[3];
+}
 
 /*
  * Convert an int list into a bitmap
@@ -41,10 +41,29 @@ static inline void init_fragment_header(char *buf)
     header->magic = LIBERASURECODE_FRAG_HEADER_MAGIC;
 }
 
+/*
+ * CRC32 fragment checksums computed while an encode copies in the data and
+ * writes the parity, rather than in a later pass over every payload
+ */
+struct ec_fused_chksum {
+    int legacy; /* liberasurecode_crc32_alt() instead of liberasurecode_crc32() */
+    int payload_size; /* bytes covered by each checksum */
+    int have_data; /* crc[0..k-1] were filled in while copying the data */
+    uint32_t crc[EC_MAX_FRAGMENTS];
+};
+
+/* Chunk the copy and a chunked encode are broken into so the checksums read cache-hot data */
+#define EC_FUSED_CHKSUM_CHUNK (16 * 1024)
+
 /* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
 
 char *alloc_fragment_buffer(int size);
 int free_fragment_buffer(char *buf);
+char *alloc_fragment_buffer_pooled(int size, int depth);
+char *alloc_fragment_buffer_pooled_dirty(int size, int depth);
+int free_fragment_buffer_pooled(char *buf, int depth);
+void release_thread_buffer_pool(void);
+void delete_thread_buffer_pool_key(void);
 int get_aligned_data_size(ec_backend_t instance, int data_len);
 char *get_data_ptr_from_fragment(char *buf);
 int get_data_ptr_array_from_fragments(char **data_array, char **fragments, int num_fragments);
@@ -61,7 +80,13 @@ int get_fragment_backend_metadata_size(char *buf);
 int get_fragment_buffer_size(char *buf);
 int set_orig_data_size(char *buf, int orig_data_size);
 int get_orig_data_size(char *buf);
+int use_legacy_crc(void);
 int set_checksum(ec_checksum_type_t ct, char *buf, int blocksize);
+int set_crc32_checksum(char *buf, uint32_t crc);
+void md5_digest_to_chksum(const unsigned char *digest, uint32_t *chksum);
+int set_md5_checksum(char *buf, const unsigned char *digest);
+uint32_t fused_chksum_update(
+    const struct ec_fused_chksum *fc, uint32_t crc, const char *buf, uint64_t len);
 int get_checksum(char *buf);
 int set_libec_version(char *fragment);
 int get_libec_version(char *fragment, uint32_t *ver);
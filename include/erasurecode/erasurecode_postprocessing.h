@@ -30,9 +30,11 @@
 #define _ERASURECODE_POSTPROCESSING_H_
 
 #include "erasurecode_backend.h"
+#include "erasurecode_helpers_ext.h"
 
 int finalize_fragments_after_encode(ec_backend_t instance, int k, int m, int blocksize,
-    uint64_t orig_data_size, char **encoded_data, char **encoded_parity);
+    uint64_t orig_data_size, char **encoded_data, char **encoded_parity,
+    const struct ec_fused_chksum *fc);
 
 void add_fragment_metadata(ec_backend_t instance, char *fragment, int idx, uint64_t orig_data_size,
     int blocksize, ec_checksum_type_t ct, int add_chksum);
@@ -31,14 +31,42 @@
 
 #include "erasurecode_backend.h"
 #include "erasurecode_helpers.h"
+#include "erasurecode_helpers_ext.h"
 
-int prepare_fragments_for_encode(ec_backend_t instance, int k, int m, const char *orig_data,
-    uint64_t orig_data_size, /* input */
+/* Read position in a scatter-gather list of data to encode */
+struct ec_iov_cursor {
+    const struct iovec *iov; /* current segment */
+    int iovcnt; /* segments left, current one included */
+    size_t off; /* offset into the current segment */
+};
+
+void iov_cursor_copy(struct ec_iov_cursor *cur, char *dst, uint64_t len);
+
+int prepare_fragments_for_encode(ec_backend_t instance, int k, int m, const struct iovec *iov,
+    int iovcnt, uint64_t orig_data_size, /* input */
     char **encoded_data, char **encoded_parity, /* output */
-    int *blocksize);
+    int *blocksize, struct ec_fused_chksum *fc);
+
+uint64_t get_encode_layout(ec_backend_t instance, uint64_t orig_data_size, int *blocksize,
+    int *metadata_size, int *data_offset);
+
+void fill_fragment_buffer(char *fragment, int buffer_size, int data_offset,
+    struct ec_iov_cursor *src, int copy_size, struct ec_fused_chksum *fc, int idx);
+
+int prepare_fragments_for_encode_into(ec_backend_t instance, int k, int m,
+    const struct iovec *iov, int iovcnt, uint64_t orig_data_size, /* input */
+    char **fragments, /* input */
+    char **encoded_data, char **encoded_parity, /* output */
+    int *blocksize, struct ec_fused_chksum *fc);
+
+int prepare_fragments_for_encode_slab(ec_backend_t instance, int k, int m,
+    const struct iovec *iov, int iovcnt, uint64_t orig_data_size, /* input */
+    char ***encoded_data, char ***encoded_parity, /* output */
+    int *blocksize, struct ec_fused_chksum *fc);
 
 int prepare_fragments_for_decode(int k, int m, char **data, char **parity, int *missing_idxs,
-    int *orig_size, int *fragment_payload_size, int fragment_size, struct ec_bm *realloc_bm);
+    int *orig_size, int *fragment_payload_size, int fragment_size, int pool_depth,
+    int with_missing_parity, struct ec_bm *realloc_bm);
 
 int get_fragment_partition(
     int k, int m, char **fragments, int num_fragments, char **data, char **parity, int *missing);
@@ -46,4 +74,10 @@ int get_fragment_partition(
 int fragments_to_string(
     int k, int m, char **fragments, int num_fragments, char **orig_payload, uint64_t *payload_len);
 
+int fragments_to_buffer(int k, int m, char **fragments, int num_fragments, char *buf,
+    uint64_t buf_len, uint64_t *payload_len);
+
+int fragments_to_iov(int k, int m, char **fragments, int num_fragments, struct iovec *iov,
+    int *iovcnt, uint64_t *payload_len);
+
 #endif
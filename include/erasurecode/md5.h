@@ -43,3 +43,7 @@ extern void MD5_Update(MD5_CTX *ctx, void *data, unsigned long size);
 extern void MD5_Final(unsigned char *result, MD5_CTX *ctx);
 
 #endif
+
+#include <stddef.h>
+
+void md5_multi(const unsigned char *const *bufs, int n, size_t len, unsigned char (*digests)[16]);
@@ -27,18 +27,51 @@
  * vi: set noai tw=79 ts=4 sw=4:
  */
 
+#include <pthread.h>
+
 #include "erasurecode_backend.h"
+#include "erasurecode_helpers.h"
 
 #define ISA_L_W 8
 
+/* Number of decode or reconstruct tables kept per instance */
+#define ISA_L_TABLE_CACHE_SIZE 32
+
 /* Forward declarations */
 typedef void (*ec_encode_data_func)(
     int, int, int, unsigned char *, unsigned char **, unsigned char **);
+typedef void (*ec_encode_data_update_func)(
+    int, int, int, int, unsigned char *, unsigned char *, unsigned char **);
 typedef void (*ec_init_tables_func)(int, int, unsigned char *, unsigned char *);
 typedef void (*gf_gen_encoding_matrix_func)(unsigned char *, int, int);
 typedef int (*gf_invert_matrix_func)(unsigned char *, unsigned char *, const int);
 typedef unsigned char (*gf_mul_func)(unsigned char, unsigned char);
 
+/* Shape of a set of tables and, for LRC, the fragments they read */
+struct isa_l_table_layout {
+    int cols; /* number of fragments read */
+    int rows; /* number of fragments rebuilt, 0 for an unused entry */
+    struct ec_bm used_bm; /* LRC: fragments read, in index order */
+    int use_combined_parity; /* LRC: XOR of the local parities read too */
+};
+
+struct isa_l_table_cache_entry {
+    struct ec_bm missing_bm; /* erasure pattern the tables decode */
+    int destination_idx; /* fragment rebuilt by reconstruct, -1 for decode */
+    struct isa_l_table_layout layout;
+    uint64_t last_used; /* for LRU replacement */
+    unsigned char *g_tbls; /* ec_init_tables() output, cols * rows * 32 bytes */
+};
+
+struct isa_l_table_cache {
+    pthread_mutex_t lock;
+    uint64_t clock; /* bumped on every use of an entry */
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    struct isa_l_table_cache_entry entries[ISA_L_TABLE_CACHE_SIZE];
+};
+
 typedef struct {
     /* calls required for init */
     ec_init_tables_func ec_init_tables;
@@ -47,6 +80,9 @@ typedef struct {
     /* calls required for encode */
     ec_encode_data_func ec_encode_data;
 
+    /* optional, for parity updates */
+    ec_encode_data_update_func ec_encode_data_update;
+
     /* calls required for decode and reconstruct */
     gf_invert_matrix_func gf_invert_matrix;
 
@@ -60,18 +96,39 @@ typedef struct {
     int m;
     int l; // local parities
     int w;
+
+    /* decode tables of recently seen erasure patterns */
+    struct isa_l_table_cache table_cache;
 } isa_l_descriptor;
 
 int isa_l_encode(void *desc, char **data, char **parity, int blocksize);
 int isa_l_decode(void *desc, char **data, char **parity, int *missing_idxs, int blocksize);
 int isa_l_reconstruct(
     void *desc, char **data, char **parity, int *missing_idxs, int destination_idx, int blocksize);
+int isa_l_update_parity(
+    void *desc, int data_idx, char *old_data, char *new_data, char **parity, int blocksize);
+int isa_l_reconstruct_multi(void *desc, char **data, char **parity, int *missing_idxs,
+    int *destination_idxs, int blocksize);
+void *isa_l_reconstruct_prepare(void *desc, int *missing_idxs, int destination_idx);
+int isa_l_reconstruct_prepared(void *desc, void *tables, char **data, char **parity, int blocksize);
+void isa_l_reconstruct_release(void *desc, void *tables);
+int isa_l_reconstruct_parity_from_data(isa_l_descriptor *isa_l_desc, char **data, char **parity,
+    struct ec_bm *missing_bm, int destination_idx, int blocksize);
 int isa_l_min_fragments(
     void *desc, int *missing_idxs, int *fragments_to_exclude, int *fragments_needed);
 int isa_l_element_size(void *desc);
 int isa_l_exit(void *desc);
 void *isa_l_common_init(
     struct ec_backend_args *args, void *backend_sohandle, const char *gen_matrix_func_name);
+int isa_l_get_table_cache_stats(void *desc, struct ec_table_cache_stats *stats);
+
+/* decode table cache, shared by all ISA-L backends */
+int isa_l_table_cache_init(isa_l_descriptor *desc);
+void isa_l_table_cache_destroy(isa_l_descriptor *desc);
+int isa_l_table_cache_get(isa_l_descriptor *desc, struct ec_bm *missing_bm, int destination_idx,
+    struct isa_l_table_layout *layout, unsigned char *g_tbls);
+void isa_l_table_cache_put(isa_l_descriptor *desc, struct ec_bm *missing_bm, int destination_idx,
+    struct isa_l_table_layout *layout, unsigned char *g_tbls);
 
 /* global helper functions */
 static inline int get_num_missing_elements(int *missing_idxs)
@@ -42,3 +42,9 @@ int liberasurecode_rs_vand_decode(int *generator_matrix, char **data, char **par
     int *missing, int blocksize, int rebuild_parity);
 int liberasurecode_rs_vand_reconstruct(int *generator_matrix, char **data, char **parity, int k,
     int m, int *missing, int destination_idx, int blocksize);
+int liberasurecode_rs_vand_reconstruct_row(
+    int *generator_matrix, int k, int m, int *missing, int destination_idx, int *row);
+int liberasurecode_rs_vand_reconstruct_from_row(int *row, char **data, char **parity, int k,
+    int m, int *missing, int destination_idx, int blocksize);
+int liberasurecode_rs_vand_update_parity(int *generator_matrix, int data_idx, char *old_data,
+    char *new_data, char **parity, int k, int m, int blocksize);
@@ -102,6 +102,9 @@ int *get_symbols_needed(xor_code_t *code_desc, int *missing_list, int *fragments
 int xor_reconstruct_one(xor_code_t *code_desc, char **data, char **parity, int *missing_idxs,
     int index_to_reconstruct, int blocksize);
 
+int xor_update_parity(xor_code_t *code_desc, int data_idx, char *old_data, char *new_data,
+    char **parity, int blocksize);
+
 xor_code_t *init_xor_hd_code(int k, int m, int hd);
 
 #endif
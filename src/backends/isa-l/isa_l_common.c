@@ -29,6 +29,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "erasurecode.h"
 #include "erasurecode_backend.h"
@@ -51,6 +52,131 @@ __attribute__((visibility("internal"))) int isa_l_encode(
     return 0;
 }
 
+__attribute__((visibility("internal"))) int isa_l_table_cache_init(isa_l_descriptor *desc)
+{
+    memset(&desc->table_cache, 0, sizeof(desc->table_cache));
+    if (pthread_mutex_init(&desc->table_cache.lock, NULL) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+__attribute__((visibility("internal"))) void isa_l_table_cache_destroy(isa_l_descriptor *desc)
+{
+    int i;
+
+    for (i = 0; i < ISA_L_TABLE_CACHE_SIZE; i++) {
+        free(desc->table_cache.entries[i].g_tbls);
+    }
+    pthread_mutex_destroy(&desc->table_cache.lock);
+}
+
+static struct isa_l_table_cache_entry *isa_l_table_cache_find(
+    struct isa_l_table_cache *cache, struct ec_bm *missing_bm, int destination_idx)
+{
+    int i;
+
+    for (i = 0; i < ISA_L_TABLE_CACHE_SIZE; i++) {
+        struct isa_l_table_cache_entry *entry = &cache->entries[i];
+        if (entry->layout.rows != 0 && entry->destination_idx == destination_idx
+            && memcmp(&entry->missing_bm, missing_bm, sizeof(*missing_bm)) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Copy the cached tables for an erasure pattern (and, for reconstruct,
+ * the fragment to rebuild; -1 for decode) into g_tbls and their layout
+ * into layout.  Entries may be replaced as soon as the lock is dropped,
+ * hence the copy.
+ *
+ * Returns 0 on a hit, -1 otherwise.
+ */
+__attribute__((visibility("internal"))) int isa_l_table_cache_get(isa_l_descriptor *desc,
+    struct ec_bm *missing_bm, int destination_idx, struct isa_l_table_layout *layout,
+    unsigned char *g_tbls)
+{
+    struct isa_l_table_cache *cache = &desc->table_cache;
+    struct isa_l_table_cache_entry *entry;
+
+    pthread_mutex_lock(&cache->lock);
+    entry = isa_l_table_cache_find(cache, missing_bm, destination_idx);
+    if (entry) {
+        *layout = entry->layout;
+        memcpy(g_tbls, entry->g_tbls, layout->cols * layout->rows * 32);
+        entry->last_used = ++cache->clock;
+        cache->hits++;
+    } else {
+        cache->misses++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return entry ? 0 : -1;
+}
+
+/*
+ * Remember the tables built for an erasure pattern, replacing the least
+ * recently used ones if the cache is full.  Failing to allocate the copy
+ * only means the next call builds them again.
+ */
+__attribute__((visibility("internal"))) void isa_l_table_cache_put(isa_l_descriptor *desc,
+    struct ec_bm *missing_bm, int destination_idx, struct isa_l_table_layout *layout,
+    unsigned char *g_tbls)
+{
+    struct isa_l_table_cache *cache = &desc->table_cache;
+    struct isa_l_table_cache_entry *entry = NULL;
+    size_t size = layout->cols * layout->rows * 32;
+    unsigned char *copy = malloc(size);
+    int i;
+
+    if (NULL == copy) {
+        return;
+    }
+    memcpy(copy, g_tbls, size);
+
+    pthread_mutex_lock(&cache->lock);
+    if (isa_l_table_cache_find(cache, missing_bm, destination_idx)) {
+        /* Another thread got there first */
+        pthread_mutex_unlock(&cache->lock);
+        free(copy);
+        return;
+    }
+    entry = &cache->entries[0];
+    for (i = 0; i < ISA_L_TABLE_CACHE_SIZE && entry->layout.rows != 0; i++) {
+        if (cache->entries[i].layout.rows == 0
+            || cache->entries[i].last_used < entry->last_used) {
+            entry = &cache->entries[i];
+        }
+    }
+    if (entry->layout.rows != 0) {
+        cache->evictions++;
+    }
+    free(entry->g_tbls);
+    entry->missing_bm = *missing_bm;
+    entry->destination_idx = destination_idx;
+    entry->layout = *layout;
+    entry->last_used = ++cache->clock;
+    entry->g_tbls = copy;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+__attribute__((visibility("internal"))) int isa_l_get_table_cache_stats(
+    void *desc, struct ec_table_cache_stats *stats)
+{
+    isa_l_descriptor *isa_l_desc = (isa_l_descriptor *)desc;
+    struct isa_l_table_cache *cache = &isa_l_desc->table_cache;
+
+    pthread_mutex_lock(&cache->lock);
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    pthread_mutex_unlock(&cache->lock);
+
+    return 0;
+}
+
 static unsigned char *isa_l_get_decode_matrix(
     int k, int m, unsigned char *encode_matrix, int *missing_idxs)
 {
@@ -78,11 +204,11 @@ static unsigned char *isa_l_get_decode_matrix(
 }
 
 /*
- * TODO: Add in missing parity rows and adjust the inverse_rows to
- * be used for parity.
+ * Rows rebuilding the missing data, followed by those rebuilding the
+ * missing parity if with_parity is set
  */
 static unsigned char *get_inverse_rows(int k, int m, unsigned char *decode_inverse,
-    unsigned char *encode_matrix, int *missing_idxs, gf_mul_func gf_mul)
+    unsigned char *encode_matrix, int *missing_idxs, int with_parity, gf_mul_func gf_mul)
 {
     struct ec_bm missing_bm = NEW_BM;
     convert_list_to_bitmap(missing_idxs, &missing_bm);
@@ -124,7 +250,7 @@ static unsigned char *get_inverse_rows(int k, int m, unsigned char *decode_inver
      * the row that corresponds to the missing data in inverse_rows
      * and XOR the resulting row with this row.
      */
-    for (i = k; i < n; i++) {
+    for (i = k; with_parity && i < n; i++) {
         // Parity is missing
         if (bm_get_value(&missing_bm, i)) {
             int d_idx_avail = 0;
@@ -146,26 +272,25 @@ static unsigned char *get_inverse_rows(int k, int m, unsigned char *decode_inver
     return inverse_rows;
 }
 
-__attribute__((visibility("internal"))) int isa_l_decode(
-    void *desc, char **data, char **parity, int *missing_idxs, int blocksize)
+/*
+ * Fill g_tbls with the tables that rebuild the missing data fragments from
+ * the first k available ones, reusing those of an earlier decode with the
+ * same erasure pattern when there is one
+ */
+static int isa_l_get_decode_tables(isa_l_descriptor *isa_l_desc, int *missing_idxs,
+    struct ec_bm *missing_bm, int num_missing_data, unsigned char *g_tbls)
 {
-    isa_l_descriptor *isa_l_desc = (isa_l_descriptor *)desc;
-
-    unsigned char *g_tbls = NULL;
     unsigned char *decode_matrix = NULL;
     unsigned char *decode_inverse = NULL;
     unsigned char *inverse_rows = NULL;
-    unsigned char **decoded_elements = NULL;
-    unsigned char **available_fragments = NULL;
     int k = isa_l_desc->k;
     int m = isa_l_desc->m;
-    int n = k + m;
+    struct isa_l_table_layout layout = { .cols = k, .rows = num_missing_data };
     int ret = -1;
-    int i, j;
 
-    int num_missing_elements = get_num_missing_elements(missing_idxs);
-    struct ec_bm missing_bm = NEW_BM;
-    convert_list_to_bitmap(missing_idxs, &missing_bm);
+    if (isa_l_table_cache_get(isa_l_desc, missing_bm, -1, &layout, g_tbls) == 0) {
+        return 0;
+    }
 
     decode_matrix = isa_l_get_decode_matrix(k, m, isa_l_desc->matrix, missing_idxs);
 
@@ -184,16 +309,66 @@ __attribute__((visibility("internal"))) int isa_l_decode(
         goto out;
     }
 
+    inverse_rows = get_inverse_rows(
+        k, m, decode_inverse, isa_l_desc->matrix, missing_idxs, 0, isa_l_desc->gf_mul);
+    if (NULL == inverse_rows) {
+        goto out;
+    }
+
     // Generate g_tbls from computed decode matrix (k x k) matrix
+    isa_l_desc->ec_init_tables(k, num_missing_data, inverse_rows, g_tbls);
+
+    isa_l_table_cache_put(isa_l_desc, missing_bm, -1, &layout, g_tbls);
+
+    ret = 0;
+
+out:
+    free(decode_matrix);
+    free(decode_inverse);
+    free(inverse_rows);
+
+    return ret;
+}
+
+__attribute__((visibility("internal"))) int isa_l_decode(
+    void *desc, char **data, char **parity, int *missing_idxs, int blocksize)
+{
+    isa_l_descriptor *isa_l_desc = (isa_l_descriptor *)desc;
+
+    unsigned char *g_tbls = NULL;
+    unsigned char **decoded_elements = NULL;
+    unsigned char **available_fragments = NULL;
+    int k = isa_l_desc->k;
+    int m = isa_l_desc->m;
+    int n = k + m;
+    int ret = -1;
+    int i, j;
+
+    int num_missing_data = 0;
+    struct ec_bm missing_bm = NEW_BM;
+    convert_list_to_bitmap(missing_idxs, &missing_bm);
+
+    /* Only the data is rebuilt, missing parity is left alone */
+    for (i = 0; i < k; i++) {
+        if (bm_get_value(&missing_bm, i)) {
+            num_missing_data++;
+        }
+    }
+    if (num_missing_data == 0) {
+        return 0;
+    }
+
     g_tbls = malloc(sizeof(unsigned char) * (k * m * 32));
     if (NULL == g_tbls) {
         goto out;
     }
 
-    inverse_rows = get_inverse_rows(
-        k, m, decode_inverse, isa_l_desc->matrix, missing_idxs, isa_l_desc->gf_mul);
+    if (isa_l_get_decode_tables(isa_l_desc, missing_idxs, &missing_bm, num_missing_data, g_tbls)
+        != 0) {
+        goto out;
+    }
 
-    decoded_elements = (unsigned char **)malloc(sizeof(unsigned char *) * num_missing_elements);
+    decoded_elements = (unsigned char **)malloc(sizeof(unsigned char *) * num_missing_data);
     if (NULL == decoded_elements) {
         goto out;
     }
@@ -227,50 +402,43 @@ __attribute__((visibility("internal"))) int isa_l_decode(
             j++;
         }
     }
-    for (i = k; i < n; i++) {
-        if (bm_get_value(&missing_bm, i)) {
-            decoded_elements[j] = (unsigned char *)parity[i - k];
-            j++;
-        }
-    }
 
-    isa_l_desc->ec_init_tables(k, num_missing_elements, inverse_rows, g_tbls);
-
-    isa_l_desc->ec_encode_data(blocksize, k, num_missing_elements, g_tbls,
+    isa_l_desc->ec_encode_data(blocksize, k, num_missing_data, g_tbls,
         (unsigned char **)available_fragments, (unsigned char **)decoded_elements);
 
     ret = 0;
 
 out:
     free(g_tbls);
-    free(decode_matrix);
-    free(decode_inverse);
-    free(inverse_rows);
     free(decoded_elements);
     free(available_fragments);
 
     return ret;
 }
 
-__attribute__((visibility("internal"))) int isa_l_reconstruct(
-    void *desc, char **data, char **parity, int *missing_idxs, int destination_idx, int blocksize)
+/*
+ * Fill g_tbls with the table that rebuilds destination_idx from the first k
+ * available fragments, reusing the one of an earlier reconstruct with the
+ * same erasure pattern and destination when there is one
+ */
+static int isa_l_get_reconstruct_tables(isa_l_descriptor *isa_l_desc, int *missing_idxs,
+    struct ec_bm *missing_bm, int destination_idx, unsigned char *g_tbls)
 {
-    isa_l_descriptor *isa_l_desc = (isa_l_descriptor *)desc;
-    unsigned char *g_tbls = NULL;
     unsigned char *decode_matrix = NULL;
     unsigned char *decode_inverse = NULL;
     unsigned char *inverse_rows = NULL;
-    unsigned char *reconstruct_buf = NULL;
-    unsigned char **available_fragments = NULL;
     int k = isa_l_desc->k;
     int m = isa_l_desc->m;
     int n = k + m;
+    struct isa_l_table_layout layout = { .cols = k, .rows = 1 };
     int ret = -1;
-    int i, j;
-    struct ec_bm missing_bm = NEW_BM;
-    convert_list_to_bitmap(missing_idxs, &missing_bm);
+    int i;
     int inverse_row = -1;
 
+    if (isa_l_table_cache_get(isa_l_desc, missing_bm, destination_idx, &layout, g_tbls) == 0) {
+        return 0;
+    }
+
     /**
      * Get available elements and compute the inverse of their
      * corresponding rows.
@@ -296,14 +464,105 @@ __attribute__((visibility("internal"))) int isa_l_reconstruct(
      * Get the row needed to reconstruct
      */
     inverse_rows = get_inverse_rows(
-        k, m, decode_inverse, isa_l_desc->matrix, missing_idxs, isa_l_desc->gf_mul);
+        k, m, decode_inverse, isa_l_desc->matrix, missing_idxs, 1, isa_l_desc->gf_mul);
+    if (NULL == inverse_rows) {
+        goto out;
+    }
 
-    // Generate g_tbls from computed decode matrix (k x k) matrix
-    g_tbls = malloc(sizeof(unsigned char) * (k * m * 32));
+    for (i = 0; i < n && i <= destination_idx; i++) {
+        if (bm_get_value(missing_bm, i)) {
+            inverse_row++;
+        }
+    }
+    if (inverse_row < 0 || !bm_get_value(missing_bm, destination_idx)) {
+        goto out;
+    }
+
+    isa_l_desc->ec_init_tables(k, 1, &inverse_rows[inverse_row * k], g_tbls);
+
+    isa_l_table_cache_put(isa_l_desc, missing_bm, destination_idx, &layout, g_tbls);
+
+    ret = 0;
+
+out:
+    free(decode_matrix);
+    free(decode_inverse);
+    free(inverse_rows);
+
+    return ret;
+}
+
+/*
+ * Rebuild a parity fragment while every data fragment is still around.
+ *
+ * That is just one row of the encode, so the row's slice of the encode
+ * tables is applied to the data directly: nothing to invert, nothing to
+ * cache.
+ *
+ * Returns 0 when done, 1 if data is missing too and the caller has to take
+ * the general path.
+ */
+__attribute__((visibility("internal"))) int isa_l_reconstruct_parity_from_data(
+    isa_l_descriptor *isa_l_desc, char **data, char **parity, struct ec_bm *missing_bm,
+    int destination_idx, int blocksize)
+{
+    unsigned char *reconstruct_buf = NULL;
+    int k = isa_l_desc->k;
+    int i;
+
+    if (destination_idx < k) {
+        return 1;
+    }
+    for (i = 0; i < k; i++) {
+        if (bm_get_value(missing_bm, i)) {
+            return 1;
+        }
+    }
+
+    reconstruct_buf = (unsigned char *)parity[destination_idx - k];
+    isa_l_desc->ec_encode_data(blocksize, k, 1,
+        &isa_l_desc->encode_tables[(destination_idx - k) * k * 32], (unsigned char **)data,
+        &reconstruct_buf);
+
+    return 0;
+}
+
+__attribute__((visibility("internal"))) int isa_l_reconstruct(
+    void *desc, char **data, char **parity, int *missing_idxs, int destination_idx, int blocksize)
+{
+    isa_l_descriptor *isa_l_desc = (isa_l_descriptor *)desc;
+    unsigned char *g_tbls = NULL;
+    unsigned char *reconstruct_buf = NULL;
+    unsigned char **available_fragments = NULL;
+    int k = isa_l_desc->k;
+    int m = isa_l_desc->m;
+    int n = k + m;
+    int ret = -1;
+    int i, j;
+    struct ec_bm missing_bm = NEW_BM;
+    convert_list_to_bitmap(missing_idxs, &missing_bm);
+
+    if (destination_idx < 0 || destination_idx >= n) {
+        goto out;
+    }
+
+    ret = isa_l_reconstruct_parity_from_data(
+        isa_l_desc, data, parity, &missing_bm, destination_idx, blocksize);
+    if (ret <= 0) {
+        return ret;
+    }
+    ret = -1;
+
+    g_tbls = malloc(sizeof(unsigned char) * (k * 32));
     if (NULL == g_tbls) {
         goto out;
     }
 
+    if (isa_l_get_reconstruct_tables(isa_l_desc, missing_idxs, &missing_bm, destination_idx, g_tbls)
+        != 0) {
+        goto out;
+    }
+
     /**
      * Fill in the available elements
      */
@@ -331,37 +590,263 @@ __attribute__((visibility("internal"))) int isa_l_reconstruct(
     /**
      * Copy pointer of buffer to reconstruct
      */
-    j = 0;
-    for (i = 0; i < n; i++) {
-        if (bm_get_value(&missing_bm, i)) {
-            if (i == destination_idx) {
-                if (i < k) {
-                    reconstruct_buf = (unsigned char *)data[i];
-                } else {
-                    reconstruct_buf = (unsigned char *)parity[i - k];
-                }
-                inverse_row = j;
-                break;
-            }
-            j++;
-        }
+    if (destination_idx < k) {
+        reconstruct_buf = (unsigned char *)data[destination_idx];
+    } else {
+        reconstruct_buf = (unsigned char *)parity[destination_idx - k];
     }
 
     /**
      * Do the reconstruction
      */
-    isa_l_desc->ec_init_tables(k, 1, &inverse_rows[inverse_row * k], g_tbls);
-
     isa_l_desc->ec_encode_data(blocksize, k, 1, g_tbls, (unsigned char **)available_fragments,
         (unsigned char **)&reconstruct_buf);
 
     ret = 0;
 out:
     free(g_tbls);
+    free(available_fragments);
+
+    return ret;
+}
+
+/* The tables a batch of stripes missing the same fragments shares */
+struct isa_l_reconstruct_tables {
+    struct ec_bm missing_bm;
+    int destination_idx;
+    int parity_from_data; /* a row of the encode tables does */
+    unsigned char g_tbls[];
+};
+
+/*
+ * Look the reconstruct tables up (or build them) once for a whole batch,
+ * rather than taking the cache lock and copying them for every stripe
+ */
+__attribute__((visibility("internal"))) void *isa_l_reconstruct_prepare(
+    void *desc, int *missing_idxs, int destination_idx)
+{
+    isa_l_descriptor *isa_l_desc = (isa_l_descriptor *)desc;
+    struct isa_l_reconstruct_tables *tables = NULL;
+    int k = isa_l_desc->k;
+    int i;
+
+    if (destination_idx < 0 || destination_idx >= k + isa_l_desc->m) {
+        return NULL;
+    }
+    tables = malloc(sizeof(*tables) + k * 32);
+    if (NULL == tables) {
+        return NULL;
+    }
+    memset(&tables->missing_bm, 0, sizeof(tables->missing_bm));
+    convert_list_to_bitmap(missing_idxs, &tables->missing_bm);
+    tables->destination_idx = destination_idx;
+    tables->parity_from_data = destination_idx >= k;
+    for (i = 0; i < k; i++) {
+        if (bm_get_value(&tables->missing_bm, i)) {
+            tables->parity_from_data = 0;
+        }
+    }
+    if (!tables->parity_from_data
+        && isa_l_get_reconstruct_tables(
+               isa_l_desc, missing_idxs, &tables->missing_bm, destination_idx, tables->g_tbls)
+            != 0) {
+        free(tables);
+        return NULL;
+    }
+
+    return tables;
+}
+
+__attribute__((visibility("internal"))) int isa_l_reconstruct_prepared(
+    void *desc, void *tables, char **data, char **parity, int blocksize)
+{
+    isa_l_descriptor *isa_l_desc = (isa_l_descriptor *)desc;
+    struct isa_l_reconstruct_tables *t = (struct isa_l_reconstruct_tables *)tables;
+    unsigned char *available_fragments[EC_MAX_FRAGMENTS];
+    unsigned char *reconstruct_buf = NULL;
+    int k = isa_l_desc->k;
+    int n = k + isa_l_desc->m;
+    int i, j;
+
+    if (t->parity_from_data) {
+        return isa_l_reconstruct_parity_from_data(
+            isa_l_desc, data, parity, &t->missing_bm, t->destination_idx, blocksize);
+    }
+
+    for (i = 0, j = 0; i < n && j < k; i++) {
+        if (!bm_get_value(&t->missing_bm, i)) {
+            available_fragments[j++] = (unsigned char *)(i < k ? data[i] : parity[i - k]);
+        }
+    }
+    reconstruct_buf = (unsigned char *)(t->destination_idx < k
+            ? data[t->destination_idx]
+            : parity[t->destination_idx - k]);
+    isa_l_desc->ec_encode_data(
+        blocksize, k, 1, t->g_tbls, available_fragments, &reconstruct_buf);
+
+    return 0;
+}
+
+__attribute__((visibility("internal"))) void isa_l_reconstruct_release(void *desc, void *tables)
+{
+    free(tables);
+}
+
+/*
+ * Parity is linear in the data, so a data fragment going from old to new
+ * adds c * (old ^ new) to each parity: fold that single delta into the
+ * parity with the fragment's column of the encode tables.  For LRC, the
+ * local parities of other groups have a zero coefficient and stay as
+ * they are.
+ */
+__attribute__((visibility("internal"))) int isa_l_update_parity(
+    void *desc, int data_idx, char *old_data, char *new_data, char **parity, int blocksize)
+{
+    isa_l_descriptor *isa_l_desc = (isa_l_descriptor *)desc;
+    unsigned char *delta = NULL;
+    int k = isa_l_desc->k;
+    int m = isa_l_desc->m;
+    int i;
+
+    if (NULL == isa_l_desc->ec_encode_data_update) {
+        return -EBACKENDNOTSUPP;
+    }
+    if (data_idx < 0 || data_idx >= k) {
+        return -EINVALIDPARAMS;
+    }
+
+    /*
+     * The code is linear: folding old ^ new into the parity once takes the
+     * old data out and puts the new data in, in a single pass over it
+     */
+    delta = malloc(blocksize);
+    if (NULL == delta) {
+        return -ENOMEM;
+    }
+    for (i = 0; i < blocksize; i++) {
+        delta[i] = old_data[i] ^ new_data[i];
+    }
+    isa_l_desc->ec_encode_data_update(blocksize, k, m, data_idx, isa_l_desc->encode_tables,
+        delta, (unsigned char **)parity);
+    free(delta);
+
+    return 0;
+}
+
+/*
+ * Rebuild every fragment in destination_idxs with one table and one sweep
+ * over the first k available fragments: the destinations' rows of the
+ * inverse (or, with all of the data around, of the encode matrix) are
+ * stacked and applied together.
+ */
+__attribute__((visibility("internal"))) int isa_l_reconstruct_multi(void *desc, char **data,
+    char **parity, int *missing_idxs, int *destination_idxs, int blocksize)
+{
+    isa_l_descriptor *isa_l_desc = (isa_l_descriptor *)desc;
+    unsigned char *decode_matrix = NULL;
+    unsigned char *decode_inverse = NULL;
+    unsigned char *inverse_rows = NULL;
+    unsigned char *rows = NULL;
+    unsigned char *g_tbls = NULL;
+    unsigned char *available_fragments[EC_MAX_FRAGMENTS];
+    unsigned char *reconstruct_bufs[EC_MAX_FRAGMENTS];
+    int k = isa_l_desc->k;
+    int m = isa_l_desc->m;
+    int n = k + m;
+    int num_dests = get_num_missing_elements(destination_idxs);
+    int num_missing_data = 0;
+    int ret = -1;
+    int i, j, row;
+    struct ec_bm missing_bm = NEW_BM;
+    convert_list_to_bitmap(missing_idxs, &missing_bm);
+
+    if (num_dests == 1) {
+        return isa_l_reconstruct(desc, data, parity, missing_idxs, destination_idxs[0], blocksize);
+    }
+    if (num_dests < 1 || num_dests > n) {
+        goto out;
+    }
+
+    for (i = 0; i < num_dests; i++) {
+        if (destination_idxs[i] < 0 || destination_idxs[i] >= n
+            || !bm_get_value(&missing_bm, destination_idxs[i])) {
+            goto out;
+        }
+    }
+    for (i = 0; i < k; i++) {
+        if (bm_get_value(&missing_bm, i)) {
+            num_missing_data++;
+        }
+    }
+
+    rows = malloc(sizeof(unsigned char) * k * num_dests);
+    g_tbls = malloc(sizeof(unsigned char) * k * num_dests * 32);
+    if (NULL == rows || NULL == g_tbls) {
+        goto out;
+    }
+
+    if (num_missing_data == 0) {
+        for (i = 0; i < num_dests; i++) {
+            memcpy(&rows[i * k], &isa_l_desc->matrix[destination_idxs[i] * k], k);
+        }
+    } else {
+        decode_matrix = isa_l_get_decode_matrix(k, m, isa_l_desc->matrix, missing_idxs);
+        decode_inverse = (unsigned char *)malloc(sizeof(unsigned char) * k * k);
+        if (NULL == decode_matrix || NULL == decode_inverse) {
+            goto out;
+        }
+        if (isa_l_desc->gf_invert_matrix(decode_matrix, decode_inverse, k) < 0) {
+            goto out;
+        }
+        inverse_rows = get_inverse_rows(
+            k, m, decode_inverse, isa_l_desc->matrix, missing_idxs, 1, isa_l_desc->gf_mul);
+        if (NULL == inverse_rows) {
+            goto out;
+        }
+
+        /* inverse_rows follows the order of the missing indexes */
+        for (i = 0; i < num_dests; i++) {
+            row = 0;
+            for (j = 0; j < destination_idxs[i]; j++) {
+                if (bm_get_value(&missing_bm, j)) {
+                    row++;
+                }
+            }
+            memcpy(&rows[i * k], &inverse_rows[row * k], k);
+        }
+    }
+
+    isa_l_desc->ec_init_tables(k, num_dests, rows, g_tbls);
+
+    j = 0;
+    for (i = 0; i < n && j < k; i++) {
+        if (bm_get_value(&missing_bm, i)) {
+            continue;
+        }
+        available_fragments[j++] = (unsigned char *)(i < k ? data[i] : parity[i - k]);
+    }
+    if (j != k) {
+        goto out;
+    }
+    for (i = 0; i < num_dests; i++) {
+        if (destination_idxs[i] < k) {
+            reconstruct_bufs[i] = (unsigned char *)data[destination_idxs[i]];
+        } else {
+            reconstruct_bufs[i] = (unsigned char *)parity[destination_idxs[i] - k];
+        }
+    }
+
+    isa_l_desc->ec_encode_data(
+        blocksize, k, num_dests, g_tbls, available_fragments, reconstruct_bufs);
+
+    ret = 0;
+
+out:
     free(decode_matrix);
     free(decode_inverse);
     free(inverse_rows);
-    free(available_fragments);
+    free(rows);
+    free(g_tbls);
 
     return ret;
 }
@@ -408,6 +893,7 @@ __attribute__((visibility("internal"))) int isa_l_exit(void *desc)
 
     isa_l_desc = (isa_l_descriptor *)desc;
 
+    isa_l_table_cache_destroy(isa_l_desc);
     free(isa_l_desc->encode_tables);
     free(isa_l_desc->matrix);
     free(isa_l_desc);
@@ -446,6 +932,7 @@ __attribute__((visibility("internal"))) void *isa_l_common_init(
      */
     union {
         ec_encode_data_func encodep;
+        ec_encode_data_update_func encode_updatep;
         ec_init_tables_func init_tablesp;
         gf_gen_encoding_matrix_func gen_matrixp;
         gf_invert_matrix_func invert_matrixp;
@@ -461,6 +948,11 @@ __attribute__((visibility("internal"))) void *isa_l_common_init(
         goto error;
     }
 
+    /* Only needed for parity updates, which are refused without it */
+    func_handle.vptr = NULL;
+    func_handle.vptr = dlsym(backend_sohandle, "ec_encode_data_update");
+    desc->ec_encode_data_update = func_handle.encode_updatep;
+
     func_handle.vptr = NULL;
     func_handle.vptr = dlsym(backend_sohandle, "ec_init_tables");
     desc->ec_init_tables = func_handle.init_tablesp;
@@ -510,6 +1002,11 @@ __attribute__((visibility("internal"))) void *isa_l_common_init(
 
     desc->ec_init_tables(desc->k, desc->m, &desc->matrix[desc->k * desc->k], desc->encode_tables);
 
+    if (isa_l_table_cache_init(desc) != 0) {
+        free(desc->encode_tables);
+        goto error_free;
+    }
+
     return desc;
 
 error_free:
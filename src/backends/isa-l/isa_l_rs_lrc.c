@@ -158,6 +158,7 @@ static void *isa_l_rs_lrc_init(struct ec_backend_args *args, void *backend_sohan
      */
     union {
         ec_encode_data_func encodep;
+        ec_encode_data_update_func encode_updatep;
         ec_init_tables_func init_tablesp;
         gf_gen_encoding_matrix_func gen_matrixp;
         gf_invert_matrix_func invert_matrixp;
@@ -173,6 +174,11 @@ static void *isa_l_rs_lrc_init(struct ec_backend_args *args, void *backend_sohan
         goto error;
     }
 
+    /* Only needed for parity updates, which are refused without it */
+    func_handle.vptr = NULL;
+    func_handle.vptr = dlsym(backend_sohandle, "ec_encode_data_update");
+    desc->ec_encode_data_update = func_handle.encode_updatep;
+
     func_handle.vptr = NULL;
     func_handle.vptr = dlsym(backend_sohandle, "ec_init_tables");
     desc->ec_init_tables = func_handle.init_tablesp;
@@ -213,6 +219,11 @@ static void *isa_l_rs_lrc_init(struct ec_backend_args *args, void *backend_sohan
 
     desc->ec_init_tables(desc->k, desc->m, &desc->matrix[desc->k * desc->k], desc->encode_tables);
 
+    if (isa_l_table_cache_init(desc) != 0) {
+        free(desc->encode_tables);
+        goto error;
+    }
+
     return desc;
 
 error:
@@ -442,36 +453,93 @@ static unsigned char *isa_l_lrc_get_decode_matrix(int k, int m, unsigned local_p
     return decode_matrix;
 }
 
-static int isa_l_lrc_decode(
-    void *desc, char **data, char **parity, int *missing_idxs, int blocksize)
+/*
+ * Record which fragments the tables of a layout read
+ */
+static void isa_l_lrc_set_used(struct isa_l_table_layout *layout, int *used_idxs, int n)
 {
-    isa_l_descriptor *isa_l_desc = (isa_l_descriptor *)desc;
+    int i;
 
-    unsigned char *g_tbls = NULL;
+    for (i = 0; i < n; i++) {
+        bm_set_value(&layout->used_bm, i, used_idxs[i]);
+    }
+}
+
+/*
+ * Pick the fragments the tables of a layout read, in the order the tables
+ * were built for: the data and global parities used, the XOR of all local
+ * parities when it stands in for a global one, then the local parities
+ * used.  combined_local_parities is allocated for the XOR if needed and
+ * must be freed by the caller.
+ */
+static int isa_l_lrc_get_available_fragments(isa_l_descriptor *isa_l_desc, char **data,
+    char **parity, struct isa_l_table_layout *layout, int blocksize,
+    unsigned char **available_fragments, unsigned char **combined_local_parities)
+{
+    int k = isa_l_desc->k;
+    int n = k + isa_l_desc->m;
+    int local_parity = isa_l_desc->l;
+    int i, j = 0;
+
+    for (i = 0; i < n - local_parity && j < layout->cols; i++) {
+        if (bm_get_value(&layout->used_bm, i)) {
+            if (i < k) {
+                available_fragments[j] = (unsigned char *)data[i];
+            } else {
+                available_fragments[j] = (unsigned char *)parity[i - k];
+            }
+            j++;
+        }
+    }
+    if (j < layout->cols && layout->use_combined_parity) {
+        *combined_local_parities = calloc(blocksize, sizeof(unsigned char));
+        if (NULL == *combined_local_parities) {
+            return -1;
+        }
+        for (i = n - local_parity; i < n; i++) {
+            for (int x = 0; x < blocksize; x++) {
+                (*combined_local_parities)[x] ^= parity[i - k][x];
+            }
+        }
+        available_fragments[j] = *combined_local_parities;
+        j++;
+    }
+    for (i = n - local_parity; i < n && j < layout->cols; i++) {
+        if (bm_get_value(&layout->used_bm, i)) {
+            available_fragments[j] = (unsigned char *)parity[i - k];
+            j++;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Fill g_tbls and layout with the tables that rebuild the missing data
+ * fragments, reusing those of an earlier decode with the same erasure
+ * pattern when there is one
+ */
+static int isa_l_lrc_get_decode_tables(isa_l_descriptor *isa_l_desc, struct ec_bm *missing_bm,
+    int num_missing_data, struct isa_l_table_layout *layout, unsigned char *g_tbls)
+{
     unsigned char *decode_matrix = NULL;
     unsigned char *decode_inverse = NULL;
     unsigned char *inverse_rows = NULL;
-    unsigned char **decoded_elements = NULL;
-    unsigned char **available_fragments = NULL;
     int k = isa_l_desc->k;
     int m = isa_l_desc->m;
-    int local_parity = isa_l_desc->l;
     int n = k + m;
     int ret = -1;
-    int i, j;
-    unsigned char *combined_local_parities = NULL;
-    int use_combined_parity = 0;
 
-    int num_missing_elements = get_num_missing_elements(missing_idxs);
-    struct ec_bm missing_bm = NEW_BM;
-    convert_list_to_bitmap(missing_idxs, &missing_bm);
+    if (isa_l_table_cache_get(isa_l_desc, missing_bm, -1, layout, g_tbls) == 0) {
+        return 0;
+    }
 
     int *used_idxs = calloc(n, sizeof(int));
     if (NULL == used_idxs) {
         goto out;
     }
-    decode_matrix = isa_l_lrc_get_decode_matrix(
-        k, m, local_parity, isa_l_desc->matrix, &missing_bm, used_idxs, &use_combined_parity);
+    decode_matrix = isa_l_lrc_get_decode_matrix(k, m, isa_l_desc->l, isa_l_desc->matrix,
+        missing_bm, used_idxs, &layout->use_combined_parity);
 
     if (NULL == decode_matrix) {
         goto out;
@@ -488,16 +556,71 @@ static int isa_l_lrc_decode(
         goto out;
     }
 
+    inverse_rows = get_lrc_inverse_rows(
+        k, m, 0, k, 0, decode_inverse, isa_l_desc->matrix, missing_bm, isa_l_desc->gf_mul);
+    if (NULL == inverse_rows) {
+        goto out;
+    }
+
     // Generate g_tbls from computed decode matrix (k x k) matrix
+    isa_l_desc->ec_init_tables(k, num_missing_data, inverse_rows, g_tbls);
+
+    layout->cols = k;
+    layout->rows = num_missing_data;
+    isa_l_lrc_set_used(layout, used_idxs, n);
+    isa_l_table_cache_put(isa_l_desc, missing_bm, -1, layout, g_tbls);
+
+    ret = 0;
+
+out:
+    free(decode_matrix);
+    free(decode_inverse);
+    free(inverse_rows);
+    free(used_idxs);
+
+    return ret;
+}
+
+static int isa_l_lrc_decode(
+    void *desc, char **data, char **parity, int *missing_idxs, int blocksize)
+{
+    isa_l_descriptor *isa_l_desc = (isa_l_descriptor *)desc;
+
+    unsigned char *g_tbls = NULL;
+    unsigned char **decoded_elements = NULL;
+    unsigned char **available_fragments = NULL;
+    int k = isa_l_desc->k;
+    int m = isa_l_desc->m;
+    int ret = -1;
+    int i, j;
+    unsigned char *combined_local_parities = NULL;
+    struct isa_l_table_layout layout = { 0 };
+
+    int num_missing_data = 0;
+    struct ec_bm missing_bm = NEW_BM;
+    convert_list_to_bitmap(missing_idxs, &missing_bm);
+
+    /* Only the data is rebuilt, missing parity is left alone */
+    for (i = 0; i < k; i++) {
+        if (bm_get_value(&missing_bm, i)) {
+            num_missing_data++;
+        }
+    }
+    if (num_missing_data == 0) {
+        return 0;
+    }
+
     g_tbls = malloc(sizeof(unsigned char) * (k * m * 32));
     if (NULL == g_tbls) {
         goto out;
     }
 
-    inverse_rows = get_lrc_inverse_rows(
-        k, m, 0, k, 0, decode_inverse, isa_l_desc->matrix, &missing_bm, isa_l_desc->gf_mul);
+    if (isa_l_lrc_get_decode_tables(isa_l_desc, &missing_bm, num_missing_data, &layout, g_tbls)
+        != 0) {
+        goto out;
+    }
 
-    decoded_elements = (unsigned char **)malloc(sizeof(unsigned char *) * num_missing_elements);
+    decoded_elements = (unsigned char **)malloc(sizeof(unsigned char *) * num_missing_data);
     if (NULL == decoded_elements) {
         goto out;
     }
@@ -507,44 +630,12 @@ static int isa_l_lrc_decode(
         goto out;
     }
 
-    uint64_t missing_local_parities = 0;
-    for (j = n - local_parity; j < n; j++) {
-        missing_local_parities |= bm_get_value(&missing_bm, j);
+    if (isa_l_lrc_get_available_fragments(isa_l_desc, data, parity, &layout, blocksize,
+            available_fragments, &combined_local_parities)
+        != 0) {
+        goto out;
     }
 
-    for (i = 0, j = 0; i < n - local_parity && j < k; i++) {
-        if (bm_get_value(&missing_bm, i)) {
-            continue;
-        }
-        if (i < k) {
-            available_fragments[j] = (unsigned char *)data[i];
-            j++;
-        } else {
-            if (used_idxs[i]) {
-                available_fragments[j] = (unsigned char *)parity[i - k];
-                j++;
-            }
-        }
-    }
-    if (j < k && !missing_local_parities && use_combined_parity) {
-        combined_local_parities = calloc(blocksize, sizeof(unsigned char));
-        if (NULL == combined_local_parities) {
-            goto out;
-        }
-        for (i = n - local_parity; i < n; i++) {
-            for (int x = 0; x < blocksize; x++) {
-                combined_local_parities[x] ^= parity[i - k][x];
-            }
-        }
-        available_fragments[j] = combined_local_parities;
-        j++;
-    }
-    for (i = n - local_parity; i < n && j < k; i++) {
-        if (used_idxs[i]) {
-            available_fragments[j] = (unsigned char *)parity[i - k];
-            j++;
-        }
-    }
     // Grab pointers to memory needed for missing data fragments
     j = 0;
     for (i = 0; i < k; i++) {
@@ -553,29 +644,17 @@ static int isa_l_lrc_decode(
             j++;
         }
     }
-    for (i = k; i < n; i++) {
-        if (bm_get_value(&missing_bm, i)) {
-            decoded_elements[j] = (unsigned char *)parity[i - k];
-            j++;
-        }
-    }
-
-    isa_l_desc->ec_init_tables(k, num_missing_elements, inverse_rows, g_tbls);
 
     isa_l_desc->ec_encode_data(
-        blocksize, k, num_missing_elements, g_tbls, available_fragments, decoded_elements);
+        blocksize, k, num_missing_data, g_tbls, available_fragments, decoded_elements);
 
     ret = 0;
 
 out:
     free(g_tbls);
     free(combined_local_parities);
-    free(decode_matrix);
-    free(decode_inverse);
-    free(inverse_rows);
     free(decoded_elements);
     free(available_fragments);
-    free(used_idxs);
 
     return ret;
 }
@@ -676,33 +755,37 @@ static unsigned char *isa_l_lrc_get_reconstruct_matrix(int k, int m, unsigned lo
     return decode_matrix;
 }
 
-static int isa_l_lrc_reconstruct(
-    void *desc, char **data, char **parity, int *missing_idxs, int destination_idx, int blocksize)
+/*
+ * Fill g_tbls and layout with the table that rebuilds destination_idx,
+ * from its local group if possible, reusing the one of an earlier
+ * reconstruct with the same erasure pattern and destination when there is
+ * one
+ */
+static int isa_l_lrc_get_reconstruct_tables(isa_l_descriptor *isa_l_desc,
+    struct ec_bm *missing_bm, int destination_idx, struct isa_l_table_layout *layout,
+    unsigned char *g_tbls)
 {
-    isa_l_descriptor *isa_l_desc = (isa_l_descriptor *)desc;
-    unsigned char *g_tbls = NULL;
     unsigned char *decode_matrix = NULL;
     unsigned char *decode_inverse = NULL;
     unsigned char *inverse_rows = NULL;
-    unsigned char *reconstruct_buf = NULL;
-    unsigned char **available_fragments = NULL;
     int k = isa_l_desc->k;
     int m = isa_l_desc->m;
-    int local_parity = isa_l_desc->l;
     int n = k + m;
     int ret = -1;
-    int i, j;
-    struct ec_bm missing_bm = NEW_BM;
-    convert_list_to_bitmap(missing_idxs, &missing_bm);
+    int i;
     int inverse_row = -1;
     int min_range = 0;
     int max_range = 0;
     int matrix_size = k;
-    int *used_idxs = calloc(n, sizeof(int));
     int missing_local_parity = 0;
-    unsigned char *combined_local_parities = NULL;
-    int use_combined_parity = 0;
+    /* narrowed down to the local group for a local repair */
+    struct ec_bm group_missing_bm = *missing_bm;
 
+    if (isa_l_table_cache_get(isa_l_desc, missing_bm, destination_idx, layout, g_tbls) == 0) {
+        return 0;
+    }
+
+    int *used_idxs = calloc(n, sizeof(int));
     if (NULL == used_idxs) {
         goto out;
     }
@@ -710,9 +793,9 @@ static int isa_l_lrc_reconstruct(
      * Get available elements and compute the inverse of their
      * corresponding rows.
      */
-    decode_matrix = isa_l_lrc_get_reconstruct_matrix(k, m, local_parity, destination_idx,
-        isa_l_desc->matrix, &missing_bm, used_idxs, &min_range, &max_range, &matrix_size,
-        &missing_local_parity, &use_combined_parity);
+    decode_matrix = isa_l_lrc_get_reconstruct_matrix(k, m, isa_l_desc->l, destination_idx,
+        isa_l_desc->matrix, &group_missing_bm, used_idxs, &min_range, &max_range, &matrix_size,
+        &missing_local_parity, &layout->use_combined_parity);
     if (NULL == decode_matrix) {
         goto out;
     }
@@ -728,7 +811,6 @@ static int isa_l_lrc_reconstruct(
         goto out;
     }
 
-    int nb_parity = (matrix_size == k) ? m : 1;
     unsigned char *encode
         = (matrix_size == k || missing_local_parity) ? isa_l_desc->matrix : decode_matrix;
 
@@ -736,125 +818,291 @@ static int isa_l_lrc_reconstruct(
      * Get the row needed to reconstruct
      */
     inverse_rows = get_lrc_inverse_rows(k, m, min_range, max_range, missing_local_parity,
-        decode_inverse, encode, &missing_bm, isa_l_desc->gf_mul);
+        decode_inverse, encode, &group_missing_bm, isa_l_desc->gf_mul);
+    if (NULL == inverse_rows) {
+        goto out;
+    }
 
-    // Generate g_tbls from computed decode matrix (k x k) matrix
-    g_tbls = malloc(sizeof(unsigned char) * (matrix_size * nb_parity * 32));
-    if (NULL == g_tbls) {
+    for (i = 0; i <= destination_idx; i++) {
+        if (bm_get_value(&group_missing_bm, i)) {
+            inverse_row++;
+        }
+    }
+    if (inverse_row < 0 || !bm_get_value(&group_missing_bm, destination_idx)) {
         goto out;
     }
 
+    isa_l_desc->ec_init_tables(matrix_size, 1, &inverse_rows[inverse_row * matrix_size], g_tbls);
+
+    layout->cols = matrix_size;
+    layout->rows = 1;
+    isa_l_lrc_set_used(layout, used_idxs, n);
+    isa_l_table_cache_put(isa_l_desc, missing_bm, destination_idx, layout, g_tbls);
+
+    ret = 0;
+
+out:
+    free(decode_matrix);
+    free(decode_inverse);
+    free(inverse_rows);
+    free(used_idxs);
+
+    return ret;
+}
+
+/*
+ * Repair a data fragment or local parity from the rest of its local group.
+ *
+ * A local parity is p = sum(c_j * d_j) over the group's data, so a missing
+ * member is rebuilt by a single row read straight off the encoding matrix,
+ * d_t = (p + sum(c_j * d_j, j != t)) / c_t, with no matrix to invert and
+ * only the group's fragments read.  (The c_j are not all one with this
+ * construction, so plain XOR would not do.)
+ *
+ * Returns 0 when done, 1 if the group is missing more than the destination
+ * and the caller has to take the general path, -1 on error.
+ */
+static int isa_l_lrc_reconstruct_local(isa_l_descriptor *isa_l_desc, char **data, char **parity,
+    struct ec_bm *missing_bm, int destination_idx, int blocksize)
+{
+    unsigned char coefs[EC_MAX_FRAGMENTS];
+    unsigned char g_tbls[EC_MAX_FRAGMENTS * 32];
+    unsigned char *sources[EC_MAX_FRAGMENTS];
+    unsigned char *reconstruct_buf = NULL;
+    unsigned char *row = NULL;
+    unsigned char inv = 1;
+    int k = isa_l_desc->k;
+    int m = isa_l_desc->m;
+    int l = isa_l_desc->l;
+    int local_group, local_parity_idx, lower, upper;
+    int cols = 0;
+    int i;
+
+    if (destination_idx < k) {
+        local_group = local_group_for_data(k, l, destination_idx);
+    } else if (destination_idx >= k + m - l) {
+        local_group = destination_idx - (k + m - l);
+    } else {
+        return 1;
+    }
+    local_parity_idx = k + m - l + local_group;
+    lower = local_group_data_lower(k, l, local_group);
+    upper = local_group_data_upper(k, l, local_group);
+
+    if (destination_idx != local_parity_idx && bm_get_value(missing_bm, local_parity_idx)) {
+        return 1;
+    }
+    for (i = lower; i < upper; i++) {
+        if (i != destination_idx && bm_get_value(missing_bm, i)) {
+            return 1;
+        }
+    }
+
+    row = &isa_l_desc->matrix[k * local_parity_idx];
+    if (destination_idx != local_parity_idx) {
+        unsigned char c = row[destination_idx];
+        if (c == 0 || isa_l_desc->gf_invert_matrix(&c, &inv, 1) < 0) {
+            return 1;
+        }
+    }
+
+    for (i = lower; i < upper; i++) {
+        if (i == destination_idx) {
+            continue;
+        }
+        coefs[cols] = isa_l_desc->gf_mul(row[i], inv);
+        sources[cols++] = (unsigned char *)data[i];
+    }
+    if (destination_idx != local_parity_idx) {
+        coefs[cols] = inv;
+        sources[cols++] = (unsigned char *)parity[local_parity_idx - k];
+        reconstruct_buf = (unsigned char *)data[destination_idx];
+    } else {
+        reconstruct_buf = (unsigned char *)parity[destination_idx - k];
+    }
+
+    isa_l_desc->ec_init_tables(cols, 1, coefs, g_tbls);
+    isa_l_desc->ec_encode_data(blocksize, cols, 1, g_tbls, sources, &reconstruct_buf);
+
+    return 0;
+}
+
+/*
+ * Rebuild destination_idx with tables from isa_l_lrc_get_reconstruct_tables()
+ */
+static int isa_l_lrc_reconstruct_with_tables(isa_l_descriptor *isa_l_desc, char **data,
+    char **parity, struct isa_l_table_layout *layout, unsigned char *g_tbls, int destination_idx,
+    int blocksize)
+{
+    unsigned char *reconstruct_buf = NULL;
+    unsigned char **available_fragments = NULL;
+    unsigned char *combined_local_parities = NULL;
+    int k = isa_l_desc->k;
+    int ret = -1;
+
     /**
      * Fill in the available elements
      */
-    available_fragments = (unsigned char **)malloc(sizeof(unsigned char *) * matrix_size);
+    available_fragments = (unsigned char **)malloc(sizeof(unsigned char *) * layout->cols);
     if (NULL == available_fragments) {
         goto out;
     }
 
-    j = 0;
-    if (matrix_size == k) {
-        for (i = 0; i < n - local_parity && j < k; i++) {
-            if (bm_get_value(&missing_bm, i)) {
-                continue;
-            }
-            if (i < k) {
-                available_fragments[j] = (unsigned char *)data[i];
-                j++;
-            } else {
-                if (used_idxs[i]) {
-                    available_fragments[j] = (unsigned char *)parity[i - k];
-                    j++;
-                }
-            }
-        }
-        if (j < k && !missing_local_parity && use_combined_parity) {
-            combined_local_parities = calloc(blocksize, sizeof(unsigned char));
-            if (NULL == combined_local_parities) {
-                goto out;
-            }
-            for (i = n - local_parity; i < n; i++) {
-                for (int x = 0; x < blocksize; x++) {
-                    combined_local_parities[x] ^= parity[i - k][x];
-                }
-            }
-            available_fragments[j] = combined_local_parities;
-            j++;
-        }
-        for (i = n - local_parity; i < n && j < k; i++) {
-            if (bm_get_value(&missing_bm, i)) {
-                continue;
-            }
-            if (used_idxs[i]) {
-                available_fragments[j] = (unsigned char *)parity[i - k];
-                j++;
-            }
-        }
-    } else {
-        for (i = 0; i < n; i++) {
-            if (used_idxs[i]) {
-                if (i < k) {
-                    available_fragments[j] = (unsigned char *)data[i];
-                } else {
-                    available_fragments[j] = (unsigned char *)parity[i - k];
-                }
-                j++;
-            }
-        }
+    if (isa_l_lrc_get_available_fragments(isa_l_desc, data, parity, layout, blocksize,
+            available_fragments, &combined_local_parities)
+        != 0) {
+        goto out;
     }
 
     /**
      * Copy pointer of buffer to reconstruct
      */
-    j = 0;
-    for (i = 0; i < n; i++) {
-        if (bm_get_value(&missing_bm, i)) {
-            if (i == destination_idx) {
-                if (i < k) {
-                    reconstruct_buf = (unsigned char *)data[i];
-                } else {
-                    reconstruct_buf = (unsigned char *)parity[i - k];
-                }
-                inverse_row = j;
-                break;
-            }
-            j++;
-        }
+    if (destination_idx < k) {
+        reconstruct_buf = (unsigned char *)data[destination_idx];
+    } else {
+        reconstruct_buf = (unsigned char *)parity[destination_idx - k];
     }
 
     /**
      * Do the reconstruction
      */
-    isa_l_desc->ec_init_tables(matrix_size, 1, &inverse_rows[inverse_row * matrix_size], g_tbls);
     isa_l_desc->ec_encode_data(
-        blocksize, matrix_size, 1, g_tbls, available_fragments, &reconstruct_buf);
+        blocksize, layout->cols, 1, g_tbls, available_fragments, &reconstruct_buf);
 
     ret = 0;
 out:
-    free(g_tbls);
     free(combined_local_parities);
-    free(decode_matrix);
-    free(decode_inverse);
-    free(inverse_rows);
     free(available_fragments);
-    free(used_idxs);
 
     return ret;
 }
 
+static int isa_l_lrc_reconstruct(
+    void *desc, char **data, char **parity, int *missing_idxs, int destination_idx, int blocksize)
+{
+    isa_l_descriptor *isa_l_desc = (isa_l_descriptor *)desc;
+    unsigned char *g_tbls = NULL;
+    int k = isa_l_desc->k;
+    int n = k + isa_l_desc->m;
+    int ret = -1;
+    struct ec_bm missing_bm = NEW_BM;
+    convert_list_to_bitmap(missing_idxs, &missing_bm);
+    struct isa_l_table_layout layout = { 0 };
+
+    if (destination_idx < 0 || destination_idx >= n) {
+        goto out;
+    }
+
+    ret = isa_l_lrc_reconstruct_local(
+        isa_l_desc, data, parity, &missing_bm, destination_idx, blocksize);
+    if (ret <= 0) {
+        return ret;
+    }
+    ret = isa_l_reconstruct_parity_from_data(
+        isa_l_desc, data, parity, &missing_bm, destination_idx, blocksize);
+    if (ret <= 0) {
+        return ret;
+    }
+    ret = -1;
+
+    g_tbls = malloc(sizeof(unsigned char) * (k * 32));
+    if (NULL == g_tbls) {
+        goto out;
+    }
+
+    if (isa_l_lrc_get_reconstruct_tables(isa_l_desc, &missing_bm, destination_idx, &layout, g_tbls)
+        != 0) {
+        goto out;
+    }
+
+    ret = isa_l_lrc_reconstruct_with_tables(
+        isa_l_desc, data, parity, &layout, g_tbls, destination_idx, blocksize);
+out:
+    free(g_tbls);
+
+    return ret;
+}
+
+/* The tables a batch of stripes missing the same fragments shares */
+struct isa_l_lrc_reconstruct_tables {
+    struct ec_bm missing_bm;
+    int destination_idx;
+    struct isa_l_table_layout layout;
+    unsigned char g_tbls[];
+};
+
+/*
+ * Look the general reconstruct tables up (or build them) once for a whole
+ * batch.  Local repairs and parity rebuilt from the data need none, and
+ * still take their own path for every stripe.
+ */
+static void *isa_l_lrc_reconstruct_prepare(void *desc, int *missing_idxs, int destination_idx)
+{
+    isa_l_descriptor *isa_l_desc = (isa_l_descriptor *)desc;
+    struct isa_l_lrc_reconstruct_tables *tables = NULL;
+    int k = isa_l_desc->k;
+
+    if (destination_idx < 0 || destination_idx >= k + isa_l_desc->m) {
+        return NULL;
+    }
+    tables = calloc(1, sizeof(*tables) + k * 32);
+    if (NULL == tables) {
+        return NULL;
+    }
+    convert_list_to_bitmap(missing_idxs, &tables->missing_bm);
+    tables->destination_idx = destination_idx;
+    if (isa_l_lrc_get_reconstruct_tables(isa_l_desc, &tables->missing_bm, destination_idx,
+            &tables->layout, tables->g_tbls)
+        != 0) {
+        free(tables);
+        return NULL;
+    }
+
+    return tables;
+}
+
+static int isa_l_lrc_reconstruct_prepared(
+    void *desc, void *tables, char **data, char **parity, int blocksize)
+{
+    isa_l_descriptor *isa_l_desc = (isa_l_descriptor *)desc;
+    struct isa_l_lrc_reconstruct_tables *t = (struct isa_l_lrc_reconstruct_tables *)tables;
+    int ret;
+
+    ret = isa_l_lrc_reconstruct_local(
+        isa_l_desc, data, parity, &t->missing_bm, t->destination_idx, blocksize);
+    if (ret <= 0) {
+        return ret;
+    }
+    ret = isa_l_reconstruct_parity_from_data(
+        isa_l_desc, data, parity, &t->missing_bm, t->destination_idx, blocksize);
+    if (ret <= 0) {
+        return ret;
+    }
+
+    return isa_l_lrc_reconstruct_with_tables(
+        isa_l_desc, data, parity, &t->layout, t->g_tbls, t->destination_idx, blocksize);
+}
+
 static struct ec_backend_op_stubs isa_l_rs_lrc_op_stubs = {
     .INIT = isa_l_rs_lrc_init,
     .EXIT = isa_l_exit,
     .ISSYSTEMATIC = 1,
+    .DECODESDATAONLY = 1,
+    .ENCODESBYCOLUMN = 1,
     .ENCODE = isa_l_encode,
     .DECODE = isa_l_lrc_decode,
     .FRAGSNEEDED = isa_l_min_fragments,
     .RECONSTRUCT = isa_l_lrc_reconstruct,
+    .RECONSTRUCTPREPARE = isa_l_lrc_reconstruct_prepare,
+    .RECONSTRUCTPREPARED = isa_l_lrc_reconstruct_prepared,
+    .RECONSTRUCTRELEASE = isa_l_reconstruct_release,
+    .UPDATEPARITY = isa_l_update_parity,
     .ELEMENTSIZE = isa_l_element_size,
     .ISCOMPATIBLEWITH = isa_l_rs_lrc_is_compatible_with,
     .GETMETADATASIZE = get_backend_metadata_size_zero,
     .GETENCODEOFFSET = get_encode_offset_zero,
     .CHECKRECONSTRUCTFRAGMENTS = isa_l_rs_lrc_check_reconstruct_fragments,
+    .GETTABLECACHESTATS = isa_l_get_table_cache_stats,
 };
 
 __attribute__((visibility("internal"))) struct ec_backend_common backend_isa_l_rs_lrc = {
@@ -63,14 +63,22 @@ static struct ec_backend_op_stubs isa_l_rs_vand_op_stubs = {
     .INIT = isa_l_rs_vand_init,
     .EXIT = isa_l_exit,
     .ISSYSTEMATIC = 1,
+    .DECODESDATAONLY = 1,
+    .ENCODESBYCOLUMN = 1,
     .ENCODE = isa_l_encode,
     .DECODE = isa_l_decode,
     .FRAGSNEEDED = isa_l_min_fragments,
     .RECONSTRUCT = isa_l_reconstruct,
+    .RECONSTRUCTMULTI = isa_l_reconstruct_multi,
+    .RECONSTRUCTPREPARE = isa_l_reconstruct_prepare,
+    .RECONSTRUCTPREPARED = isa_l_reconstruct_prepared,
+    .RECONSTRUCTRELEASE = isa_l_reconstruct_release,
+    .UPDATEPARITY = isa_l_update_parity,
     .ELEMENTSIZE = isa_l_element_size,
     .ISCOMPATIBLEWITH = isa_l_rs_vand_is_compatible_with,
     .GETMETADATASIZE = get_backend_metadata_size_zero,
     .GETENCODEOFFSET = get_encode_offset_zero,
+    .GETTABLECACHESTATS = isa_l_get_table_cache_stats,
 };
 
 __attribute__((visibility("internal"))) struct ec_backend_common backend_isa_l_rs_vand = {
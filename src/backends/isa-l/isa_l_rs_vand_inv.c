@@ -139,6 +139,7 @@ static void *isa_l_rs_vand_inv_init(struct ec_backend_args *args, void *backend_
      */
     union {
         ec_encode_data_func encodep;
+        ec_encode_data_update_func encode_updatep;
         ec_init_tables_func init_tablesp;
         gf_gen_encoding_matrix_func gen_matrixp;
         gf_invert_matrix_func invert_matrixp;
@@ -154,6 +155,11 @@ static void *isa_l_rs_vand_inv_init(struct ec_backend_args *args, void *backend_
         goto error;
     }
 
+    /* Only needed for parity updates, which are refused without it */
+    func_handle.vptr = NULL;
+    func_handle.vptr = dlsym(backend_sohandle, "ec_encode_data_update");
+    desc->ec_encode_data_update = func_handle.encode_updatep;
+
     func_handle.vptr = NULL;
     func_handle.vptr = dlsym(backend_sohandle, "ec_init_tables");
     desc->ec_init_tables = func_handle.init_tablesp;
@@ -194,6 +200,11 @@ static void *isa_l_rs_vand_inv_init(struct ec_backend_args *args, void *backend_
 
     desc->ec_init_tables(desc->k, desc->m, &desc->matrix[desc->k * desc->k], desc->encode_tables);
 
+    if (isa_l_table_cache_init(desc) != 0) {
+        free(desc->encode_tables);
+        goto error;
+    }
+
     return desc;
 
 error:
@@ -216,14 +227,22 @@ static struct ec_backend_op_stubs isa_l_rs_vand_inv_op_stubs = {
     .INIT = isa_l_rs_vand_inv_init,
     .EXIT = isa_l_exit,
     .ISSYSTEMATIC = 1,
+    .DECODESDATAONLY = 1,
+    .ENCODESBYCOLUMN = 1,
     .ENCODE = isa_l_encode,
     .DECODE = isa_l_decode,
     .FRAGSNEEDED = isa_l_min_fragments,
     .RECONSTRUCT = isa_l_reconstruct,
+    .RECONSTRUCTMULTI = isa_l_reconstruct_multi,
+    .RECONSTRUCTPREPARE = isa_l_reconstruct_prepare,
+    .RECONSTRUCTPREPARED = isa_l_reconstruct_prepared,
+    .RECONSTRUCTRELEASE = isa_l_reconstruct_release,
+    .UPDATEPARITY = isa_l_update_parity,
     .ELEMENTSIZE = isa_l_element_size,
     .ISCOMPATIBLEWITH = isa_l_rs_vand_inv_is_compatible_with,
     .GETMETADATASIZE = get_backend_metadata_size_zero,
     .GETENCODEOFFSET = get_encode_offset_zero,
+    .GETTABLECACHESTATS = isa_l_get_table_cache_stats,
 };
 
 __attribute__((visibility("internal"))) struct ec_backend_common backend_isa_l_rs_vand_inv = {
@@ -128,6 +128,8 @@ static int jerasure_rs_cauchy_reconstruct(
     int *erased = NULL; /* k+m length list of erased frag ids */
     int *dm_ids = NULL; /* k length list of fragment ids */
     int *decoding_matrix = NULL; /* matrix for decoding */
+    struct ec_bm missing_bm = NEW_BM; /* bitmap form of missing_idxs */
+    int i;
 
     struct jerasure_rs_cauchy_descriptor *jerasure_desc
         = (struct jerasure_rs_cauchy_descriptor *)desc;
@@ -135,6 +137,13 @@ static int jerasure_rs_cauchy_reconstruct(
     m = jerasure_desc->m;
     w = jerasure_desc->w;
 
+    convert_list_to_bitmap(missing_idxs, &missing_bm);
+    for (i = 0; i < k; i++) {
+        if (bm_get_value(&missing_bm, i)) {
+            break;
+        }
+    }
+
     if (destination_idx < k) {
         dm_ids = (int *)alloc_zeroed_buffer(sizeof(int) * k);
         decoding_matrix = (int *)alloc_zeroed_buffer(sizeof(int *) * k * k * w * w);
@@ -159,6 +168,14 @@ static int jerasure_rs_cauchy_reconstruct(
              */
             goto out;
         }
+    } else if (i == k) {
+        /*
+         * All of the data is here, so the parity is just its own row of the
+         * coding bitmatrix applied to the data
+         */
+        jerasure_desc->jerasure_bitmatrix_dotprod(k, w,
+            jerasure_desc->bitmatrix + ((destination_idx - k) * k * w * w), NULL, destination_idx,
+            data, parity, blocksize, PYECC_CAUCHY_PACKETSIZE);
     } else {
         /*
          * If it is parity we are reconstructing, then just call decode.
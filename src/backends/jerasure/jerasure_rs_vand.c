@@ -114,6 +114,15 @@ static int jerasure_rs_vand_reconstruct(
     int *decoding_matrix = NULL; /* matrix for decoding */
 
     struct jerasure_rs_vand_descriptor *jerasure_desc = (struct jerasure_rs_vand_descriptor *)desc;
+    struct ec_bm missing_bm = NEW_BM;
+    int i;
+
+    convert_list_to_bitmap(missing_idxs, &missing_bm);
+    for (i = 0; i < jerasure_desc->k; i++) {
+        if (bm_get_value(&missing_bm, i)) {
+            break;
+        }
+    }
 
     if (destination_idx < jerasure_desc->k) {
         dm_ids = (int *)alloc_zeroed_buffer(sizeof(int) * jerasure_desc->k);
@@ -141,6 +150,15 @@ static int jerasure_rs_vand_reconstruct(
              */
             goto out;
         }
+    } else if (i == jerasure_desc->k) {
+        /*
+         * All of the data is here, so the parity is just its own row of the
+         * coding matrix applied to the data
+         */
+        jerasure_desc->jerasure_matrix_dotprod(jerasure_desc->k, jerasure_desc->w,
+            jerasure_desc->matrix + ((destination_idx - jerasure_desc->k) * jerasure_desc->k), NULL,
+            destination_idx, data, parity, blocksize);
+        goto parity_reconstr_out;
     } else {
         /*
          * If it is parity we are reconstructing, then just call decode.
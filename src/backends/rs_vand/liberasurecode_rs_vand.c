@@ -51,6 +51,11 @@ typedef int (*liberasurecode_rs_vand_decode_func)(
     int *, char **, char **, int, int, int *, int, int);
 typedef int (*liberasurecode_rs_vand_reconstruct_func)(
     int *, char **, char **, int, int, int *, int, int);
+typedef int (*liberasurecode_rs_vand_reconstruct_row_func)(int *, int, int, int *, int, int *);
+typedef int (*liberasurecode_rs_vand_reconstruct_from_row_func)(
+    int *, char **, char **, int, int, int *, int, int);
+typedef int (*liberasurecode_rs_vand_update_parity_func)(
+    int *, int, char *, char *, char **, int, int, int);
 typedef void (*init_liberasurecode_rs_vand_func)(int, int);
 typedef void (*deinit_liberasurecode_rs_vand_func)(void);
 typedef void (*free_systematic_matrix_func)(int *);
@@ -72,6 +77,13 @@ struct liberasurecode_rs_vand_descriptor {
     /* calls required for reconstruct */
     liberasurecode_rs_vand_reconstruct_func liberasurecode_rs_vand_reconstruct;
 
+    /* optional, for batched reconstruct */
+    liberasurecode_rs_vand_reconstruct_row_func liberasurecode_rs_vand_reconstruct_row;
+    liberasurecode_rs_vand_reconstruct_from_row_func liberasurecode_rs_vand_reconstruct_from_row;
+
+    /* optional, for parity updates */
+    liberasurecode_rs_vand_update_parity_func liberasurecode_rs_vand_update_parity;
+
     /* fields needed to hold state */
     int *matrix;
     int k;
@@ -116,6 +128,79 @@ static int liberasurecode_rs_vand_reconstruct(
     return 0;
 }
 
+/* The coefficients a batch of stripes missing the same fragments shares */
+struct liberasurecode_rs_vand_reconstruct_tables {
+    int missing_idxs[EC_MAX_FRAGMENTS + 1];
+    int destination_idx;
+    int row[];
+};
+
+static void *liberasurecode_rs_vand_reconstruct_prepare(
+    void *desc, int *missing_idxs, int destination_idx)
+{
+    struct liberasurecode_rs_vand_descriptor *rs_vand_desc
+        = (struct liberasurecode_rs_vand_descriptor *)desc;
+    struct liberasurecode_rs_vand_reconstruct_tables *tables = NULL;
+    int i;
+
+    if (NULL == rs_vand_desc->liberasurecode_rs_vand_reconstruct_row
+        || NULL == rs_vand_desc->liberasurecode_rs_vand_reconstruct_from_row) {
+        return NULL;
+    }
+    tables = malloc(sizeof(*tables) + sizeof(int) * rs_vand_desc->k);
+    if (NULL == tables) {
+        return NULL;
+    }
+    for (i = 0; i < EC_MAX_FRAGMENTS && missing_idxs[i] > -1; i++) {
+        tables->missing_idxs[i] = missing_idxs[i];
+    }
+    tables->missing_idxs[i] = -1;
+    tables->destination_idx = destination_idx;
+    if (rs_vand_desc->liberasurecode_rs_vand_reconstruct_row(rs_vand_desc->matrix,
+            rs_vand_desc->k, rs_vand_desc->m, missing_idxs, destination_idx, tables->row)
+        < 0) {
+        free(tables);
+        return NULL;
+    }
+
+    return tables;
+}
+
+static int liberasurecode_rs_vand_reconstruct_prepared(
+    void *desc, void *tables, char **data, char **parity, int blocksize)
+{
+    struct liberasurecode_rs_vand_descriptor *rs_vand_desc
+        = (struct liberasurecode_rs_vand_descriptor *)desc;
+    struct liberasurecode_rs_vand_reconstruct_tables *t
+        = (struct liberasurecode_rs_vand_reconstruct_tables *)tables;
+
+    return rs_vand_desc->liberasurecode_rs_vand_reconstruct_from_row(t->row, data, parity,
+        rs_vand_desc->k, rs_vand_desc->m, t->missing_idxs, t->destination_idx, blocksize);
+}
+
+static void liberasurecode_rs_vand_reconstruct_release(void *desc, void *tables)
+{
+    free(tables);
+}
+
+static int liberasurecode_rs_vand_update_parity(
+    void *desc, int data_idx, char *old_data, char *new_data, char **parity, int blocksize)
+{
+    struct liberasurecode_rs_vand_descriptor *rs_vand_desc
+        = (struct liberasurecode_rs_vand_descriptor *)desc;
+
+    if (NULL == rs_vand_desc->liberasurecode_rs_vand_update_parity) {
+        return -EBACKENDNOTSUPP;
+    }
+    if (rs_vand_desc->liberasurecode_rs_vand_update_parity(rs_vand_desc->matrix, data_idx,
+            old_data, new_data, parity, rs_vand_desc->k, rs_vand_desc->m, blocksize)
+        < 0) {
+        return -EINVALIDPARAMS;
+    }
+
+    return 0;
+}
+
 static int liberasurecode_rs_vand_min_fragments(
     void *desc, int *missing_idxs, int *fragments_to_exclude, int *fragments_needed)
 {
@@ -179,6 +264,9 @@ static void *liberasurecode_rs_vand_init(struct ec_backend_args *args, void *bac
         liberasurecode_rs_vand_encode_func encodep;
         liberasurecode_rs_vand_decode_func decodep;
         liberasurecode_rs_vand_reconstruct_func reconstructp;
+        liberasurecode_rs_vand_reconstruct_row_func reconstruct_rowp;
+        liberasurecode_rs_vand_reconstruct_from_row_func reconstruct_from_rowp;
+        liberasurecode_rs_vand_update_parity_func update_parityp;
         void *vptr;
     } func_handle = { .vptr = NULL };
 
@@ -232,6 +320,19 @@ static void *liberasurecode_rs_vand_init(struct ec_backend_args *args, void *bac
         goto error;
     }
 
+    /* Only needed to share the tables of a batched reconstruct */
+    func_handle.vptr = NULL;
+    func_handle.vptr = dlsym(backend_sohandle, "liberasurecode_rs_vand_reconstruct_row");
+    desc->liberasurecode_rs_vand_reconstruct_row = func_handle.reconstruct_rowp;
+    func_handle.vptr = NULL;
+    func_handle.vptr = dlsym(backend_sohandle, "liberasurecode_rs_vand_reconstruct_from_row");
+    desc->liberasurecode_rs_vand_reconstruct_from_row = func_handle.reconstruct_from_rowp;
+
+    /* Only needed for parity updates, which are refused without it */
+    func_handle.vptr = NULL;
+    func_handle.vptr = dlsym(backend_sohandle, "liberasurecode_rs_vand_update_parity");
+    desc->liberasurecode_rs_vand_update_parity = func_handle.update_parityp;
+
     desc->init_liberasurecode_rs_vand(desc->k, desc->m);
 
     desc->matrix = desc->make_systematic_matrix(desc->k, desc->m);
@@ -290,10 +391,16 @@ static struct ec_backend_op_stubs liberasurecode_rs_vand_op_stubs = {
     .INIT = liberasurecode_rs_vand_init,
     .EXIT = liberasurecode_rs_vand_exit,
     .ISSYSTEMATIC = 1,
+    .ENCODESBYCOLUMN = 1,
+    .CHKSUMSBYCHUNK = 1,
     .ENCODE = liberasurecode_rs_vand_encode,
     .DECODE = liberasurecode_rs_vand_decode,
     .FRAGSNEEDED = liberasurecode_rs_vand_min_fragments,
     .RECONSTRUCT = liberasurecode_rs_vand_reconstruct,
+    .RECONSTRUCTPREPARE = liberasurecode_rs_vand_reconstruct_prepare,
+    .RECONSTRUCTPREPARED = liberasurecode_rs_vand_reconstruct_prepared,
+    .RECONSTRUCTRELEASE = liberasurecode_rs_vand_reconstruct_release,
+    .UPDATEPARITY = liberasurecode_rs_vand_update_parity,
     .ELEMENTSIZE = liberasurecode_rs_vand_element_size,
     .ISCOMPATIBLEWITH = liberasurecode_rs_vand_is_compatible_with,
     .GETMETADATASIZE = get_backend_metadata_size_zero,
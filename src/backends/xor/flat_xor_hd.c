@@ -89,6 +89,18 @@ static int flat_xor_hd_reconstruct(
     return xor_reconstruct_one(xor_desc, data, parity, missing_idxs, destination_idx, blocksize);
 }
 
+static int flat_xor_hd_update_parity(
+    void *desc, int data_idx, char *old_data, char *new_data, char **parity, int blocksize)
+{
+    struct flat_xor_hd_descriptor *xdesc = (struct flat_xor_hd_descriptor *)desc;
+
+    xor_code_t *xor_desc = (xor_code_t *)xdesc->xor_desc;
+    if (xor_update_parity(xor_desc, data_idx, old_data, new_data, parity, blocksize) < 0) {
+        return -EINVALIDPARAMS;
+    }
+    return 0;
+}
+
 static int flat_xor_hd_check_reconstruct_fragments(
     void *desc, int *missing_idxs, int destination_idx)
 {
@@ -205,10 +217,13 @@ static struct ec_backend_op_stubs flat_xor_hd_op_stubs = {
     .INIT = flat_xor_hd_init,
     .EXIT = flat_xor_hd_exit,
     .ISSYSTEMATIC = 1,
+    .ENCODESBYCOLUMN = 1,
+    .CHKSUMSBYCHUNK = 1,
     .ENCODE = flat_xor_hd_encode,
     .DECODE = flat_xor_hd_decode,
     .FRAGSNEEDED = flat_xor_hd_min_fragments,
     .RECONSTRUCT = flat_xor_hd_reconstruct,
+    .UPDATEPARITY = flat_xor_hd_update_parity,
     .ELEMENTSIZE = flar_xor_hd_element_size,
     .ISCOMPATIBLEWITH = flat_xor_is_compatible_with,
     .GETMETADATASIZE = get_backend_metadata_size_zero,
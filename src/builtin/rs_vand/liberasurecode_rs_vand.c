@@ -409,6 +409,34 @@ int liberasurecode_rs_vand_encode(
     return 0;
 }
 
+// Parity is linear in the data: a data element going from old to new
+// changes each parity by its coefficient times old + new, so both are
+// multiplied in place instead of re-encoding the whole stripe
+int liberasurecode_rs_vand_update_parity(int *generator_matrix, int data_idx, char *old_data,
+    char *new_data, char **parity, int k, int m, int blocksize)
+{
+    int i;
+
+    if (data_idx < 0 || data_idx >= k) {
+        return -1;
+    }
+
+    for (i = k; i < k + m; i++) {
+        int mult = generator_matrix[(i * k) + data_idx];
+        if (mult == 0) {
+            continue;
+        } else if (mult == 1) {
+            region_xor(old_data, parity[i - k], blocksize);
+            region_xor(new_data, parity[i - k], blocksize);
+        } else {
+            region_multiply(old_data, parity[i - k], mult, 1, blocksize);
+            region_multiply(new_data, parity[i - k], mult, 1, blocksize);
+        }
+    }
+
+    return 0;
+}
+
 static char **get_first_k_available(char **data, char **parity, int *missing, int k)
 {
     int i, j;
@@ -480,13 +508,16 @@ int liberasurecode_rs_vand_decode(int *generator_matrix, char **data, char **par
     return 0;
 }
 
-int liberasurecode_rs_vand_reconstruct(int *generator_matrix, char **data, char **parity, int k,
-    int m, int *missing, int destination_idx, int blocksize)
+/*
+ * Fill row with the k coefficients that rebuild destination_idx from the
+ * first k available fragments.  They only depend on the erasure pattern, so
+ * many stripes that lost the same fragments can share them.
+ */
+int liberasurecode_rs_vand_reconstruct_row(
+    int *generator_matrix, int k, int m, int *missing, int destination_idx, int *row)
 {
     int *decoding_matrix = NULL;
     int *inverse_decoding_matrix = NULL;
-    char **first_k_available = NULL;
-    int *parity_row = NULL;
     int n = k + m;
     int *_missing = (int *)malloc(sizeof(int) * n);
     int i, j;
@@ -504,30 +535,39 @@ int liberasurecode_rs_vand_reconstruct(int *generator_matrix, char **data, char
         return -1;
     }
 
+    // With all of the data around, a parity is just its row of the generator
+    // matrix applied to the data: no decoding matrix to build or invert
+    for (i = 0; i < k; i++) {
+        if (_missing[i]) {
+            break;
+        }
+    }
+    if (destination_idx >= k && i == k) {
+        memcpy(row, &generator_matrix[(destination_idx * k)], sizeof(int) * k);
+        free(_missing);
+        return 0;
+    }
+
     decoding_matrix = (int *)malloc(sizeof(int) * k * k);
     inverse_decoding_matrix = (int *)malloc(sizeof(int) * k * k);
-    first_k_available = get_first_k_available(data, parity, _missing, k);
 
     create_decoding_matrix(generator_matrix, decoding_matrix, missing, k, m);
     gaussj_inversion(decoding_matrix, inverse_decoding_matrix, k);
 
-    // Rebuilding data is easy, just do a dot product using the inverted decoding
-    // matrix
+    // Rebuilding data is easy, just use the row of the inverted decoding matrix
     if (destination_idx < k) {
-        region_dot_product(first_k_available, data[destination_idx],
-            &inverse_decoding_matrix[(destination_idx * k)], k, blocksize);
+        memcpy(row, &inverse_decoding_matrix[(destination_idx * k)], sizeof(int) * k);
     } else {
         // Rebuilding parity is a little tricker, we first copy the corresp. parity row
         // and update it to reconstruct the parity with the first k available elements
 
         // Copy the parity entries for available data elements
         // from the original generator matrix
-        parity_row = (int *)malloc(sizeof(int) * k);
-        memset(parity_row, 0, sizeof(int) * k);
+        memset(row, 0, sizeof(int) * k);
         j = 0;
         for (i = 0; i < k; i++) {
             if (!_missing[i]) {
-                parity_row[j] = generator_matrix[(destination_idx * k) + i];
+                row[j] = generator_matrix[(destination_idx * k) + i];
                 j++;
             }
         }
@@ -538,21 +578,62 @@ int liberasurecode_rs_vand_reconstruct(int *generator_matrix, char **data, char
         while (missing[i] > -1) {
             if (missing[i] < k) {
                 for (j = 0; j < k; j++) {
-                    parity_row[j]
-                        ^= rs_galois_mult(generator_matrix[(destination_idx * k) + missing[i]],
-                            inverse_decoding_matrix[(missing[i] * k) + j]);
+                    row[j] ^= rs_galois_mult(generator_matrix[(destination_idx * k) + missing[i]],
+                        inverse_decoding_matrix[(missing[i] * k) + j]);
                 }
             }
             i++;
         }
-        region_dot_product(
-            first_k_available, parity[destination_idx - k], parity_row, k, blocksize);
     }
-    free(parity_row);
     free(decoding_matrix);
     free(inverse_decoding_matrix);
+    free(_missing);
+
+    return 0;
+}
+
+/*
+ * Rebuild destination_idx with a row from liberasurecode_rs_vand_reconstruct_row()
+ */
+int liberasurecode_rs_vand_reconstruct_from_row(int *row, char **data, char **parity, int k,
+    int m, int *missing, int destination_idx, int blocksize)
+{
+    char **first_k_available = NULL;
+    int n = k + m;
+    int *_missing = (int *)malloc(sizeof(int) * n);
+    int i = 0;
+
+    memset(_missing, 0, sizeof(int) * n);
+
+    while (missing[i] > -1) {
+        _missing[missing[i]] = 1;
+        i++;
+    }
+
+    first_k_available = get_first_k_available(data, parity, _missing, k);
+    region_dot_product(first_k_available,
+        destination_idx < k ? data[destination_idx] : parity[destination_idx - k], row, k,
+        blocksize);
+
     free(first_k_available);
     free(_missing);
 
     return 0;
 }
+
+int liberasurecode_rs_vand_reconstruct(int *generator_matrix, char **data, char **parity, int k,
+    int m, int *missing, int destination_idx, int blocksize)
+{
+    int *row = (int *)malloc(sizeof(int) * k);
+    int ret;
+
+    ret = liberasurecode_rs_vand_reconstruct_row(
+        generator_matrix, k, m, missing, destination_idx, row);
+    if (ret == 0) {
+        ret = liberasurecode_rs_vand_reconstruct_from_row(
+            row, data, parity, k, m, missing, destination_idx, blocksize);
+    }
+    free(row);
+
+    return ret;
+}
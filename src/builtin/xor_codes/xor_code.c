@@ -242,6 +242,29 @@ __attribute__((visibility("internal"))) int *get_missing_data(
     return missing_data;
 }
 
+/*
+ * Fold the change of one data symbol, from old_data to new_data, into the
+ * parities that cover it
+ */
+int xor_update_parity(xor_code_t *code_desc, int data_idx, char *old_data, char *new_data,
+    char **parity, int blocksize)
+{
+    int i;
+
+    if (data_idx < 0 || data_idx >= code_desc->k) {
+        return -1;
+    }
+
+    for (i = 0; i < code_desc->m; i++) {
+        if (is_data_in_parity(data_idx, code_desc->parity_bms[i])) {
+            xor_bufs_and_store(old_data, parity[i], blocksize);
+            xor_bufs_and_store(new_data, parity[i], blocksize);
+        }
+    }
+
+    return 0;
+}
+
 /*
  * Reconstruct a single missing symbol, given other symbols may be missing
  */
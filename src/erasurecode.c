@@ -35,6 +35,7 @@
 #include "erasurecode_stdinc.h"
 #include "list.h"
 #include <assert.h>
+#include <limits.h>
 #include <zlib.h>
 
 #include "alg_sig.h"
@@ -72,53 +73,277 @@ static ec_backend_t ec_backends_supported[] = {
 
 /* =~=*=~==~=*=~==~=*=~= EC backend instance management =~=*=~==~=*=~==~=*= */
 
-/* Registered erasure code backend instances */
-static SLIST_HEAD(backend_list, ec_backend) active_instances
-    = SLIST_HEAD_INITIALIZER(active_instances);
+/*
+ * Stored in the spare slot of the encoded data array when the fragments
+ * were taken from the buffer pool, see liberasurecode_encode_cleanup()
+ */
+static char pooled_fragments_marker;
+
+/*
+ * Number of instances with EC_OPT_BUFFER_POOL set, guarded by the
+ * registry write lock.  When it drops to zero the calling thread's pool
+ * goes away with its buffers.
+ */
+static int pooled_instances = 0;
+
+/*
+ * Registered erasure code backend instances
+ *
+ * Instances live in a table indexed by the low bits of their descriptor;
+ * the high bits hold a generation count bumped whenever a slot is reused,
+ * so a stale descriptor never resolves to a newer instance.
+ */
+#define EC_DESC_SLOT_BITS 16
+#define EC_DESC_SLOT_MASK ((1 << EC_DESC_SLOT_BITS) - 1)
+#define EC_DESC_MAX_SLOTS EC_DESC_SLOT_MASK
+#define EC_DESC_MAX_GEN (INT_MAX >> EC_DESC_SLOT_BITS)
+
+struct ec_desc_slot {
+    ec_backend_t instance;
+    int gen; /* generation of the current/next descriptor */
+    int next_free; /* next free slot, -1 terminates */
+};
+
+static struct ec_desc_slot *desc_table = NULL;
+static int desc_table_size = 0;
+static int desc_free_head = -1;
+
 /**
- * This lock keeps us thread-safe. It needs to guard not only read/write
- * access to the active_instances list, but also the ec_backend instances
- * that populate it or will populate it.
+ * The instance registry lock keeps us thread-safe. It needs to guard not
+ * only the descriptor table, but also the ec_backend instances that
+ * populate it or will populate it.
  *
  * Note that this includes calls to backend initializers; we can't trust
- * that they'll be thread-safe.
+ * that they'll be thread-safe, nor that exit() of one instance leaves the
+ * others of the same backend alone (jerasure tears down shared galois
+ * tables), so writers exclude all readers.
+ *
+ * Readers only touch their own, per-thread state: a reader publishes its
+ * nesting count and then checks for a writer; a writer raises its flag and
+ * then sleeps until every reader count drops to zero.  A reader that drops
+ * its count to zero while a writer is active wakes it up.  Read-side
+ * sections nest, as some entry points call others (e.g.
+ * is_invalid_fragment()).
  */
-static rwlock_t active_instances_rwlock = RWLOCK_INITIALIZER;
+struct ec_instance_reader {
+    int nesting; /* read-side sections held by this thread */
+    SLIST_ENTRY(ec_instance_reader) link;
+} __attribute__((aligned(EC_CACHELINE_SIZE)));
+
+static pthread_mutex_t instances_writer_lock = PTHREAD_MUTEX_INITIALIZER;
+static int instances_writer_active = 0;
+static pthread_mutex_t instances_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t instances_drained = PTHREAD_COND_INITIALIZER;
+static SLIST_HEAD(reader_list, ec_instance_reader) instance_readers
+    = SLIST_HEAD_INITIALIZER(instance_readers);
+static pthread_once_t instance_reader_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t instance_reader_key;
+static int instance_reader_key_valid = 0;
+
+static void destroy_instance_reader(void *arg)
+{
+    struct ec_instance_reader *reader = (struct ec_instance_reader *)arg;
+
+    pthread_mutex_lock(&instances_writer_lock);
+    SLIST_REMOVE(&instance_readers, reader, ec_instance_reader, link);
+    pthread_mutex_unlock(&instances_writer_lock);
+    free(reader);
+}
+
+static void create_instance_reader_key(void)
+{
+    instance_reader_key_valid
+        = (pthread_key_create(&instance_reader_key, destroy_instance_reader) == 0);
+}
+
+static struct ec_instance_reader *get_instance_reader(void)
+{
+    struct ec_instance_reader *reader;
+
+    pthread_once(&instance_reader_key_once, create_instance_reader_key);
+    if (!instance_reader_key_valid) {
+        return NULL;
+    }
+
+    reader = (struct ec_instance_reader *)pthread_getspecific(instance_reader_key);
+    if (NULL != reader) {
+        return reader;
+    }
+
+    if (posix_memalign((void **)&reader, EC_CACHELINE_SIZE, sizeof(*reader)) != 0) {
+        return NULL;
+    }
+    memset(reader, 0, sizeof(*reader));
+    if (pthread_setspecific(instance_reader_key, reader) != 0) {
+        free(reader);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&instances_writer_lock);
+    SLIST_INSERT_HEAD(&instance_readers, reader, link);
+    pthread_mutex_unlock(&instances_writer_lock);
+
+    return reader;
+}
+
+/* Leave the outermost read-side section, waking a writer waiting on us */
+static void instance_reader_drop(struct ec_instance_reader *reader)
+{
+    __atomic_store_n(&reader->nesting, 0, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&instances_writer_active, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&instances_drain_lock);
+        pthread_cond_broadcast(&instances_drained);
+        pthread_mutex_unlock(&instances_drain_lock);
+    }
+}
+
+static int instances_read_lock(void)
+{
+    struct ec_instance_reader *reader = get_instance_reader();
+
+    if (NULL == reader) {
+        return -ENOMEM;
+    }
+
+    if (reader->nesting > 0) {
+        /* Already inside a read-side section, writers are waiting on us */
+        __atomic_store_n(&reader->nesting, reader->nesting + 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    for (;;) {
+        __atomic_store_n(&reader->nesting, 1, __ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&instances_writer_active, __ATOMIC_SEQ_CST)) {
+            return 0;
+        }
+
+        /* Back off and wait for the writer to finish */
+        instance_reader_drop(reader);
+        pthread_mutex_lock(&instances_writer_lock);
+        pthread_mutex_unlock(&instances_writer_lock);
+    }
+}
+
+static void instances_read_unlock(void)
+{
+    struct ec_instance_reader *reader
+        = (struct ec_instance_reader *)pthread_getspecific(instance_reader_key);
+
+    assert(NULL != reader && reader->nesting > 0);
+    if (reader->nesting > 1) {
+        __atomic_store_n(&reader->nesting, reader->nesting - 1, __ATOMIC_RELAXED);
+        return;
+    }
+    instance_reader_drop(reader);
+}
+
+static int instances_write_lock(void)
+{
+    struct ec_instance_reader *reader;
+    int rc = pthread_mutex_lock(&instances_writer_lock);
+
+    if (rc) {
+        /* Callers hand this back to the user: keep to our error codes */
+        log_error("Could not lock the instance registry: %s", strerror(rc));
+        return -EBACKENDINUSE;
+    }
+
+    __atomic_store_n(&instances_writer_active, 1, __ATOMIC_SEQ_CST);
+
+    /* Wait for in-flight readers; new ones back off until we are done */
+    pthread_mutex_lock(&instances_drain_lock);
+    SLIST_FOREACH(reader, &instance_readers, link)
+    {
+        while (__atomic_load_n(&reader->nesting, __ATOMIC_SEQ_CST) != 0) {
+            pthread_cond_wait(&instances_drained, &instances_drain_lock);
+        }
+    }
+    pthread_mutex_unlock(&instances_drain_lock);
+
+    return 0;
+}
 
-/* Backend instance id */
-static int next_backend_desc = 0;
+static void instances_write_unlock(void)
+{
+    __atomic_store_n(&instances_writer_active, 0, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&instances_writer_lock);
+}
 
 /**
  * Look up a backend instance by descriptor
  *
  * @returns pointer to a registered liberasurecode instance
- * The caller must hold active_instances_rwlock
+ * The caller must hold the instance registry lock
  */
 ec_backend_t liberasurecode_backend_instance_get_by_desc(int desc)
 {
-    struct ec_backend *b = NULL;
-    SLIST_FOREACH(b, &active_instances, link)
-    {
-        if (b->idesc == desc)
-            break;
-    }
+    int slot = (desc & EC_DESC_SLOT_MASK) - 1;
+    ec_backend_t b;
+
+    if (desc <= 0 || slot < 0 || slot >= desc_table_size)
+        return NULL;
+
+    b = desc_table[slot].instance;
+    if (NULL == b || b->idesc != desc)
+        return NULL;
     return b;
 }
 
 /**
- * Allocated backend instance descriptor
+ * Register a backend instance
  *
- * Returns a unique descriptor for a new backend.
- * The caller must hold active_instances_rwlock
+ * Returns a unique descriptor for the new backend, -error otherwise.
+ * The caller must hold the instance registry lock for writing.
  */
-static int liberasurecode_backend_alloc_desc(void)
+static int liberasurecode_backend_alloc_desc(ec_backend_t instance)
 {
-    for (;;) {
-        if (++next_backend_desc <= 0)
-            next_backend_desc = 1;
-        if (!liberasurecode_backend_instance_get_by_desc(next_backend_desc))
-            return next_backend_desc;
+    int slot;
+
+    if (desc_free_head < 0) {
+        /* Readers are excluded, so the table may move */
+        int i, new_size = desc_table_size ? desc_table_size * 2 : 64;
+        struct ec_desc_slot *new_table;
+
+        if (new_size > EC_DESC_MAX_SLOTS)
+            new_size = EC_DESC_MAX_SLOTS;
+        if (new_size <= desc_table_size)
+            return -ENOMEM;
+
+        new_table = realloc(desc_table, sizeof(*new_table) * new_size);
+        if (NULL == new_table)
+            return -ENOMEM;
+
+        for (i = desc_table_size; i < new_size; i++) {
+            new_table[i].instance = NULL;
+            new_table[i].gen = 0;
+            new_table[i].next_free = (i + 1 < new_size) ? i + 1 : -1;
+        }
+        desc_free_head = desc_table_size;
+        desc_table = new_table;
+        desc_table_size = new_size;
     }
+
+    slot = desc_free_head;
+    desc_free_head = desc_table[slot].next_free;
+    desc_table[slot].instance = instance;
+
+    return (desc_table[slot].gen << EC_DESC_SLOT_BITS) | (slot + 1);
+}
+
+/**
+ * Unregister a backend instance, retiring its descriptor
+ *
+ * The caller must hold the instance registry lock for writing.
+ */
+static void liberasurecode_backend_free_desc(int desc)
+{
+    int slot = (desc & EC_DESC_SLOT_MASK) - 1;
+
+    desc_table[slot].instance = NULL;
+    if (++desc_table[slot].gen > EC_DESC_MAX_GEN)
+        desc_table[slot].gen = 0;
+    desc_table[slot].next_free = desc_free_head;
+    desc_free_head = slot;
 }
 
 /* =~=*=~==~=*=~== liberasurecode backend API helpers =~=*=~==~=*=~== */
@@ -161,7 +386,23 @@ void __attribute__((constructor)) liberasurecode_init(void)
     openlog("liberasurecode", LOG_PID | LOG_CONS, LOG_USER);
 }
 
-void __attribute__((destructor)) liberasurecode_exit(void) { closelog(); }
+void __attribute__((destructor)) liberasurecode_exit(void)
+{
+    /* Other threads free their pools on exit, but not the main thread */
+    release_thread_buffer_pool();
+    delete_thread_buffer_pool_key();
+    /* Threads outliving a dlclose() must not call back into us */
+    if (instance_reader_key_valid) {
+        void *reader = pthread_getspecific(instance_reader_key);
+
+        if (NULL != reader) {
+            destroy_instance_reader(reader);
+        }
+        pthread_key_delete(instance_reader_key);
+        instance_reader_key_valid = 0;
+    }
+    closelog();
+}
 
 /* =~=*=~==~=*=~= liberasurecode frontend API implementation =~=*=~==~=*=~== */
 
@@ -248,7 +489,7 @@ int liberasurecode_instance_create(const ec_backend_id_t id, struct ec_args *arg
         }
     }
 
-    rc = rwlock_wrlock(&active_instances_rwlock);
+    rc = instances_write_lock();
     if (rc == 0) {
         /* Call private init() for the backend */
         instance->desc.backend_desc
@@ -259,23 +500,25 @@ int liberasurecode_instance_create(const ec_backend_id_t id, struct ec_args *arg
             goto register_out;
         }
 
-        instance->idesc = liberasurecode_backend_alloc_desc();
+        /* Register instance and return a descriptor/instance id */
+        instance->idesc = liberasurecode_backend_alloc_desc(instance);
         if (instance->idesc <= 0) {
+            desc = instance->idesc;
             instance->common.ops->exit(instance->desc.backend_desc);
             liberasurecode_backend_close(instance);
             free(instance);
             goto register_out;
         }
-        /* Register instance and return a descriptor/instance id */
         desc = instance->idesc;
-        SLIST_INSERT_HEAD(&active_instances, instance, link);
     } else {
+        liberasurecode_backend_close(instance);
         free(instance);
+        desc = rc;
         goto exit;
     }
 
 register_out:
-    rwlock_unlock(&active_instances_rwlock);
+    instances_write_unlock();
 exit:
     return desc;
 }
@@ -289,14 +532,18 @@ int liberasurecode_instance_destroy(int desc)
 {
     ec_backend_t instance = NULL; /* instance to destroy */
     int rc = 0; /* return code */
+    int release_pool = 0;
 
-    rc = rwlock_wrlock(&active_instances_rwlock);
+    rc = instances_write_lock();
     if (rc == 0) {
         instance = liberasurecode_backend_instance_get_by_desc(desc);
         if (NULL == instance) {
-            rwlock_unlock(&active_instances_rwlock);
+            instances_write_unlock();
             return -EBACKENDNOTAVAIL;
         }
+        if (instance->opts[EC_OPT_BUFFER_POOL] > 0) {
+            release_pool = (--pooled_instances == 0);
+        }
 
         /* Call private exit() for the backend */
         instance->common.ops->exit(instance->desc.backend_desc);
@@ -305,179 +552,139 @@ int liberasurecode_instance_destroy(int desc)
         liberasurecode_backend_close(instance);
 
         /* Remove instance from registry */
-        SLIST_REMOVE(&active_instances, instance, ec_backend, link);
+        liberasurecode_backend_free_desc(desc);
         free(instance);
-        rwlock_unlock(&active_instances_rwlock);
+        instances_write_unlock();
+    }
+    if (release_pool) {
+        release_thread_buffer_pool();
     }
     return rc;
 }
 
 /**
- * Cleanup structures allocated by librasurecode_encode
- *
- * The caller has no context, so cannot safely free memory
- * allocated by liberasurecode, so it must pass the
- * deallocation responsibility back to liberasurecode.
+ * Set a frontend option on a liberasurecode instance
  *
  * @param desc - liberasurecode descriptor/handle
  *        from liberasurecode_instance_create()
- * @param encoded_data - (char **) array of k data
- *        fragments (char *), allocated by liberasurecode_encode
- * @param encoded_parity - (char **) array of m parity
- *        fragments (char *), allocated by liberasurecode_encode
- * @return 0 in success; -error otherwise
+ * @param opt - one of the options defined by ec_instance_option_t
+ * @param value - new value for the option
+ *
+ * @return 0 on success, -error code otherwise
  */
-int liberasurecode_encode_cleanup(int desc, char **encoded_data, char **encoded_parity)
+int liberasurecode_instance_set_option(int desc, ec_instance_option_t opt, int value)
 {
-    int i, k, m;
+    if (opt < 0 || opt >= EC_OPTS_MAX) {
+        log_error("Invalid instance option %d", opt);
+        return -EINVALIDPARAMS;
+    }
 
-    int rc = rwlock_rdlock(&active_instances_rwlock);
+    if (value < 0) {
+        log_error("Invalid value %d for instance option %d", value, opt);
+        return -EINVALIDPARAMS;
+    }
+
+    int release_pool = 0;
+    int rc = instances_write_lock();
     if (rc) {
         /* Should just be EDEADLOCK */
-        return rc;
+        return rc < 0 ? rc : -rc;
     }
     ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
     if (NULL == instance) {
-        rwlock_unlock(&active_instances_rwlock);
+        instances_write_unlock();
         return -EBACKENDNOTAVAIL;
     }
 
-    k = instance->args.uargs.k;
-    m = instance->args.uargs.m;
-    rwlock_unlock(&active_instances_rwlock);
-
-    if (encoded_data) {
-        for (i = 0; i < k; i++) {
-            free(encoded_data[i]);
-        }
-
-        free(encoded_data);
+    if (opt == EC_OPT_BUFFER_POOL) {
+        release_pool = instance->opts[opt] > 0 && value == 0 && --pooled_instances == 0;
+        pooled_instances += instance->opts[opt] == 0 && value > 0;
     }
+    instance->opts[opt] = value;
 
-    if (encoded_parity) {
-        for (i = 0; i < m; i++) {
-            free(encoded_parity[i]);
-        }
-        free(encoded_parity);
+    instances_write_unlock();
+    if (release_pool) {
+        release_thread_buffer_pool();
     }
-
     return 0;
 }
 
 /**
- * Erasure encode a data buffer
+ * Get the decode/reconstruct table cache statistics of a liberasurecode
+ * instance
  *
  * @param desc - liberasurecode descriptor/handle
  *        from liberasurecode_instance_create()
- * @param orig_data - data to encode
- * @param orig_data_size - length of data to encode
- * @param encoded_data - pointer to _output_ array (char **) of k data
- *        fragments (char *), allocated by the callee
- * @param encoded_parity - pointer to _output_ array (char **) of m parity
- *        fragments (char *), allocated by the callee
- * @param fragment_len - pointer to _output_ length of each fragment, assuming
- *        all fragments are the same length
+ * @param stats - _output_ cache statistics
  *
- * @return 0 on success, -error code otherwise
+ * @return 0 on success, -EBACKENDNOTSUPP if the backend keeps no such
+ *         cache, -error code otherwise
  */
-int liberasurecode_encode(int desc, const char *orig_data, uint64_t orig_data_size, /* input */
-    char ***encoded_data, char ***encoded_parity, /* output */
-    uint64_t *fragment_len) /* output */
+int liberasurecode_get_table_cache_stats(int desc, struct ec_table_cache_stats *stats)
 {
-    int k, m;
-    int ret = 0; /* return code */
-
-    int blocksize = 0; /* length of each of k data elements */
-
-    if (orig_data == NULL) {
-        log_error("Pointer to data buffer is null!");
-        ret = -EINVALIDPARAMS;
-        goto out;
-    }
-
-    if (encoded_data == NULL) {
-        log_error("Pointer to encoded data buffers is null!");
-        return -EINVALIDPARAMS;
-    }
+    int ret = 0;
 
-    if (encoded_parity == NULL) {
-        log_error("Pointer to encoded parity buffers is null!");
+    if (NULL == stats) {
+        log_error("Invalid params passed to liberasurecode_get_table_cache_stats!");
         return -EINVALIDPARAMS;
     }
 
-    if (fragment_len == NULL) {
-        log_error("Pointer to fragment length is null!");
-        ret = -EINVALIDPARAMS;
-        goto out;
-    }
-
-    int rc = rwlock_rdlock(&active_instances_rwlock);
-    if (rc != 0) {
+    int rc = instances_read_lock();
+    if (rc) {
         /* Should just be EDEADLOCK */
-        ret = rc < 0 ? rc : -rc;
-        goto out;
+        return rc < 0 ? rc : -rc;
     }
     ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
     if (NULL == instance) {
         ret = -EBACKENDNOTAVAIL;
-        goto unlock;
+    } else if (NULL == instance->common.ops->get_table_cache_stats) {
+        ret = -EBACKENDNOTSUPP;
+    } else {
+        ret = instance->common.ops->get_table_cache_stats(instance->desc.backend_desc, stats);
     }
 
-    k = instance->args.uargs.k;
-    m = instance->args.uargs.m;
-
-    /*
-     * Allocate arrays for data, parity and missing_idxs
-     */
-    *encoded_data = (char **)alloc_zeroed_buffer(sizeof(char *) * k);
-    if (NULL == *encoded_data) {
-        log_error("Could not allocate data buffer!");
-        goto unlock;
-    }
+    instances_read_unlock();
+    return ret;
+}
 
-    *encoded_parity = (char **)alloc_zeroed_buffer(sizeof(char *) * m);
-    if (NULL == *encoded_parity) {
-        log_error("Could not allocate parity buffer!");
-        goto unlock;
-    }
+/*
+ * Release the fragments and pointer arrays of one encode, however they
+ * were allocated
+ */
+static void free_encoded_fragments(int k, int m, char **encoded_data, char **encoded_parity)
+{
+    int i;
+    int pool_depth = 0;
 
-    ret = prepare_fragments_for_encode(
-        instance, k, m, orig_data, orig_data_size, *encoded_data, *encoded_parity, &blocksize);
-    if (ret < 0) {
-        // ensure encoded_data/parity point the head of fragment_ptr
-        get_fragment_ptr_array_from_data(*encoded_data, *encoded_data, k);
-        get_fragment_ptr_array_from_data(*encoded_parity, *encoded_parity, m);
-        goto unlock;
+    if (encoded_data && encoded_data[k] == (char *)encoded_data) {
+        /* Fragments and pointer arrays all live in one slab */
+        free(encoded_data);
+        return;
     }
 
-    /* call the backend encode function passing it desc instance */
-    ret = instance->common.ops->encode(
-        instance->desc.backend_desc, *encoded_data, *encoded_parity, blocksize);
-    if (ret < 0) {
-        // ensure encoded_data/parity point the head of fragment_ptr
-        get_fragment_ptr_array_from_data(*encoded_data, *encoded_data, k);
-        get_fragment_ptr_array_from_data(*encoded_parity, *encoded_parity, m);
-        goto unlock;
+    /* Fragments came from the buffer pool if the encode marked them so */
+    if (encoded_data && encoded_data[k] == &pooled_fragments_marker) {
+        pool_depth = 1;
     }
 
-    ret = finalize_fragments_after_encode(
-        instance, k, m, blocksize, orig_data_size, *encoded_data, *encoded_parity);
+    if (encoded_data) {
+        for (i = 0; i < k; i++) {
+            free_fragment_buffer_pooled(encoded_data[i], pool_depth);
+        }
 
-    *fragment_len = get_fragment_size((*encoded_data)[0]);
+        free(encoded_data);
+    }
 
-unlock:
-    rwlock_unlock(&active_instances_rwlock);
-out:
-    if (ret) {
-        /* Cleanup the allocations we have done */
-        liberasurecode_encode_cleanup(desc, *encoded_data, *encoded_parity);
-        log_error("Error in liberasurecode_encode %d", ret);
+    if (encoded_parity) {
+        for (i = 0; i < m; i++) {
+            free_fragment_buffer_pooled(encoded_parity[i], pool_depth);
+        }
+        free(encoded_parity);
     }
-    return ret;
 }
 
 /**
- * Cleanup structures allocated by librasurecode_decode
+ * Cleanup structures allocated by librasurecode_encode
  *
  * The caller has no context, so cannot safely free memory
  * allocated by liberasurecode, so it must pass the
@@ -485,288 +692,1696 @@ out:
  *
  * @param desc - liberasurecode descriptor/handle
  *        from liberasurecode_instance_create()
- * @param data - (char *) buffer of data decoded by
- *        librasurecode_decode
+ * @param encoded_data - (char **) array of k data
+ *        fragments (char *), allocated by liberasurecode_encode
+ * @param encoded_parity - (char **) array of m parity
+ *        fragments (char *), allocated by liberasurecode_encode
  * @return 0 in success; -error otherwise
  */
-int liberasurecode_decode_cleanup(int desc, char *data)
+int liberasurecode_encode_cleanup(int desc, char **encoded_data, char **encoded_parity)
 {
-    int rc = rwlock_rdlock(&active_instances_rwlock);
+    int k, m;
+
+    int rc = instances_read_lock();
     if (rc) {
         /* Should just be EDEADLOCK */
         return rc;
     }
     ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
-    rwlock_unlock(&active_instances_rwlock);
     if (NULL == instance) {
+        instances_read_unlock();
         return -EBACKENDNOTAVAIL;
     }
 
-    free(data);
+    k = instance->args.uargs.k;
+    m = instance->args.uargs.m;
+    instances_read_unlock();
+
+    free_encoded_fragments(k, m, encoded_data, encoded_parity);
 
     return 0;
 }
 
-/**
- * Reconstruct original data from a set of k encoded fragments
- *
- * @param desc - liberasurecode descriptor/handle
- *        from liberasurecode_instance_create()
- * @param available_fragments - erasure encoded fragments (> = k)
- * @param num_fragments - number of fragments being passed in
- * @param fragment_len - length of each fragment (assume they are the same)
- * @param force_metadata_checks - force fragment metadata checks (default: 0)
- * @param out_data - _output_ pointer to decoded data
- * @param out_data_len - _output_ length of decoded output
- * @return 0 on success, -error code otherwise
+/* Smallest column range worth handing to a thread of its own */
+#define EC_ENCODE_MIN_COLUMNS (256 * 1024)
+/* Column ranges start at multiples of this, keeping the kernels' alignment */
+#define EC_ENCODE_COLUMN_ALIGN 64
+/* Most column ranges one encode is split into */
+#define EC_ENCODE_MAX_SHARES 64
+
+/* A range of columns of a stripe, encoded by one thread */
+struct encode_share {
+    ec_backend_t instance;
+    char **data;
+    char **parity;
+    int offset; /* first column of the range */
+    int len; /* number of columns in the range */
+    const struct ec_fused_chksum *fc; /* checksum the range as it is encoded */
+    uint32_t *crc; /* per-fragment CRCs of the range, with fc set */
+    int ret;
+    int started; /* runs on its own thread */
+    pthread_t thread;
+};
+
+static void *encode_share(void *arg)
+{
+    struct encode_share *share = (struct encode_share *)arg;
+    ec_backend_t instance = share->instance;
+    const struct ec_fused_chksum *fc = share->fc;
+    int k = instance->args.uargs.k;
+    int m = instance->args.uargs.m;
+    char *data[EC_MAX_FRAGMENTS];
+    char *parity[EC_MAX_FRAGMENTS];
+    int chunk = NULL == fc ? share->len : EC_FUSED_CHKSUM_CHUNK;
+    int off, i;
+
+    share->ret = 0;
+    for (off = 0; off < share->len && share->ret == 0; off += chunk) {
+        int n = share->len - off > chunk ? chunk : share->len - off;
+
+        for (i = 0; i < k; i++) {
+            data[i] = share->data[i] + share->offset + off;
+        }
+        for (i = 0; i < m; i++) {
+            parity[i] = share->parity[i] + share->offset + off;
+        }
+        share->ret = instance->common.ops->encode(instance->desc.backend_desc, data, parity, n);
+        if (NULL == fc || share->ret != 0) {
+            continue;
+        }
+
+        /* What was just read and written is still in cache */
+        for (i = fc->have_data ? k : 0; i < k + m; i++) {
+            char *col = i < k ? data[i] : parity[i - k];
+            share->crc[i] = fused_chksum_update(fc, share->crc[i], col, n);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Run the backend encode over the payloads in data and parity.  With
+ * EC_OPT_WORKER_THREADS set, a backend that encodes column by column and
+ * a large enough blocksize, the columns are split into aligned ranges
+ * encoded in parallel, the calling thread taking the first one.
+ *
+ * With fc set, the payload CRCs fc does not hold yet are computed a chunk
+ * of columns at a time, right after the chunk is encoded, and the CRCs of
+ * the ranges are then joined with crc32_combine().  A single-threaded
+ * encode on a backend without chksums_by_chunk is made in one call and
+ * checksummed afterwards instead.
+ */
+static int encode_stripe(ec_backend_t instance, char **data, char **parity, int blocksize,
+    struct ec_fused_chksum *fc)
+{
+    struct encode_share shares[EC_ENCODE_MAX_SHARES];
+    struct ec_fused_chksum *late_fc = NULL;
+    int k = instance->args.uargs.k;
+    int m = instance->args.uargs.m;
+    int num_shares = instance->opts[EC_OPT_WORKER_THREADS];
+    uint32_t *crcs = NULL;
+    int share_len;
+    int ret = 0;
+    int i, j;
+
+    if (num_shares > blocksize / EC_ENCODE_MIN_COLUMNS) {
+        num_shares = blocksize / EC_ENCODE_MIN_COLUMNS;
+    }
+    if (num_shares > EC_ENCODE_MAX_SHARES) {
+        num_shares = EC_ENCODE_MAX_SHARES;
+    }
+    if (!instance->common.ops->encodes_by_column
+        || (num_shares < 2 && (NULL == fc || !instance->common.ops->chksums_by_chunk))) {
+        ret = instance->common.ops->encode(instance->desc.backend_desc, data, parity, blocksize);
+        if (NULL != fc && ret == 0) {
+            for (j = fc->have_data ? k : 0; j < k + m; j++) {
+                char *payload = j < k ? data[j] : parity[j - k];
+                fc->crc[j] = fused_chksum_update(fc, 0, payload, blocksize);
+            }
+        }
+        return ret;
+    }
+    if (num_shares < 2) {
+        num_shares = 1;
+    }
+
+    /*
+     * The legacy CRC has no combine function, so its ranges can not be
+     * checksummed apart; nor can they without memory for the partial CRCs.
+     * The payloads get checksummed after the encode instead.
+     */
+    if (NULL != fc) {
+        if (!fc->legacy) {
+            crcs = calloc(num_shares * (k + m), sizeof(uint32_t));
+        }
+        if (NULL == crcs) {
+            late_fc = fc;
+            fc = NULL;
+        }
+    }
+
+    share_len = (blocksize / num_shares + EC_ENCODE_COLUMN_ALIGN - 1)
+        & ~(EC_ENCODE_COLUMN_ALIGN - 1);
+    for (i = 0; i < num_shares; i++) {
+        shares[i].instance = instance;
+        shares[i].data = data;
+        shares[i].parity = parity;
+        shares[i].offset = i * share_len;
+        shares[i].len = i == num_shares - 1 ? blocksize - shares[i].offset : share_len;
+        shares[i].fc = fc;
+        shares[i].crc = NULL == crcs ? NULL : crcs + i * (k + m);
+        shares[i].ret = 0;
+        shares[i].started = 0;
+    }
+
+    /* A range whose thread can not be started is encoded inline */
+    for (i = 1; i < num_shares; i++) {
+        shares[i].started = pthread_create(&shares[i].thread, NULL, encode_share, &shares[i]) == 0;
+    }
+    encode_share(&shares[0]);
+    for (i = 1; i < num_shares; i++) {
+        if (shares[i].started) {
+            pthread_join(shares[i].thread, NULL);
+        } else {
+            encode_share(&shares[i]);
+        }
+    }
+
+    for (i = 0; i < num_shares && ret == 0; i++) {
+        ret = shares[i].ret;
+    }
+
+    if (NULL != crcs) {
+        for (j = fc->have_data ? k : 0; j < k + m; j++) {
+            fc->crc[j] = crcs[j];
+            for (i = 1; i < num_shares; i++) {
+                fc->crc[j] = crc32_combine(fc->crc[j], crcs[i * (k + m) + j], shares[i].len);
+            }
+        }
+        free(crcs);
+    }
+    if (NULL != late_fc && ret == 0) {
+        for (j = late_fc->have_data ? k : 0; j < k + m; j++) {
+            char *payload = j < k ? data[j] : parity[j - k];
+            late_fc->crc[j] = fused_chksum_update(late_fc, 0, payload, blocksize);
+        }
+    }
+
+    return ret;
+}
+
+/*
+ * Set up fc for an encode on instance if its CRC32 checksums can be
+ * computed along with the encode, and return it; NULL otherwise.  That
+ * takes a backend which leaves the data alone and encodes column by
+ * column.
+ */
+static struct ec_fused_chksum *init_fused_chksum(ec_backend_t instance, struct ec_fused_chksum *fc)
+{
+    if (instance->args.uargs.ct != CHKSUM_CRC32 || !instance->common.ops->is_systematic
+        || !instance->common.ops->encodes_by_column) {
+        return NULL;
+    }
+
+    fc->legacy = use_legacy_crc();
+    fc->payload_size = 0;
+    fc->have_data = 0;
+
+    return fc;
+}
+
+/*
+ * Encode one object on an instance the caller holds the registry lock
+ * for. On failure everything allocated here is released again.
+ */
+static int encode_fragments(ec_backend_t instance, const struct iovec *iov, int iovcnt, /* input */
+    uint64_t orig_data_size, int use_slab, /* input */
+    char ***encoded_data, char ***encoded_parity, /* output */
+    uint64_t *fragment_len) /* output */
+{
+    int k = instance->args.uargs.k;
+    int m = instance->args.uargs.m;
+    int ret = 0; /* return code */
+    struct ec_fused_chksum fused;
+    struct ec_fused_chksum *fc = init_fused_chksum(instance, &fused);
+
+    int blocksize = 0; /* length of each of k data elements */
+
+    *encoded_data = NULL;
+    *encoded_parity = NULL;
+
+    if (use_slab) {
+        ret = prepare_fragments_for_encode_slab(instance, k, m, iov, iovcnt, orig_data_size,
+            encoded_data, encoded_parity, &blocksize, fc);
+        if (ret < 0) {
+            goto out;
+        }
+        goto encode;
+    }
+
+    /*
+     * Allocate arrays for data, parity and missing_idxs
+     *
+     * The data array gets an extra slot telling
+     * liberasurecode_encode_cleanup() how the fragments were allocated:
+     * NULL, the pool marker or, see prepare_fragments_for_encode_slab(),
+     * the array itself
+     */
+    *encoded_data = (char **)alloc_zeroed_buffer(sizeof(char *) * (k + 1));
+    if (NULL == *encoded_data) {
+        log_error("Could not allocate data buffer!");
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    *encoded_parity = (char **)alloc_zeroed_buffer(sizeof(char *) * m);
+    if (NULL == *encoded_parity) {
+        log_error("Could not allocate parity buffer!");
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    if (instance->opts[EC_OPT_BUFFER_POOL] > 0) {
+        (*encoded_data)[k] = &pooled_fragments_marker;
+    }
+
+    ret = prepare_fragments_for_encode(instance, k, m, iov, iovcnt, orig_data_size,
+        *encoded_data, *encoded_parity, &blocksize, fc);
+    if (ret < 0) {
+        // ensure encoded_data/parity point the head of fragment_ptr
+        get_fragment_ptr_array_from_data(*encoded_data, *encoded_data, k);
+        get_fragment_ptr_array_from_data(*encoded_parity, *encoded_parity, m);
+        goto out;
+    }
+
+encode:
+    /* call the backend encode function passing it desc instance */
+    ret = encode_stripe(instance, *encoded_data, *encoded_parity, blocksize, fc);
+    if (ret < 0) {
+        // ensure encoded_data/parity point the head of fragment_ptr
+        get_fragment_ptr_array_from_data(*encoded_data, *encoded_data, k);
+        get_fragment_ptr_array_from_data(*encoded_parity, *encoded_parity, m);
+        goto out;
+    }
+
+    ret = finalize_fragments_after_encode(
+        instance, k, m, blocksize, orig_data_size, *encoded_data, *encoded_parity, fc);
+
+    *fragment_len = get_fragment_size((*encoded_data)[0]);
+
+out:
+    if (ret) {
+        /* Cleanup the allocations we have done */
+        free_encoded_fragments(k, m, *encoded_data, *encoded_parity);
+        *encoded_data = NULL;
+        *encoded_parity = NULL;
+    }
+    return ret;
+}
+
+/**
+ * Common encode path for liberasurecode_encode() and
+ * liberasurecode_encode_iov(); the data to encode is gathered from iov
+ * as the data fragments are laid out.
+ */
+static int liberasurecode_encode_common(int desc, const struct iovec *iov, int iovcnt, /* input */
+    uint64_t orig_data_size, /* input */
+    char ***encoded_data, char ***encoded_parity, /* output */
+    uint64_t *fragment_len) /* output */
+{
+    int ret = 0; /* return code */
+
+    if (encoded_data == NULL) {
+        log_error("Pointer to encoded data buffers is null!");
+        return -EINVALIDPARAMS;
+    }
+
+    if (encoded_parity == NULL) {
+        log_error("Pointer to encoded parity buffers is null!");
+        return -EINVALIDPARAMS;
+    }
+
+    if (fragment_len == NULL) {
+        log_error("Pointer to fragment length is null!");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    int rc = instances_read_lock();
+    if (rc != 0) {
+        /* Should just be EDEADLOCK */
+        ret = rc < 0 ? rc : -rc;
+        goto out;
+    }
+    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    if (NULL == instance) {
+        ret = -EBACKENDNOTAVAIL;
+        goto unlock;
+    }
+
+    ret = encode_fragments(instance, iov, iovcnt, orig_data_size,
+        instance->opts[EC_OPT_SLAB_ALLOC], encoded_data, encoded_parity, fragment_len);
+
+unlock:
+    instances_read_unlock();
+out:
+    if (ret) {
+        log_error("Error in liberasurecode_encode %d", ret);
+    }
+    return ret;
+}
+
+/**
+ * Erasure encode a data buffer
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param orig_data - data to encode
+ * @param orig_data_size - length of data to encode
+ * @param encoded_data - pointer to _output_ array (char **) of k data
+ *        fragments (char *), allocated by the callee
+ * @param encoded_parity - pointer to _output_ array (char **) of m parity
+ *        fragments (char *), allocated by the callee
+ * @param fragment_len - pointer to _output_ length of each fragment, assuming
+ *        all fragments are the same length
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode(int desc, const char *orig_data, uint64_t orig_data_size, /* input */
+    char ***encoded_data, char ***encoded_parity, /* output */
+    uint64_t *fragment_len) /* output */
+{
+    struct iovec iov = { .iov_base = (void *)orig_data, .iov_len = orig_data_size };
+
+    if (orig_data == NULL) {
+        log_error("Pointer to data buffer is null!");
+        return -EINVALIDPARAMS;
+    }
+
+    return liberasurecode_encode_common(
+        desc, &iov, 1, orig_data_size, encoded_data, encoded_parity, fragment_len);
+}
+
+/**
+ * Erasure encode data scattered over a list of segments
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param iov - segments of data to encode, in order
+ * @param iovcnt - number of segments in iov
+ * @param encoded_data - pointer to _output_ array (char **) of k data
+ *        fragments (char *), allocated by the callee
+ * @param encoded_parity - pointer to _output_ array (char **) of m parity
+ *        fragments (char *), allocated by the callee
+ * @param fragment_len - pointer to _output_ length of each fragment, assuming
+ *        all fragments are the same length
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_iov(int desc, const struct iovec *iov, int iovcnt, /* input */
+    char ***encoded_data, char ***encoded_parity, /* output */
+    uint64_t *fragment_len) /* output */
+{
+    int i;
+    uint64_t orig_data_size = 0;
+
+    if (iov == NULL || iovcnt <= 0) {
+        log_error("No data segments to encode!");
+        return -EINVALIDPARAMS;
+    }
+
+    for (i = 0; i < iovcnt; i++) {
+        if (iov[i].iov_base == NULL && iov[i].iov_len > 0) {
+            log_error("Pointer to data segment %d is null!", i);
+            return -EINVALIDPARAMS;
+        }
+        orig_data_size += iov[i].iov_len;
+    }
+
+    return liberasurecode_encode_common(
+        desc, iov, iovcnt, orig_data_size, encoded_data, encoded_parity, fragment_len);
+}
+
+/**
+ * Erasure encode a batch of data buffers
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param objs - n data buffers to encode
+ * @param lens - lengths of the n data buffers
+ * @param n - number of data buffers
+ * @param outputs - _output_ array of n encode results, each released with
+ *        liberasurecode_encode_cleanup()
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_batch(int desc, const char **objs, const uint64_t *lens, /* input */
+    int n, /* input */
+    struct ec_encode_output *outputs) /* output */
+{
+    int i, k, m;
+    int use_slab;
+    int ret = 0;
+
+    if (NULL == objs || NULL == lens || NULL == outputs || n <= 0) {
+        log_error("Invalid params passed to liberasurecode_encode_batch!");
+        return -EINVALIDPARAMS;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (NULL == objs[i]) {
+            log_error("Pointer to data buffer %d is null!", i);
+            return -EINVALIDPARAMS;
+        }
+    }
+
+    int rc = instances_read_lock();
+    if (rc != 0) {
+        /* Should just be EDEADLOCK */
+        return rc < 0 ? rc : -rc;
+    }
+    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    if (NULL == instance) {
+        ret = -EBACKENDNOTAVAIL;
+        goto unlock;
+    }
+
+    k = instance->args.uargs.k;
+    m = instance->args.uargs.m;
+
+    /*
+     * One allocation per object beats k + m + 2 of them unless the buffer
+     * pool is recycling fragments anyway
+     */
+    use_slab = instance->opts[EC_OPT_SLAB_ALLOC] || instance->opts[EC_OPT_BUFFER_POOL] <= 0;
+
+    for (i = 0; i < n; i++) {
+        struct iovec iov = { .iov_base = (void *)objs[i], .iov_len = lens[i] };
+
+        ret = encode_fragments(instance, &iov, 1, lens[i], use_slab, &outputs[i].encoded_data,
+            &outputs[i].encoded_parity, &outputs[i].fragment_len);
+        if (ret < 0) {
+            log_error("Error in liberasurecode_encode_batch for object %d: %d", i, ret);
+            break;
+        }
+    }
+
+    /* All or nothing */
+    if (ret < 0) {
+        while (--i >= 0) {
+            free_encoded_fragments(k, m, outputs[i].encoded_data, outputs[i].encoded_parity);
+            outputs[i].encoded_data = NULL;
+            outputs[i].encoded_parity = NULL;
+        }
+    }
+
+unlock:
+    instances_read_unlock();
+    return ret;
+}
+
+/**
+ * Compute the length of each fragment liberasurecode_encode_into() writes
+ * for a given data size
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param orig_data_size - length of data to encode
+ * @param fragment_len - pointer to _output_ length of each fragment, header
+ *        included
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_get_encoded_fragment_len(
+    int desc, uint64_t orig_data_size, uint64_t *fragment_len)
+{
+    int blocksize, metadata_size, data_offset;
+
+    if (NULL == fragment_len) {
+        log_error("Pointer to fragment length is null!");
+        return -EINVALIDPARAMS;
+    }
+
+    int rc = instances_read_lock();
+    if (rc) {
+        /* Should just be EDEADLOCK */
+        return rc < 0 ? rc : -rc;
+    }
+    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    if (NULL == instance) {
+        instances_read_unlock();
+        return -EBACKENDNOTAVAIL;
+    }
+
+    *fragment_len
+        = get_encode_layout(instance, orig_data_size, &blocksize, &metadata_size, &data_offset);
+
+    instances_read_unlock();
+    return 0;
+}
+
+/**
+ * Erasure encode a data buffer into caller-owned fragment buffers
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param orig_data - data to encode
+ * @param orig_data_size - length of data to encode
+ * @param fragments - array of k + m _output_ buffers (k data followed by m
+ *        parity), each aligned to LIBERASURECODE_FRAGMENT_ALIGNMENT bytes
+ * @param fragment_len - size of each buffer in fragments, at least the
+ *        length returned by liberasurecode_get_encoded_fragment_len()
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_encode_into(int desc, const char *orig_data, uint64_t orig_data_size, /* input */
+    char **fragments, uint64_t fragment_len) /* output */
+{
+    int i, k, m;
+    int ret = 0;
+    int blocksize, metadata_size, data_offset;
+    char *data_ptrs[EC_MAX_FRAGMENTS];
+    char **encoded_data = data_ptrs;
+    char **encoded_parity = NULL;
+    struct iovec iov = { .iov_base = (void *)orig_data, .iov_len = orig_data_size };
+    struct ec_fused_chksum fused;
+    struct ec_fused_chksum *fc = NULL;
+
+    if (orig_data == NULL) {
+        log_error("Pointer to data buffer is null!");
+        return -EINVALIDPARAMS;
+    }
+
+    if (fragments == NULL) {
+        log_error("Pointer to fragment buffers is null!");
+        return -EINVALIDPARAMS;
+    }
+
+    int rc = instances_read_lock();
+    if (rc != 0) {
+        /* Should just be EDEADLOCK */
+        return rc < 0 ? rc : -rc;
+    }
+    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    if (NULL == instance) {
+        ret = -EBACKENDNOTAVAIL;
+        goto out;
+    }
+
+    k = instance->args.uargs.k;
+    m = instance->args.uargs.m;
+    encoded_parity = data_ptrs + k;
+
+    if (fragment_len
+        < get_encode_layout(instance, orig_data_size, &blocksize, &metadata_size, &data_offset)) {
+        log_error("Fragment buffers too small for encode!");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    for (i = 0; i < k + m; i++) {
+        if (NULL == fragments[i]
+            || !is_addr_aligned((unsigned long)fragments[i], LIBERASURECODE_FRAGMENT_ALIGNMENT)) {
+            log_error("Fragment buffer %d is null or not aligned!", i);
+            ret = -EINVALIDPARAMS;
+            goto out;
+        }
+    }
+
+    fc = init_fused_chksum(instance, &fused);
+    ret = prepare_fragments_for_encode_into(instance, k, m, &iov, 1, orig_data_size, fragments,
+        encoded_data, encoded_parity, &blocksize, fc);
+    if (ret < 0) {
+        goto out;
+    }
+
+    /* call the backend encode function passing it desc instance */
+    ret = encode_stripe(instance, encoded_data, encoded_parity, blocksize, fc);
+    if (ret < 0) {
+        goto out;
+    }
+
+    ret = finalize_fragments_after_encode(
+        instance, k, m, blocksize, orig_data_size, encoded_data, encoded_parity, fc);
+
+out:
+    instances_read_unlock();
+    if (ret) {
+        log_error("Error in liberasurecode_encode_into %d", ret);
+    }
+    return ret;
+}
+
+/**
+ * Cleanup structures allocated by librasurecode_decode
+ *
+ * The caller has no context, so cannot safely free memory
+ * allocated by liberasurecode, so it must pass the
+ * deallocation responsibility back to liberasurecode.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param data - (char *) buffer of data decoded by
+ *        librasurecode_decode
+ * @return 0 in success; -error otherwise
+ */
+int liberasurecode_decode_cleanup(int desc, char *data)
+{
+    int rc = instances_read_lock();
+    if (rc) {
+        /* Should just be EDEADLOCK */
+        return rc;
+    }
+    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    instances_read_unlock();
+    if (NULL == instance) {
+        return -EBACKENDNOTAVAIL;
+    }
+
+    free(data);
+
+    return 0;
+}
+
+/*
+ * Reassemble the original data from k index-ordered data fragments, either
+ * into a new buffer returned via out_data or, when out_buf is set, into
+ * the caller's buffer.
+ */
+static int decoded_fragments_to_output(int k, int m, char **fragments, int num_fragments,
+    char **out_data, char *out_buf, uint64_t out_cap, uint64_t *out_data_len)
+{
+    if (NULL != out_buf) {
+        return fragments_to_buffer(k, m, fragments, num_fragments, out_buf, out_cap, out_data_len);
+    }
+    return fragments_to_string(k, m, fragments, num_fragments, out_data, out_data_len);
+}
+
+static int liberasurecode_decode_common(int desc, char **available_fragments, /* input */
+    int num_fragments, uint64_t fragment_len, /* input */
+    int force_metadata_checks, /* input */
+    char **out_data, char *out_buf, uint64_t out_cap, /* output */
+    uint64_t *out_data_len) /* output */
+{
+    int i, j;
+    int ret = 0;
+
+    int k = -1, m = -1;
+    int orig_data_size = 0;
+
+    int blocksize = 0;
+    char **data = NULL;
+    char **parity = NULL;
+    char **data_segments = NULL;
+    char **parity_segments = NULL;
+    int *missing_idxs = NULL;
+
+    struct ec_bm realloc_bm = NEW_BM;
+    int pool_depth = 0;
+
+    int rc = instances_read_lock();
+    if (rc) {
+        /* Should just be EDEADLOCK */
+        return rc;
+    }
+    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    if (NULL == instance) {
+        ret = -EBACKENDNOTAVAIL;
+        goto out;
+    }
+
+    if (NULL == available_fragments) {
+        log_error("Pointer to encoded fragments buffer is null!");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    if (NULL == out_data && NULL == out_buf) {
+        log_error("Pointer to decoded data buffer is null!");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    if (NULL == out_data_len) {
+        log_error("Pointer to decoded data length variable is null!");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    k = instance->args.uargs.k;
+    m = instance->args.uargs.m;
+    pool_depth = instance->opts[EC_OPT_BUFFER_POOL];
+
+    if (num_fragments < k) {
+        log_error("Not enough fragments to decode, got %d, need %d!", num_fragments, k);
+        ret = -EINSUFFFRAGS;
+        goto out;
+    }
+
+    if (fragment_len < sizeof(fragment_header_t)) {
+        log_error("Fragments not long enough to include headers! "
+                  "Need %zu, but got %lu.",
+            sizeof(fragment_header_t), (unsigned long)fragment_len);
+        ret = -EBADHEADER;
+        goto out;
+    }
+    for (i = 0; i < num_fragments; ++i) {
+        /* Verify metadata checksum */
+        if (is_invalid_fragment_header((fragment_header_t *)available_fragments[i])) {
+            log_error("Invalid fragment header information!");
+            ret = -EBADHEADER;
+            goto out;
+        }
+    }
+
+    /* Don't bother decoding if the result cannot fit the caller's buffer */
+    if (NULL != out_buf) {
+        uint64_t needed = get_orig_data_size(available_fragments[0]);
+        if (out_cap < needed) {
+            log_error("Decode buffer too small, need %lu bytes, got %lu!",
+                (unsigned long)needed, (unsigned long)out_cap);
+            *out_data_len = needed;
+            ret = -EINVALIDPARAMS;
+            goto out;
+        }
+    }
+
+    if (instance->common.ops->is_systematic) {
+        /*
+         * Try to re-assebmle the original data before attempting a decode
+         */
+        ret = decoded_fragments_to_output(k, m, available_fragments, num_fragments, out_data,
+            out_buf, out_cap, out_data_len);
+
+        if (ret == 0) {
+            /* We were able to get the original data without decoding! */
+            goto out;
+        }
+    }
+
+    /*
+     * Allocate arrays for data, parity and missing_idxs
+     */
+    data = alloc_zeroed_buffer(sizeof(char *) * k);
+    if (NULL == data) {
+        log_error("Could not allocate data buffer!");
+        goto out;
+    }
+
+    parity = alloc_zeroed_buffer(sizeof(char *) * m);
+    if (NULL == parity) {
+        log_error("Could not allocate parity buffer!");
+        goto out;
+    }
+
+    missing_idxs = alloc_and_set_buffer(sizeof(char *) * (k + m), -1);
+    if (NULL == missing_idxs) {
+        log_error("Could not allocate missing_idxs buffer!");
+        goto out;
+    }
+
+    /* If metadata checks requested, check fragment integrity upfront */
+    if (force_metadata_checks) {
+        int num_invalid_fragments = 0;
+        for (i = 0; i < num_fragments; ++i) {
+            if (is_invalid_fragment(desc, available_fragments[i])) {
+                ++num_invalid_fragments;
+            }
+        }
+        if ((num_fragments - num_invalid_fragments) < k) {
+            ret = -EINSUFFFRAGS;
+            log_error("Not enough valid fragments available for decode!");
+            goto out;
+        }
+    }
+
+    /*
+     * Separate the fragments into data and parity.  Also determine which
+     * pieces are missing.
+     */
+    ret = get_fragment_partition(
+        k, m, available_fragments, num_fragments, data, parity, missing_idxs);
+
+    if (ret < 0) {
+        log_error("Could not properly partition the fragments!");
+        goto out;
+    }
+
+    /*
+     * Preparing the fragments for decode.  This will alloc aligned buffers
+     * when unaligned buffers were passed in available_fragments.  It passes
+     * back a bitmap telling us which buffers need to be freed by us
+     * (realloc_bm).
+     *
+     */
+    ret = prepare_fragments_for_decode(k, m, data, parity, missing_idxs, &orig_data_size,
+        &blocksize, fragment_len, pool_depth, !instance->common.ops->decodes_data_only,
+        &realloc_bm);
+    if (ret < 0) {
+        log_error("Could not prepare fragments for decode!");
+        goto out;
+    }
+
+    data_segments = alloc_zeroed_buffer(k * sizeof(char *));
+    parity_segments = alloc_zeroed_buffer(m * sizeof(char *));
+    get_data_ptr_array_from_fragments(data_segments, data, k);
+    get_data_ptr_array_from_fragments(parity_segments, parity, m);
+
+    /* call the backend decode function passing it desc instance */
+    ret = instance->common.ops->decode(
+        instance->desc.backend_desc, data_segments, parity_segments, missing_idxs, blocksize);
+
+    if (ret < 0) {
+        log_error("Encountered error in backend decode function!");
+        goto out;
+    }
+
+    /*
+     * Need to fill in the missing data headers so we can generate
+     * the original string.
+     */
+    j = 0;
+    while (missing_idxs[j] >= 0) {
+        int set_chksum = 1;
+        int missing_idx = missing_idxs[j];
+        if (missing_idx < k) {
+            /* Generate headers */
+            char *fragment_ptr = data[missing_idx];
+            init_fragment_header(fragment_ptr);
+            add_fragment_metadata(instance, fragment_ptr, missing_idx, orig_data_size, blocksize,
+                instance->args.uargs.ct, !set_chksum);
+        }
+        j++;
+    }
+
+    /* Try to generate the original string */
+    ret = decoded_fragments_to_output(
+        k, m, data, k, out_data, out_buf, out_cap, out_data_len);
+
+    if (ret < 0) {
+        log_error("Could not convert decoded fragments to a string!");
+    }
+
+out:
+    instances_read_unlock();
+    /* Free the buffers allocated in prepare_fragments_for_decode */
+    if (bm_any(&realloc_bm)) {
+        for (i = 0; i < k; i++) {
+            if (bm_get_value(&realloc_bm, i)) {
+                free_fragment_buffer_pooled(data[i], pool_depth);
+            }
+        }
+
+        for (i = 0; i < m; i++) {
+            if (bm_get_value(&realloc_bm, i + k)) {
+                free_fragment_buffer_pooled(parity[i], pool_depth);
+            }
+        }
+    }
+
+    free(data);
+    free(parity);
+    free(missing_idxs);
+    free(data_segments);
+    free(parity_segments);
+
+    return ret;
+}
+
+/**
+ * Reconstruct original data from a set of k encoded fragments
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param available_fragments - erasure encoded fragments (> = k)
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - length of each fragment (assume they are the same)
+ * @param force_metadata_checks - force fragment metadata checks (default: 0)
+ * @param out_data - _output_ pointer to decoded data
+ * @param out_data_len - _output_ length of decoded output
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_decode(int desc, char **available_fragments, /* input */
+    int num_fragments, uint64_t fragment_len, /* input */
+    int force_metadata_checks, /* input */
+    char **out_data, uint64_t *out_data_len) /* output */
+{
+    return liberasurecode_decode_common(desc, available_fragments, num_fragments, fragment_len,
+        force_metadata_checks, out_data, NULL, 0, out_data_len);
+}
+
+/**
+ * Reconstruct original data from a set of k encoded fragments into a
+ * caller-owned buffer
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param available_fragments - erasure encoded fragments (> = k)
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - length of each fragment (assume they are the same)
+ * @param force_metadata_checks - force fragment metadata checks (default: 0)
+ * @param out_buf - caller-owned buffer receiving the decoded data
+ * @param out_cap - size in bytes of out_buf
+ * @param out_len - _output_ length of decoded output
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_decode_into(int desc, char **available_fragments, /* input */
+    int num_fragments, uint64_t fragment_len, /* input */
+    int force_metadata_checks, /* input */
+    char *out_buf, uint64_t out_cap, /* output */
+    uint64_t *out_len) /* output */
+{
+    if (NULL == out_buf) {
+        log_error("Pointer to decoded data buffer is null!");
+        return -EINVALIDPARAMS;
+    }
+
+    return liberasurecode_decode_common(desc, available_fragments, num_fragments, fragment_len,
+        force_metadata_checks, NULL, out_buf, out_cap, out_len);
+}
+
+/**
+ * Describe the original data of a systematic code as a list of segments
+ * pointing into the data fragments, without copying anything
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param available_fragments - erasure encoded fragments (> = k)
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - length of each fragment (assume they are the same)
+ * @param iov - _output_ segments referencing available_fragments
+ * @param iovcnt - number of entries in iov; _output_ number of entries used
+ * @param out_data_len - _output_ length of the original data
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_decode_iov(int desc, char **available_fragments, /* input */
+    int num_fragments, uint64_t fragment_len, /* input */
+    struct iovec *iov, int *iovcnt, /* output */
+    uint64_t *out_data_len) /* output */
+{
+    int i;
+    int ret = 0;
+    int k = -1, m = -1;
+
+    int rc = instances_read_lock();
+    if (rc) {
+        /* Should just be EDEADLOCK */
+        return rc;
+    }
+    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    if (NULL == instance) {
+        ret = -EBACKENDNOTAVAIL;
+        goto out;
+    }
+
+    if (NULL == available_fragments || NULL == iov || NULL == iovcnt
+        || NULL == out_data_len) {
+        log_error("Invalid params passed to liberasurecode_decode_iov!");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    if (!instance->common.ops->is_systematic) {
+        ret = -EBACKENDNOTSUPP;
+        goto out;
+    }
+
+    k = instance->args.uargs.k;
+    m = instance->args.uargs.m;
+
+    if (fragment_len < sizeof(fragment_header_t)) {
+        log_error("Fragments not long enough to include headers! "
+                  "Need %zu, but got %lu.",
+            sizeof(fragment_header_t), (unsigned long)fragment_len);
+        ret = -EBADHEADER;
+        goto out;
+    }
+    for (i = 0; i < num_fragments; ++i) {
+        /* Verify metadata checksum */
+        if (is_invalid_fragment_header((fragment_header_t *)available_fragments[i])) {
+            log_error("Invalid fragment header information!");
+            ret = -EBADHEADER;
+            goto out;
+        }
+    }
+
+    ret = fragments_to_iov(k, m, available_fragments, num_fragments, iov, iovcnt, out_data_len);
+    if (ret == -1) {
+        /*
+         * Some data fragments are missing, which is not an error: the
+         * caller has to fall back to liberasurecode_decode
+         */
+        ret = -EINSUFFFRAGS;
+    }
+
+out:
+    instances_read_unlock();
+    return ret;
+}
+
+/*
+ * Check a fragment header and copy its metadata out, in host byte order,
+ * without looking at the payload.  The fragment's libec_version goes to
+ * *libec_version.
+ *
+ * With legacy_crc set, *legacy_crc tells whether the fragment was written
+ * with LIBERASURECODE_WRITE_LEGACY_CRC: the same switch picks the CRC of
+ * the metadata checksum and of the payload checksums, so a metadata
+ * checksum only liberasurecode_crc32_alt() matches gives it away.  Headers
+ * from before 1.2.0 carry no metadata checksum and count as legacy.
+ */
+static int read_fragment_metadata(char *fragment, fragment_metadata_t *fragment_metadata,
+    uint32_t *libec_version, int *legacy_crc)
+{
+    fragment_header_t *fragment_hdr = NULL;
+
+    if (NULL == fragment) {
+        log_error("Need valid fragment object to get metadata for");
+        return -EINVALIDPARAMS;
+    }
+
+    if (NULL == fragment_metadata) {
+        log_error("Need valid fragment_metadata object for return value");
+        return -EINVALIDPARAMS;
+    }
+
+    /* Verify metadata checksum */
+    if (is_invalid_fragment_header((fragment_header_t *)fragment)) {
+        log_error("Invalid fragment header information!");
+        return -EBADHEADER;
+    }
+
+    memcpy(fragment_metadata, fragment, sizeof(struct fragment_metadata));
+    fragment_hdr = (fragment_header_t *)fragment;
+    *libec_version = fragment_hdr->libec_version;
+    if (LIBERASURECODE_FRAG_HEADER_MAGIC != fragment_hdr->magic) {
+        if (LIBERASURECODE_FRAG_HEADER_MAGIC != bswap_32(fragment_hdr->magic)) {
+            log_error("Invalid fragment, illegal magic value");
+            return -EINVALIDPARAMS;
+        } else {
+            // Must've written this on an opposite-endian architecture.
+            // Fix it in fragment_metadata; chksum_type is a single byte
+            fragment_metadata->idx = bswap_32(fragment_metadata->idx);
+            fragment_metadata->size = bswap_32(fragment_metadata->size);
+            fragment_metadata->frag_backend_metadata_size
+                = bswap_32(fragment_metadata->frag_backend_metadata_size);
+            fragment_metadata->orig_data_size = bswap_64(fragment_metadata->orig_data_size);
+            *libec_version = bswap_32(*libec_version);
+            for (int i = 0; i < LIBERASURECODE_MAX_CHECKSUM_LEN; i++) {
+                fragment_metadata->chksum[i] = bswap_32(fragment_metadata->chksum[i]);
+            }
+            fragment_metadata->backend_version = bswap_32(fragment_metadata->backend_version);
+        }
+    }
+
+    if (NULL != legacy_crc) {
+        uint32_t metadata_chksum = fragment_hdr->metadata_chksum;
+
+        if (LIBERASURECODE_FRAG_HEADER_MAGIC != fragment_hdr->magic) {
+            metadata_chksum = bswap_32(metadata_chksum);
+        }
+        *legacy_crc = *libec_version < _VERSION(1, 2, 0)
+            || metadata_chksum
+                != liberasurecode_crc32(0, &fragment_hdr->meta, sizeof(fragment_metadata_t));
+    }
+
+    return 0;
+}
+
+/**
+ * Compute the CRC-32 of the original data from the checksums stored in the
+ * data fragment headers, without reading any payload
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param available_fragments - erasure encoded fragments (> = k)
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - length of each fragment (assume they are the same)
+ * @param out_crc - _output_ CRC-32 of the original data
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_get_object_crc32(int desc, char **available_fragments, /* input */
+    int num_fragments, uint64_t fragment_len, /* input */
+    uint32_t *out_crc) /* output */
+{
+    fragment_metadata_t data_metadata[EC_MAX_FRAGMENTS];
+    struct ec_bm have_bm = NEW_BM;
+    int data_legacy_crc[EC_MAX_FRAGMENTS];
+    uint64_t orig_data_size = 0;
+    uint64_t remaining = 0;
+    uint32_t libec_version = 0;
+    uint32_t crc = 0;
+    int legacy_crc = 0;
+    int i;
+    int ret = 0;
+    int k = -1;
+
+    if (NULL == available_fragments || NULL == out_crc) {
+        log_error("Invalid params passed to liberasurecode_get_object_crc32!");
+        return -EINVALIDPARAMS;
+    }
+
+    int rc = instances_read_lock();
+    if (rc) {
+        /* Should just be EDEADLOCK */
+        return rc;
+    }
+    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    if (NULL == instance) {
+        ret = -EBACKENDNOTAVAIL;
+        goto out;
+    }
+    if (!instance->common.ops->is_systematic) {
+        ret = -EBACKENDNOTSUPP;
+        goto out;
+    }
+    k = instance->args.uargs.k;
+
+    if (fragment_len < sizeof(fragment_header_t)) {
+        log_error("Fragments not long enough to include headers! "
+                  "Need %zu, but got %lu.",
+            sizeof(fragment_header_t), (unsigned long)fragment_len);
+        ret = -EBADHEADER;
+        goto out;
+    }
+
+    /* Headers only, in host byte order: the payloads are never read */
+    for (i = 0; i < num_fragments; i++) {
+        fragment_metadata_t metadata;
+
+        ret = read_fragment_metadata(
+            available_fragments[i], &metadata, &libec_version, &legacy_crc);
+        if (ret != 0) {
+            goto out;
+        }
+        if (liberasurecode_verify_fragment_metadata(instance, &metadata) != 0) {
+            log_error("Fragment %d does not belong to this instance!", i);
+            ret = -EBADHEADER;
+            goto out;
+        }
+        /* Every fragment of an object records the same original size */
+        if (i > 0 && metadata.orig_data_size != orig_data_size) {
+            log_error("Inconsistent orig_data_size in fragment header!");
+            ret = -EBADHEADER;
+            goto out;
+        }
+        orig_data_size = metadata.orig_data_size;
+        if (metadata.idx < (uint32_t)k && !bm_get_value(&have_bm, metadata.idx)) {
+            data_metadata[metadata.idx] = metadata;
+            data_legacy_crc[metadata.idx] = legacy_crc;
+            bm_set_value(&have_bm, metadata.idx, 1);
+        }
+    }
+    for (i = 0; i < k; i++) {
+        if (!bm_get_value(&have_bm, i)) {
+            ret = -EINSUFFFRAGS;
+            goto out;
+        }
+        /* Only the last data fragment may be cut short */
+        if (i < k - 1 && data_metadata[i].size != data_metadata[0].size) {
+            log_error("Inconsistent payload size in data fragment %d header!", i);
+            ret = -EBADHEADER;
+            goto out;
+        }
+    }
+
+    remaining = orig_data_size;
+    for (i = 0; i < k && remaining > 0; i++) {
+        uint64_t len = remaining > data_metadata[i].size ? data_metadata[i].size : remaining;
+
+        if (data_metadata[i].chksum_type != CHKSUM_CRC32) {
+            log_error("Data fragment %d has no CRC32 checksum!", i);
+            ret = -EBADCHKSUM;
+            goto out;
+        }
+        /* The legacy CRC has no combine function */
+        if (data_legacy_crc[i]) {
+            log_error("Data fragment %d was written with the legacy CRC!", i);
+            ret = -EBADCHKSUM;
+            goto out;
+        }
+        /* The stored CRC also covers the zero padding past the end of the data */
+        crc = crc32_combine(
+            crc, crc32_trim_zeros(data_metadata[i].chksum[0], data_metadata[i].size - len), len);
+        remaining -= len;
+    }
+    if (remaining > 0) {
+        log_error("Data fragments are too short for orig_data_size!");
+        ret = -EBADHEADER;
+        goto out;
+    }
+    *out_crc = crc;
+
+out:
+    instances_read_unlock();
+    return ret;
+}
+
+/**
+ * Reconstruct a missing fragment from a subset of available fragments
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param fragment_len - size in bytes of the fragments
+ * @param available_fragments - erasure encoded fragments
+ * @param num_fragments - number of fragments being passed in
+ * @param destination_idx - missing idx to reconstruct
+ * @param out_fragment - output of reconstruct
+ * @return 0 on success, -error code otherwise
  */
-int liberasurecode_decode(int desc, char **available_fragments, /* input */
+int liberasurecode_reconstruct_fragment(int desc, char **available_fragments, /* input */
     int num_fragments, uint64_t fragment_len, /* input */
-    int force_metadata_checks, /* input */
-    char **out_data, uint64_t *out_data_len) /* output */
+    int destination_idx, /* input */
+    char *out_fragment) /* output */
 {
-    int i, j;
-    int ret = 0;
+    int destination_idxs[2] = { destination_idx, -1 };
 
-    int k = -1, m = -1;
-    int orig_data_size = 0;
-
-    int blocksize = 0;
-    char **data = NULL;
-    char **parity = NULL;
-    char **data_segments = NULL;
-    char **parity_segments = NULL;
-    int *missing_idxs = NULL;
+    if (NULL == out_fragment) {
+        log_error("Can not reconstruct fragment, output fragment pointer is NULL");
+        return -EINVALIDPARAMS;
+    }
 
-    struct ec_bm realloc_bm = NEW_BM;
+    return liberasurecode_reconstruct_fragments(desc, available_fragments, num_fragments,
+        fragment_len, destination_idxs, &out_fragment);
+}
 
-    int rc = rwlock_rdlock(&active_instances_rwlock);
-    if (rc) {
-        /* Should just be EDEADLOCK */
-        return rc;
-    }
-    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
-    if (NULL == instance) {
-        ret = -EBACKENDNOTAVAIL;
-        goto out;
-    }
+/*
+ * Check a -1 terminated destination list against the instance: every idx
+ * is in range, listed once and has an output buffer
+ */
+static int check_reconstruct_destinations(
+    ec_backend_t instance, int *destination_idxs, char **out_fragments)
+{
+    struct ec_bm destination_bm = NEW_BM;
+    int n = instance->args.uargs.k + instance->args.uargs.m;
+    int i;
 
-    if (NULL == available_fragments) {
-        log_error("Pointer to encoded fragments buffer is null!");
-        ret = -EINVALIDPARAMS;
-        goto out;
+    for (i = 0; destination_idxs[i] > -1; i++) {
+        if (destination_idxs[i] >= n || NULL == out_fragments[i]
+            || bm_get_value(&destination_bm, destination_idxs[i])) {
+            log_error("Invalid destination %d for reconstruction!", destination_idxs[i]);
+            return -EINVALIDPARAMS;
+        }
+        bm_set_value(&destination_bm, destination_idxs[i], 1);
     }
-
-    if (NULL == out_data) {
-        log_error("Pointer to decoded data buffer is null!");
-        ret = -EINVALIDPARAMS;
-        goto out;
+    if (i == 0) {
+        log_error("No destination given for reconstruction!");
+        return -EINVALIDPARAMS;
     }
 
-    if (NULL == out_data_len) {
-        log_error("Pointer to decoded data length variable is null!");
-        ret = -EINVALIDPARAMS;
-        goto out;
-    }
+    return 0;
+}
 
-    k = instance->args.uargs.k;
-    m = instance->args.uargs.m;
+/* What the stripes of a reconstruct that lost the same fragments share */
+struct reconstruct_plan {
+    int *destination_idxs; /* -1 terminated */
+    int missing_idxs[EC_MAX_FRAGMENTS + 1]; /* as passed to the backend */
+    int rebuild_idxs[EC_MAX_FRAGMENTS + 1]; /* destinations that are missing */
+    int num_rebuild;
+    int parity_only; /* only parity is rebuilt, straight from the data */
+    struct ec_bm missing_bm; /* fragments the stripes do not provide */
+    void *tables; /* from the backend's reconstruct_prepare(), or NULL */
+};
 
-    if (num_fragments < k) {
-        log_error("Not enough fragments to decode, got %d, need %d!", num_fragments, k);
-        ret = -EINSUFFFRAGS;
-        goto out;
-    }
+/*
+ * Sort the fragments of a stripe into data and parity, checking their
+ * headers first; with pattern_bm given, the stripe has to be missing
+ * exactly those fragments
+ */
+static int partition_stripe(ec_backend_t instance, char **available_fragments,
+    int num_fragments, char **data, char **parity, int *missing_idxs,
+    struct ec_bm *pattern_bm)
+{
+    struct ec_bm missing_bm = NEW_BM;
+    int k = instance->args.uargs.k;
+    int m = instance->args.uargs.m;
+    int i, ret;
 
-    if (fragment_len < sizeof(fragment_header_t)) {
-        log_error("Fragments not long enough to include headers! "
-                  "Need %zu, but got %lu.",
-            sizeof(fragment_header_t), (unsigned long)fragment_len);
-        ret = -EBADHEADER;
-        goto out;
-    }
-    for (i = 0; i < num_fragments; ++i) {
+    for (i = 0; i < num_fragments; i++) {
         /* Verify metadata checksum */
         if (is_invalid_fragment_header((fragment_header_t *)available_fragments[i])) {
             log_error("Invalid fragment header information!");
-            ret = -EBADHEADER;
-            goto out;
+            return -EBADHEADER;
         }
     }
 
-    if (instance->common.ops->is_systematic) {
-        /*
-         * Try to re-assebmle the original data before attempting a decode
-         */
-        ret = fragments_to_string(k, m, available_fragments, num_fragments, out_data, out_data_len);
-
-        if (ret == 0) {
-            /* We were able to get the original data without decoding! */
-            goto out;
-        }
+    for (i = 0; i <= k + m; i++) {
+        missing_idxs[i] = -1;
+    }
+    ret = get_fragment_partition(
+        k, m, available_fragments, num_fragments, data, parity, missing_idxs);
+    if (ret < 0) {
+        log_error("Could not properly partition the fragments!");
+        return ret;
     }
 
-    /*
-     * Allocate arrays for data, parity and missing_idxs
-     */
-    data = alloc_zeroed_buffer(sizeof(char *) * k);
-    if (NULL == data) {
-        log_error("Could not allocate data buffer!");
-        goto out;
+    convert_list_to_bitmap(missing_idxs, &missing_bm);
+    if (NULL != pattern_bm && !bm_equal(pattern_bm, &missing_bm)) {
+        log_error("Stripe does not match the erasure pattern of the batch!");
+        return -EINVALIDPARAMS;
     }
 
-    parity = alloc_zeroed_buffer(sizeof(char *) * m);
-    if (NULL == parity) {
-        log_error("Could not allocate parity buffer!");
-        goto out;
+    return 0;
+}
+
+/*
+ * Work out, from one stripe, what has to be rebuilt for the destinations
+ * and whether the backend can: everything that only depends on which
+ * fragments are missing.  The caller holds the instances read lock and has
+ * checked the destinations.
+ */
+static int plan_reconstruct(ec_backend_t instance, char **available_fragments,
+    int num_fragments, int *destination_idxs, struct reconstruct_plan *plan)
+{
+    char *data[EC_MAX_FRAGMENTS];
+    char *parity[EC_MAX_FRAGMENTS];
+    struct ec_bm destination_bm = NEW_BM;
+    int k = instance->args.uargs.k;
+    int m = instance->args.uargs.m;
+    int i, ret;
+
+    plan->destination_idxs = destination_idxs;
+    plan->num_rebuild = 0;
+    plan->parity_only = 0;
+    memset(&plan->missing_bm, 0, sizeof(plan->missing_bm));
+    plan->tables = NULL;
+
+    ret = partition_stripe(instance, available_fragments, num_fragments, data, parity,
+        plan->missing_idxs, NULL);
+    if (ret < 0) {
+        return ret;
     }
+    convert_list_to_bitmap(plan->missing_idxs, &plan->missing_bm);
+    convert_list_to_bitmap(destination_idxs, &destination_bm);
 
-    missing_idxs = alloc_and_set_buffer(sizeof(char *) * (k + m), -1);
-    if (NULL == missing_idxs) {
-        log_error("Could not allocate missing_idxs buffer!");
-        goto out;
+    /*
+     * Odd corner-case: If the caller passes in a destination_idx that
+     * is also included in the available fragments list, we should *not*
+     * try to reconstruct.
+     *
+     * For now, we will log a warning and copy it out as is.  In the future,
+     * we should probably log and return an error.
+     */
+    for (i = 0; i <= k + m; i++) {
+        plan->rebuild_idxs[i] = -1;
+    }
+    for (i = 0; i < k + m; i++) {
+        if (bm_get_value(&destination_bm, i) && bm_get_value(&plan->missing_bm, i)) {
+            plan->rebuild_idxs[plan->num_rebuild++] = i;
+        }
     }
 
-    /* If metadata checks requested, check fragment integrity upfront */
-    if (force_metadata_checks) {
-        int num_invalid_fragments = 0;
-        for (i = 0; i < num_fragments; ++i) {
-            if (is_invalid_fragment(desc, available_fragments[i])) {
-                ++num_invalid_fragments;
+    for (i = 0; i < plan->num_rebuild; i++) {
+        if (instance->common.ops->check_reconstruct_fragments == NULL) {
+            if (num_fragments < k) {
+                return -EINSUFFFRAGS;
+            }
+        } else {
+            ret = instance->common.ops->check_reconstruct_fragments(
+                instance->desc.backend_desc, plan->missing_idxs, plan->rebuild_idxs[i]);
+            if (ret < 0) {
+                return ret;
             }
-        }
-        if ((num_fragments - num_invalid_fragments) < k) {
-            ret = -EINSUFFFRAGS;
-            log_error("Not enough valid fragments available for decode!");
-            goto out;
         }
     }
 
     /*
-     * Separate the fragments into data and parity.  Also determine which
-     * pieces are missing.
+     * All of the data is here and only parity is wanted: a systematic
+     * backend rebuilds that as rows of the encode, straight from the data.
+     * It only needs to hear about the destinations, and the other missing
+     * parity get no buffers.
      */
-    ret = get_fragment_partition(
-        k, m, available_fragments, num_fragments, data, parity, missing_idxs);
+    plan->parity_only = plan->num_rebuild > 0 && instance->common.ops->is_systematic
+        && plan->missing_idxs[0] >= k;
+    if (plan->parity_only) {
+        for (i = 0; i <= plan->num_rebuild; i++) {
+            plan->missing_idxs[i] = plan->rebuild_idxs[i];
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Reconstruct the destinations of one stripe into out_fragments, following
+ * plan.  With check_pattern set, the stripe has to be missing the same
+ * fragments as the one the plan was made from.
+ */
+static int reconstruct_stripe(ec_backend_t instance, const struct reconstruct_plan *plan,
+    char **available_fragments, int num_fragments, uint64_t fragment_len, char **out_fragments,
+    int check_pattern)
+{
+    int ret = 0;
+    int blocksize = 0;
+    int orig_data_size = 0;
+    char *data[EC_MAX_FRAGMENTS];
+    char *parity[EC_MAX_FRAGMENTS];
+    char *data_segments[EC_MAX_FRAGMENTS];
+    char *parity_segments[EC_MAX_FRAGMENTS];
+    int missing_idxs[EC_MAX_FRAGMENTS + 1];
+    char *fragment_ptr = NULL;
+    int k = instance->args.uargs.k;
+    int m = instance->args.uargs.m;
+    int i, idx;
+    struct ec_bm realloc_bm = NEW_BM;
+    struct ec_bm pattern_bm = plan->missing_bm;
+    int pool_depth = instance->opts[EC_OPT_BUFFER_POOL];
+    int set_chksum = 1;
 
+    ret = partition_stripe(instance, available_fragments, num_fragments, data, parity,
+        missing_idxs, check_pattern ? &pattern_bm : NULL);
     if (ret < 0) {
-        log_error("Could not properly partition the fragments!");
-        goto out;
+        return ret;
+    }
+    if (plan->num_rebuild == 0) {
+        goto destination_available;
     }
 
     /*
-     * Preparing the fragments for decode.  This will alloc aligned buffers
-     * when unaligned buffers were passed in available_fragments.  It passes
-     * back a bitmap telling us which buffers need to be freed by us
-     * (realloc_bm).
-     *
+     * Preparing the fragments for reconstruction.  This will alloc aligned
+     * buffers when unaligned buffers were passed in available_fragments.
+     * It passes back a bitmap telling us which buffers need to be freed by
+     * us (realloc_bm).
      */
-    ret = prepare_fragments_for_decode(
-        k, m, data, parity, missing_idxs, &orig_data_size, &blocksize, fragment_len, &realloc_bm);
+    ret = prepare_fragments_for_decode(k, m, data, parity, (int *)plan->missing_idxs,
+        &orig_data_size, &blocksize, fragment_len, pool_depth, !plan->parity_only, &realloc_bm);
     if (ret < 0) {
-        log_error("Could not prepare fragments for decode!");
+        log_error("Could not prepare fragments for reconstruction!");
         goto out;
     }
-
-    data_segments = alloc_zeroed_buffer(k * sizeof(char *));
-    parity_segments = alloc_zeroed_buffer(m * sizeof(char *));
+    for (i = 0; plan->parity_only && i < plan->num_rebuild; i++) {
+        idx = plan->rebuild_idxs[i];
+        parity[idx - k] = alloc_fragment_buffer_pooled(
+            fragment_len - sizeof(fragment_header_t), pool_depth);
+        if (NULL == parity[idx - k]) {
+            log_error("Could not allocate parity buffer!");
+            ret = -ENOMEM;
+            goto out;
+        }
+        bm_set_value(&realloc_bm, idx, 1);
+    }
     get_data_ptr_array_from_fragments(data_segments, data, k);
     get_data_ptr_array_from_fragments(parity_segments, parity, m);
 
-    /* call the backend decode function passing it desc instance */
-    ret = instance->common.ops->decode(
-        instance->desc.backend_desc, data_segments, parity_segments, missing_idxs, blocksize);
-
+    /* call the backend reconstruct function passing it desc instance */
+    if (NULL != plan->tables) {
+        ret = instance->common.ops->reconstruct_prepared(
+            instance->desc.backend_desc, plan->tables, data_segments, parity_segments, blocksize);
+    } else if (plan->num_rebuild > 1 && instance->common.ops->reconstruct_multi != NULL) {
+        ret = instance->common.ops->reconstruct_multi(instance->desc.backend_desc,
+            data_segments, parity_segments, (int *)plan->missing_idxs,
+            (int *)plan->rebuild_idxs, blocksize);
+    } else {
+        for (i = 0; i < plan->num_rebuild && ret >= 0; i++) {
+            ret = instance->common.ops->reconstruct(instance->desc.backend_desc, data_segments,
+                parity_segments, (int *)plan->missing_idxs, plan->rebuild_idxs[i], blocksize);
+        }
+    }
     if (ret < 0) {
-        log_error("Encountered error in backend decode function!");
+        log_error("Could not reconstruct fragment!");
         goto out;
     }
 
     /*
-     * Need to fill in the missing data headers so we can generate
-     * the original string.
+     * Update the headers to reflect the newly constructed fragments
      */
-    j = 0;
-    while (missing_idxs[j] >= 0) {
-        int set_chksum = 1;
-        int missing_idx = missing_idxs[j];
-        if (missing_idx < k) {
-            /* Generate headers */
-            char *fragment_ptr = data[missing_idx];
-            init_fragment_header(fragment_ptr);
-            add_fragment_metadata(instance, fragment_ptr, missing_idx, orig_data_size, blocksize,
-                instance->args.uargs.ct, !set_chksum);
+    for (i = 0; i < plan->num_rebuild; i++) {
+        idx = plan->rebuild_idxs[i];
+        fragment_ptr = idx < k ? data[idx] : parity[idx - k];
+        init_fragment_header(fragment_ptr);
+        add_fragment_metadata(instance, fragment_ptr, idx, orig_data_size, blocksize,
+            instance->args.uargs.ct, set_chksum);
+    }
+
+destination_available:
+    /*
+     * Copy the reconstructed fragments to the output buffers
+     *
+     * Note: the addresses in data and parity will be freed below
+     */
+    for (i = 0; plan->destination_idxs[i] > -1; i++) {
+        idx = plan->destination_idxs[i];
+        if (!bm_get_value(&pattern_bm, idx)) {
+            log_warn("Dest idx for reconstruction was supplied as available buffer!");
         }
-        j++;
+        fragment_ptr = idx < k ? data[idx] : parity[idx - k];
+        memcpy(out_fragments[i], fragment_ptr, fragment_len);
     }
 
-    /* Try to generate the original string */
-    ret = fragments_to_string(k, m, data, k, out_data, out_data_len);
+out:
+    /* Free the buffers allocated in prepare_fragments_for_decode */
+    if (bm_any(&realloc_bm)) {
+        for (i = 0; i < k; i++) {
+            if (bm_get_value(&realloc_bm, i)) {
+                free_fragment_buffer_pooled(data[i], pool_depth);
+            }
+        }
+
+        for (i = 0; i < m; i++) {
+            if (bm_get_value(&realloc_bm, i + k)) {
+                free_fragment_buffer_pooled(parity[i], pool_depth);
+            }
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * Reconstruct several missing fragments of a stripe at once
+ *
+ * The available fragments are partitioned and prepared once, and backends
+ * that can rebuild all destinations in a single pass do so.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param available_fragments - erasure encoded fragments
+ * @param num_fragments - number of fragments being passed in
+ * @param fragment_len - size in bytes of the fragments
+ * @param destination_idxs - -1 terminated list of the idxs to reconstruct
+ * @param out_fragments - one output buffer of fragment_len bytes per
+ *        entry of destination_idxs
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_reconstruct_fragments(int desc, char **available_fragments, /* input */
+    int num_fragments, uint64_t fragment_len, /* input */
+    int *destination_idxs, /* input */
+    char **out_fragments) /* output */
+{
+    int ret = 0;
+    struct reconstruct_plan plan;
+
+    int rc = instances_read_lock();
+    if (rc) {
+        /* Should just be EDEADLOCK */
+        return rc;
+    }
+    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    if (NULL == instance) {
+        ret = -EBACKENDNOTAVAIL;
+        goto out;
+    }
+
+    if (NULL == available_fragments) {
+        log_error("Can not reconstruct fragment, available fragments pointer is NULL");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    if (NULL == destination_idxs || NULL == out_fragments) {
+        log_error("Can not reconstruct fragment, destination or output pointer is NULL");
+        ret = -EINVALIDPARAMS;
+        goto out;
+    }
+
+    ret = check_reconstruct_destinations(instance, destination_idxs, out_fragments);
+    if (ret < 0) {
+        goto out;
+    }
 
+    ret = plan_reconstruct(instance, available_fragments, num_fragments, destination_idxs, &plan);
     if (ret < 0) {
-        log_error("Could not convert decoded fragments to a string!");
+        goto out;
     }
+    ret = reconstruct_stripe(
+        instance, &plan, available_fragments, num_fragments, fragment_len, out_fragments, 0);
 
 out:
-    rwlock_unlock(&active_instances_rwlock);
-    /* Free the buffers allocated in prepare_fragments_for_decode */
-    if (bm_any(&realloc_bm)) {
-        for (i = 0; i < k; i++) {
-            if (bm_get_value(&realloc_bm, i)) {
-                free(data[i]);
-            }
-        }
+    instances_read_unlock();
+    return ret;
+}
 
-        for (i = 0; i < m; i++) {
-            if (bm_get_value(&realloc_bm, i + k)) {
-                free(parity[i]);
-            }
-        }
-    }
+/* Smallest share of a batched reconstruct, in rebuilt bytes, worth a thread */
+#define EC_RECONSTRUCT_MIN_BYTES (256 * 1024)
+
+/* A share of the stripes of a batched reconstruct, for one thread */
+struct reconstruct_batch_share {
+    ec_backend_t instance;
+    const struct reconstruct_plan *plan;
+    char ***available_fragments;
+    int num_fragments;
+    uint64_t fragment_len;
+    char **out_fragments;
+    int first; /* first stripe of the share */
+    int last; /* one past the last stripe of the share */
+    int ret;
+    int started; /* runs on its own thread */
+    pthread_t thread;
+};
 
-    free(data);
-    free(parity);
-    free(missing_idxs);
-    free(data_segments);
-    free(parity_segments);
+static void *reconstruct_batch_share(void *arg)
+{
+    struct reconstruct_batch_share *share = (struct reconstruct_batch_share *)arg;
+    int i;
 
-    return ret;
+    share->ret = 0;
+    for (i = share->first; i < share->last && share->ret == 0; i++) {
+        share->ret = reconstruct_stripe(share->instance, share->plan,
+            share->available_fragments[i], share->num_fragments, share->fragment_len,
+            &share->out_fragments[i], 1);
+    }
+
+    return NULL;
 }
 
 /**
- * Reconstruct a missing fragment from a subset of available fragments
+ * Reconstruct the same fragment of many stripes that all lost the same
+ * fragments, e.g. when rebuilding a disk
+ *
+ * Arguments are checked once for the whole batch, and backends that can
+ * share their reconstruct tables across stripes build them once.  The
+ * stripes are split across EC_OPT_WORKER_THREADS threads when that option
+ * is set and the batch is large enough.
  *
  * @param desc - liberasurecode descriptor/handle
  *        from liberasurecode_instance_create()
- * @param fragment_len - size in bytes of the fragments
- * @param available_fragments - erasure encoded fragments
- * @param num_fragments - number of fragments being passed in
- * @param destination_idx - missing idx to reconstruct
- * @param out_fragment - output of reconstruct
- * @return 0 on success, -error code otherwise
+ * @param available_fragments - per stripe, an array of num_fragments
+ *        erasure encoded fragments; every stripe has to provide the same
+ *        fragment idxs
+ * @param num_stripes - number of stripes in the batch
+ * @param num_fragments - number of fragments passed in per stripe
+ * @param fragment_len - size in bytes of the fragments, the same for every
+ *        stripe
+ * @param destination_idx - missing idx to reconstruct in every stripe
+ * @param out_fragments - one output buffer of fragment_len bytes per stripe
+ * @return 0 on success, -error code otherwise, in which case the contents
+ *         of out_fragments are undefined
  */
-int liberasurecode_reconstruct_fragment(int desc, char **available_fragments, /* input */
-    int num_fragments, uint64_t fragment_len, /* input */
+int liberasurecode_reconstruct_fragment_batch(int desc, char ***available_fragments, /* input */
+    int num_stripes, int num_fragments, uint64_t fragment_len, /* input */
     int destination_idx, /* input */
-    char *out_fragment) /* output */
+    char **out_fragments) /* output */
 {
     int ret = 0;
-    int blocksize = 0;
-    int orig_data_size = 0;
-    char **data = NULL;
-    char **parity = NULL;
-    int *missing_idxs = NULL;
-    char *fragment_ptr = NULL;
-    int is_destination_missing = 0;
-    int k = -1;
-    int m = -1;
+    int destination_idxs[2] = { destination_idx, -1 };
+    struct reconstruct_batch_share *shares = NULL;
+    struct reconstruct_plan plan = { .tables = NULL };
+    uint64_t max_shares;
+    int num_shares = 0;
     int i;
-    struct ec_bm realloc_bm = NEW_BM;
-    char **data_segments = NULL;
-    char **parity_segments = NULL;
-    int set_chksum = 1;
 
-    int rc = rwlock_rdlock(&active_instances_rwlock);
+    int rc = instances_read_lock();
     if (rc) {
         /* Should just be EDEADLOCK */
         return rc;
@@ -777,174 +2392,226 @@ int liberasurecode_reconstruct_fragment(int desc, char **available_fragments, /*
         goto out;
     }
 
-    if (NULL == available_fragments) {
-        log_error("Can not reconstruct fragment, available fragments pointer is NULL");
-        ret = -EINVALIDPARAMS;
-        goto out;
-    }
-
-    if (NULL == out_fragment) {
-        log_error("Can not reconstruct fragment, output fragment pointer is NULL");
+    if (NULL == available_fragments || NULL == out_fragments || num_stripes <= 0) {
+        log_error("Invalid params passed to liberasurecode_reconstruct_fragment_batch!");
         ret = -EINVALIDPARAMS;
         goto out;
     }
 
-    k = instance->args.uargs.k;
-    m = instance->args.uargs.m;
-
-    for (i = 0; i < num_fragments; i++) {
-        /* Verify metadata checksum */
-        if (is_invalid_fragment_header((fragment_header_t *)available_fragments[i])) {
-            log_error("Invalid fragment header information!");
-            ret = -EBADHEADER;
+    for (i = 0; i < num_stripes; i++) {
+        if (NULL == available_fragments[i]) {
+            log_error("Can not reconstruct fragment, available fragments pointer is NULL");
+            ret = -EINVALIDPARAMS;
+            goto out;
+        }
+        ret = check_reconstruct_destinations(instance, destination_idxs, &out_fragments[i]);
+        if (ret < 0) {
             goto out;
         }
     }
 
-    /*
-     * Allocate arrays for data, parity and missing_idxs
-     */
-    data = alloc_zeroed_buffer(sizeof(char *) * k);
-    if (NULL == data) {
-        log_error("Could not allocate data buffer!");
-        ret = -ENOMEM;
+    /* The first stripe sets the erasure pattern the others have to share */
+    ret = plan_reconstruct(
+        instance, available_fragments[0], num_fragments, destination_idxs, &plan);
+    if (ret < 0) {
         goto out;
     }
-
-    parity = alloc_zeroed_buffer(sizeof(char *) * m);
-    if (NULL == parity) {
-        log_error("Could not allocate parity buffer!");
-        ret = -ENOMEM;
-        goto out;
+    if (plan.num_rebuild == 1 && NULL != instance->common.ops->reconstruct_prepare) {
+        /* Without tables, each stripe goes through the backend's reconstruct */
+        plan.tables = instance->common.ops->reconstruct_prepare(
+            instance->desc.backend_desc, plan.missing_idxs, plan.rebuild_idxs[0]);
     }
 
-    missing_idxs = alloc_and_set_buffer(sizeof(int *) * (k + m), -1);
-    if (NULL == missing_idxs) {
-        log_error("Could not allocate missing_idxs buffer!");
+    num_shares = instance->opts[EC_OPT_WORKER_THREADS];
+    max_shares = (uint64_t)num_stripes * fragment_len / EC_RECONSTRUCT_MIN_BYTES;
+    if ((uint64_t)num_shares > max_shares) {
+        num_shares = (int)max_shares;
+    }
+    if (num_shares > num_stripes) {
+        num_shares = num_stripes;
+    }
+    if (num_shares < 1) {
+        num_shares = 1;
+    }
+    shares = alloc_zeroed_buffer(sizeof(struct reconstruct_batch_share) * num_shares);
+    if (NULL == shares) {
+        log_error("Could not allocate batch shares!");
         ret = -ENOMEM;
         goto out;
     }
 
-    /*
-     * Separate the fragments into data and parity.  Also determine which
-     * pieces are missing.
-     */
-    ret = get_fragment_partition(
-        k, m, available_fragments, num_fragments, data, parity, missing_idxs);
-
-    if (ret < 0) {
-        log_error("Could not properly partition the fragments!");
-        goto out;
+    for (i = 0; i < num_shares; i++) {
+        shares[i].instance = instance;
+        shares[i].plan = &plan;
+        shares[i].available_fragments = available_fragments;
+        shares[i].num_fragments = num_fragments;
+        shares[i].fragment_len = fragment_len;
+        shares[i].out_fragments = out_fragments;
+        shares[i].first = (int)(((int64_t)num_stripes * i) / num_shares);
+        shares[i].last = (int)(((int64_t)num_stripes * (i + 1)) / num_shares);
     }
 
     /*
-     * Odd corner-case: If the caller passes in a destination_idx that
-     * is also included in the available fragments list, we should *not*
-     * try to reconstruct.
-     *
-     * For now, we will log a warning and do nothing.  In the future, we
-     * should probably log and return an error.
-     *
+     * The calling thread takes the first share; a share whose thread can
+     * not be started is done inline as well
      */
-    i = 0;
-    while (missing_idxs[i] > -1) {
-        if (missing_idxs[i] == destination_idx) {
-            is_destination_missing = 1;
+    for (i = 1; i < num_shares; i++) {
+        shares[i].started
+            = pthread_create(&shares[i].thread, NULL, reconstruct_batch_share, &shares[i]) == 0;
+    }
+    reconstruct_batch_share(&shares[0]);
+    for (i = 1; i < num_shares; i++) {
+        if (shares[i].started) {
+            pthread_join(shares[i].thread, NULL);
+        } else {
+            reconstruct_batch_share(&shares[i]);
         }
-        i++;
     }
 
-    if (!is_destination_missing) {
-        if (destination_idx < k) {
-            fragment_ptr = data[destination_idx];
-        } else {
-            fragment_ptr = parity[destination_idx - k];
-        }
-        log_warn("Dest idx for reconstruction was supplied as available buffer!");
-        goto destination_available;
+    for (i = 0; i < num_shares && ret == 0; i++) {
+        ret = shares[i].ret;
     }
 
-    if (instance->common.ops->check_reconstruct_fragments == NULL) {
-        if (num_fragments < k) {
-            ret = -EINSUFFFRAGS;
-            goto out;
-        }
-    } else {
-        ret = instance->common.ops->check_reconstruct_fragments(
-            instance->desc.backend_desc, missing_idxs, destination_idx);
-        if (ret < 0) {
-            goto out;
-        }
+out:
+    if (NULL != plan.tables) {
+        instance->common.ops->reconstruct_release(instance->desc.backend_desc, plan.tables);
     }
+    instances_read_unlock();
+    free(shares);
+    return ret;
+}
 
-    /*
-     * Preparing the fragments for reconstruction.  This will alloc aligned
-     * buffers when unaligned buffers were passed in available_fragments.
-     * It passes back a bitmap telling us which buffers need to be freed by
-     * us (realloc_bm).
-     */
-    ret = prepare_fragments_for_decode(
-        k, m, data, parity, missing_idxs, &orig_data_size, &blocksize, fragment_len, &realloc_bm);
-    if (ret < 0) {
-        log_error("Could not prepare fragments for reconstruction!");
+/*
+ * Check that fragment belongs to instance, has idx and the instance's
+ * checksum type, and matches the payload and object size in *blocksize
+ * and *orig_data_size; with those still -1, they are taken from it.
+ */
+static int check_update_parity_fragment(
+    ec_backend_t instance, char *fragment, int idx, int *blocksize, int *orig_data_size)
+{
+    fragment_metadata_t metadata;
+    uint32_t libec_version = 0;
+    int ret = read_fragment_metadata(fragment, &metadata, &libec_version, NULL);
+
+    if (ret != 0) {
+        return ret;
+    }
+    if (liberasurecode_verify_fragment_metadata(instance, &metadata) != 0) {
+        log_error("Fragment %d does not belong to this instance!", idx);
+        return -EBADHEADER;
+    }
+    if (*blocksize < 0) {
+        *blocksize = metadata.size;
+        *orig_data_size = metadata.orig_data_size;
+    }
+    if (metadata.idx != (uint32_t)idx || metadata.size != (uint32_t)*blocksize
+        || metadata.orig_data_size != (uint64_t)*orig_data_size
+        || metadata.chksum_type != instance->args.uargs.ct) {
+        log_error("Fragment %d does not match for parity update!", idx);
+        return -EINVALIDPARAMS;
+    }
+
+    return 0;
+}
+
+/**
+ * Bring the parity of a stripe up to date after one of its data fragments
+ * was overwritten, without reading the rest of the stripe
+ *
+ * The backend folds the difference between the old and the new data into
+ * each parity fragment in place; the headers and checksums of the parity
+ * fragments and of new_fragment are refreshed afterwards.
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param data_idx - idx of the data fragment that changed
+ * @param old_fragment - the data fragment as it was
+ * @param new_fragment - the data fragment as it is now; only its payload
+ *        needs to be current, its header is rewritten from old_fragment's
+ * @param parity_fragments - the m parity fragments of the stripe, in idx
+ *        order, updated in place
+ *
+ * @return 0 on success, -EBACKENDNOTSUPP if the backend can not update
+ *         parity in place, -error code otherwise
+ */
+int liberasurecode_update_parity(int desc, int data_idx, char *old_fragment, /* input */
+    char *new_fragment, /* input/output */
+    char **parity_fragments) /* input/output */
+{
+    int ret = 0;
+    int k = -1;
+    int m = -1;
+    int i;
+    int blocksize = -1;
+    int orig_data_size = -1;
+    int set_chksum = 1;
+    char *parity_segments[EC_MAX_FRAGMENTS];
+
+    int rc = instances_read_lock();
+    if (rc) {
+        /* Should just be EDEADLOCK */
+        return rc;
+    }
+    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    if (NULL == instance) {
+        ret = -EBACKENDNOTAVAIL;
         goto out;
     }
-    data_segments = alloc_zeroed_buffer(k * sizeof(char *));
-    parity_segments = alloc_zeroed_buffer(m * sizeof(char *));
-    get_data_ptr_array_from_fragments(data_segments, data, k);
-    get_data_ptr_array_from_fragments(parity_segments, parity, m);
 
-    /* call the backend reconstruct function passing it desc instance */
-    ret = instance->common.ops->reconstruct(instance->desc.backend_desc, data_segments,
-        parity_segments, missing_idxs, destination_idx, blocksize);
-    if (ret < 0) {
-        log_error("Could not reconstruct fragment!");
+    k = instance->args.uargs.k;
+    m = instance->args.uargs.m;
+
+    if (NULL == old_fragment || NULL == new_fragment || NULL == parity_fragments || data_idx < 0
+        || data_idx >= k) {
+        log_error("Invalid params passed to liberasurecode_update_parity!");
+        ret = -EINVALIDPARAMS;
         goto out;
     }
 
-    /*
-     * Update the header to reflect the newly constructed fragment
-     */
-    if (destination_idx < k) {
-        fragment_ptr = data[destination_idx];
-    } else {
-        fragment_ptr = parity[destination_idx - k];
+    if (NULL == instance->common.ops->update_parity) {
+        ret = -EBACKENDNOTSUPP;
+        goto out;
     }
-    init_fragment_header(fragment_ptr);
-    add_fragment_metadata(instance, fragment_ptr, destination_idx, orig_data_size, blocksize,
-        instance->args.uargs.ct, set_chksum);
 
-destination_available:
     /*
-     * Copy the reconstructed fragment to the output buffer
-     *
-     * Note: the address stored in fragment_ptr will be freed below
+     * The old data fragment and all of the parity have to belong to this
+     * instance and to the same stripe layout: same idxs, sizes, object size
+     * and checksum type.  new_fragment takes its layout from old_fragment,
+     * whatever its header says.
      */
-    memcpy(out_fragment, fragment_ptr, fragment_len);
-
-out:
-    rwlock_unlock(&active_instances_rwlock);
-    /* Free the buffers allocated in prepare_fragments_for_decode */
-    if (bm_any(&realloc_bm)) {
-        for (i = 0; i < k; i++) {
-            if (bm_get_value(&realloc_bm, i)) {
-                free(data[i]);
-            }
+    ret = check_update_parity_fragment(instance, old_fragment, data_idx, &blocksize,
+        &orig_data_size);
+    if (ret != 0) {
+        goto out;
+    }
+    for (i = 0; i < m; i++) {
+        ret = check_update_parity_fragment(instance, parity_fragments[i], k + i, &blocksize,
+            &orig_data_size);
+        if (ret != 0) {
+            goto out;
         }
+        parity_segments[i] = get_data_ptr_from_fragment(parity_fragments[i]);
+    }
 
-        for (i = 0; i < m; i++) {
-            if (bm_get_value(&realloc_bm, i + k)) {
-                free(parity[i]);
-            }
-        }
+    ret = instance->common.ops->update_parity(instance->desc.backend_desc, data_idx,
+        get_data_ptr_from_fragment(old_fragment), get_data_ptr_from_fragment(new_fragment),
+        parity_segments, blocksize);
+    if (ret < 0) {
+        log_error("Could not update parity!");
+        goto out;
     }
 
-    free(data);
-    free(parity);
-    free(missing_idxs);
-    free(data_segments);
-    free(parity_segments);
+    memcpy(new_fragment, old_fragment, sizeof(fragment_header_t));
+    ((fragment_header_t *)new_fragment)->magic = LIBERASURECODE_FRAG_HEADER_MAGIC;
+    add_fragment_metadata(instance, new_fragment, data_idx, orig_data_size, blocksize,
+        instance->args.uargs.ct, set_chksum);
+    for (i = 0; i < m; i++) {
+        add_fragment_metadata(instance, parity_fragments[i], k + i, orig_data_size, blocksize,
+            instance->args.uargs.ct, set_chksum);
+    }
 
+out:
+    instances_read_unlock();
     return ret;
 }
 
@@ -967,7 +2634,7 @@ int liberasurecode_fragments_needed(
 {
     int ret = 0;
 
-    int rc = rwlock_rdlock(&active_instances_rwlock);
+    int rc = instances_read_lock();
     if (rc) {
         /* Should just be EDEADLOCK */
         return rc;
@@ -1005,7 +2672,7 @@ int liberasurecode_fragments_needed(
         fragments_to_reconstruct, fragments_to_exclude, fragments_needed);
 
 out_error:
-    rwlock_unlock(&active_instances_rwlock);
+    instances_read_unlock();
     return ret;
 }
 
@@ -1024,73 +2691,69 @@ out_error:
 int liberasurecode_get_fragment_metadata(char *fragment, fragment_metadata_t *fragment_metadata)
 {
     int ret = 0;
-    fragment_header_t *fragment_hdr = NULL;
-
-    if (NULL == fragment) {
-        log_error("Need valid fragment object to get metadata for");
-        ret = -EINVALIDPARAMS;
-        goto out;
-    }
-
-    if (NULL == fragment_metadata) {
-        log_error("Need valid fragment_metadata object for return value");
-        ret = -EINVALIDPARAMS;
-        goto out;
-    }
+    uint32_t libec_version = 0;
 
-    /* Verify metadata checksum */
-    if (is_invalid_fragment_header((fragment_header_t *)fragment)) {
-        log_error("Invalid fragment header information!");
-        ret = -EBADHEADER;
+    ret = read_fragment_metadata(fragment, fragment_metadata, &libec_version, NULL);
+    if (ret != 0) {
         goto out;
     }
 
-    memcpy(fragment_metadata, fragment, sizeof(struct fragment_metadata));
-    fragment_hdr = (fragment_header_t *)fragment;
-    if (LIBERASURECODE_FRAG_HEADER_MAGIC != fragment_hdr->magic) {
-        if (LIBERASURECODE_FRAG_HEADER_MAGIC != bswap_32(fragment_hdr->magic)) {
-            log_error("Invalid fragment, illegal magic value");
-            ret = -EINVALIDPARAMS;
-            goto out;
-        } else {
-            // Must've written this on an opposite-endian architecture.
-            // Fix it in fragment_metadata
-            fragment_metadata->idx = bswap_32(fragment_metadata->idx);
-            fragment_metadata->size = bswap_32(fragment_metadata->size);
-            fragment_metadata->frag_backend_metadata_size
-                = bswap_32(fragment_metadata->frag_backend_metadata_size);
-            fragment_metadata->orig_data_size = bswap_64(fragment_metadata->orig_data_size);
-            fragment_metadata->chksum_type = bswap_32(fragment_metadata->chksum_type);
-            for (int i = 0; i < LIBERASURECODE_MAX_CHECKSUM_LEN; i++) {
-                fragment_metadata->chksum[i] = bswap_32(fragment_metadata->chksum[i]);
-            }
-            fragment_metadata->backend_version = bswap_32(fragment_metadata->backend_version);
-        }
-    }
-
     switch (fragment_metadata->chksum_type) {
     case CHKSUM_CRC32: {
         uint32_t computed_chksum = 0;
         uint32_t stored_chksum = fragment_metadata->chksum[0];
         char *fragment_data = get_data_ptr_from_fragment(fragment);
         uint64_t fragment_size = fragment_metadata->size;
-        computed_chksum = crc32(0, (unsigned char *)fragment_data, fragment_size);
+        computed_chksum = liberasurecode_crc32(0, fragment_data, fragment_size);
         if (stored_chksum != computed_chksum) {
             // Try again with our "alternative" crc32; see
             // https://bugs.launchpad.net/liberasurecode/+bug/1666320
             computed_chksum = liberasurecode_crc32_alt(0, fragment_data, fragment_size);
             if (stored_chksum != computed_chksum) {
                 fragment_metadata->chksum_mismatch = 1;
-            } else {
-                fragment_metadata->chksum_mismatch = 0;
+            } else {
+                fragment_metadata->chksum_mismatch = 0;
+            }
+        } else {
+            fragment_metadata->chksum_mismatch = 0;
+        }
+        break;
+    }
+    case CHKSUM_CRC32C: {
+        char *fragment_data = get_data_ptr_from_fragment(fragment);
+        uint32_t computed_chksum
+            = liberasurecode_crc32c(0, fragment_data, fragment_metadata->size);
+        fragment_metadata->chksum_mismatch = computed_chksum != fragment_metadata->chksum[0];
+        break;
+    }
+    case CHKSUM_XXH64: {
+        char *fragment_data = get_data_ptr_from_fragment(fragment);
+        uint64_t computed_chksum = liberasurecode_xxh64(0, fragment_data, fragment_metadata->size);
+        fragment_metadata->chksum_mismatch
+            = (uint32_t)computed_chksum != fragment_metadata->chksum[0]
+            || (uint32_t)(computed_chksum >> 32) != fragment_metadata->chksum[1];
+        break;
+    }
+    case CHKSUM_MD5: {
+        char *fragment_data = get_data_ptr_from_fragment(fragment);
+        unsigned char digest[16];
+        uint32_t computed_chksum[4];
+        int i;
+        if (libec_version < _VERSION(1, 9, 0)) {
+            /* Older releases wrote MD5 fragments without any digest */
+            fragment_metadata->chksum_mismatch = 0;
+            break;
+        }
+        liberasurecode_md5(fragment_data, fragment_metadata->size, digest);
+        md5_digest_to_chksum(digest, computed_chksum);
+        fragment_metadata->chksum_mismatch = 0;
+        for (i = 0; i < 4; i++) {
+            if (computed_chksum[i] != fragment_metadata->chksum[i]) {
+                fragment_metadata->chksum_mismatch = 1;
             }
-        } else {
-            fragment_metadata->chksum_mismatch = 0;
         }
         break;
     }
-    case CHKSUM_MD5:
-        break;
     case CHKSUM_NONE:
     default:
         break;
@@ -1127,7 +2790,7 @@ int is_invalid_fragment_header(fragment_header_t *header)
         /* no metadata checksum support */
         return 0;
 
-    csum = crc32(0, (unsigned char *)&header->meta, sizeof(fragment_metadata_t));
+    csum = liberasurecode_crc32(0, &header->meta, sizeof(fragment_metadata_t));
     if (metadata_chksum == csum) {
         return 0;
     }
@@ -1150,13 +2813,17 @@ int liberasurecode_verify_fragment_metadata(ec_backend_t be, fragment_metadata_t
     if (!be->common.ops->is_compatible_with(md->backend_version)) {
         return 1;
     }
+    /* A checksum type we do not know can not be verified */
+    if (md->chksum_type >= CHKSUM_TYPES_MAX) {
+        return 1;
+    }
     return 0;
 }
 
 static int is_invalid_fragment_metadata(int desc, fragment_metadata_t *fragment_metadata)
 {
     int ret = 0;
-    int rc = rwlock_rdlock(&active_instances_rwlock);
+    int rc = instances_read_lock();
     if (rc) {
         /* Should just be EDEADLOCK */
         return rc;
@@ -1180,7 +2847,7 @@ static int is_invalid_fragment_metadata(int desc, fragment_metadata_t *fragment_
         goto out;
     }
 out:
-    rwlock_unlock(&active_instances_rwlock);
+    instances_read_unlock();
     return ret;
 }
 
@@ -1189,7 +2856,7 @@ int is_invalid_fragment(int desc, char *fragment)
     int ret = 0;
     uint32_t ver = 0;
     fragment_metadata_t fragment_metadata;
-    int rc = rwlock_rdlock(&active_instances_rwlock);
+    int rc = instances_read_lock();
     if (rc) {
         /* Should just be EDEADLOCK */
         return rc;
@@ -1218,7 +2885,7 @@ int is_invalid_fragment(int desc, char *fragment)
         goto out;
     }
 out:
-    rwlock_unlock(&active_instances_rwlock);
+    instances_read_unlock();
     return ret;
 }
 
@@ -1236,7 +2903,7 @@ int liberasurecode_verify_stripe_metadata(int desc, char **fragments, int num_fr
     }
 
     int ret = 0;
-    int rc = rwlock_rdlock(&active_instances_rwlock);
+    int rc = instances_read_lock();
     if (rc) {
         /* Should just be EDEADLOCK */
         return rc;
@@ -1249,7 +2916,7 @@ int liberasurecode_verify_stripe_metadata(int desc, char **fragments, int num_fr
         }
     }
 out:
-    rwlock_unlock(&active_instances_rwlock);
+    instances_read_unlock();
     return ret;
 }
 
@@ -1269,7 +2936,7 @@ int liberasurecode_get_aligned_data_size(int desc, uint64_t data_len)
     int word_size;
     int alignment_multiple;
 
-    int rc = rwlock_rdlock(&active_instances_rwlock);
+    int rc = instances_read_lock();
     if (rc) {
         /* Should just be EDEADLOCK */
         return rc < 0 ? rc : -rc;
@@ -1289,7 +2956,7 @@ int liberasurecode_get_aligned_data_size(int desc, uint64_t data_len)
     ret = ((data_len + alignment_multiple - 1) / alignment_multiple) * alignment_multiple;
 
 out:
-    rwlock_unlock(&active_instances_rwlock);
+    instances_read_unlock();
     return ret;
 }
 
@@ -1304,7 +2971,7 @@ int liberasurecode_get_minimum_encode_size(int desc)
 
 int liberasurecode_get_fragment_size(int desc, int data_len)
 {
-    int rc = rwlock_rdlock(&active_instances_rwlock);
+    int rc = instances_read_lock();
     if (rc) {
         /* Should just be EDEADLOCK */
         return rc < 0 ? rc : -rc;
@@ -1312,7 +2979,7 @@ int liberasurecode_get_fragment_size(int desc, int data_len)
     ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
     // TODO: Create a common function to calculate fragment size also for preprocessing
     if (NULL == instance) {
-        rwlock_unlock(&active_instances_rwlock);
+        instances_read_unlock();
         return -EBACKENDNOTAVAIL;
     }
     int aligned_data_len = get_aligned_data_size(instance, data_len);
@@ -1321,7 +2988,7 @@ int liberasurecode_get_fragment_size(int desc, int data_len)
         = instance->common.ops->get_backend_metadata_size(instance->desc.backend_desc, blocksize);
     int size = blocksize + metadata_size;
 
-    rwlock_unlock(&active_instances_rwlock);
+    instances_read_unlock();
     return size;
 }
 
@@ -1331,6 +2998,600 @@ int liberasurecode_get_fragment_size(int desc, int data_len)
 
 uint32_t liberasurecode_get_version(void) { return LIBERASURECODE_VERSION; }
 
+/* =~=*=~==~=*=~==~=*=~==~=*=~= streaming encode =~=*=~==~=*=~==~=*=~==~=*=~= */
+
+struct ec_stream_encoder {
+    int desc;
+    int k, m;
+    uint64_t segment_size; /* bytes of input per segment */
+    int blocksize; /* fragment payload size of a full segment */
+    int metadata_size;
+    int data_offset;
+    uint64_t filled; /* input bytes of the current segment received */
+    uint64_t segments; /* segments emitted so far */
+    ec_stream_emit_fn emit;
+    void *ctx;
+    char *slab; /* backing store of fragments */
+    char *fragments[EC_MAX_FRAGMENTS]; /* k + m buffers, reused per segment */
+};
+
+/**
+ * Create a streaming encoder
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param segment_size - number of input bytes encoded together
+ * @param emit - callback receiving the fragments of each segment
+ * @param ctx - opaque pointer passed to emit
+ * @param encoder - _output_ new streaming encoder
+ * @return 0 on success, -error code otherwise
+ */
+int ec_stream_encoder_create(int desc, uint64_t segment_size, ec_stream_emit_fn emit, void *ctx,
+    ec_stream_encoder_t **encoder)
+{
+    struct ec_stream_encoder *enc = NULL;
+    uint64_t stride;
+    int i;
+    int ret = 0;
+
+    if (NULL == emit || NULL == encoder || 0 == segment_size || segment_size > INT_MAX / 2) {
+        log_error("Invalid params passed to ec_stream_encoder_create!");
+        return -EINVALIDPARAMS;
+    }
+
+    enc = calloc(1, sizeof(*enc));
+    if (NULL == enc) {
+        return -ENOMEM;
+    }
+
+    int rc = instances_read_lock();
+    if (rc != 0) {
+        /* Should just be EDEADLOCK */
+        free(enc);
+        return rc < 0 ? rc : -rc;
+    }
+    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    if (NULL == instance) {
+        ret = -EBACKENDNOTAVAIL;
+        goto unlock;
+    }
+
+    enc->desc = desc;
+    enc->k = instance->args.uargs.k;
+    enc->m = instance->args.uargs.m;
+    enc->segment_size = segment_size;
+    enc->emit = emit;
+    enc->ctx = ctx;
+    stride = EC_ALIGN_UP(get_encode_layout(instance, segment_size, &enc->blocksize,
+                             &enc->metadata_size, &enc->data_offset),
+        EC_CACHELINE_SIZE);
+
+    if (posix_memalign((void **)&enc->slab, EC_CACHELINE_SIZE, stride * (enc->k + enc->m)) != 0) {
+        log_error("Could not allocate stream encoder buffers!");
+        ret = -ENOMEM;
+        goto unlock;
+    }
+    for (i = 0; i < enc->k + enc->m; i++) {
+        enc->fragments[i] = enc->slab + stride * i;
+    }
+
+unlock:
+    instances_read_unlock();
+    if (ret) {
+        free(enc);
+        return ret;
+    }
+    *encoder = enc;
+    return 0;
+}
+
+/*
+ * Encode the current segment, whose 'len' bytes were laid out in the data
+ * fragments as feed() received them, and hand the fragments to emit().
+ */
+static int stream_encode_segment(struct ec_stream_encoder *enc, uint64_t len)
+{
+    int i;
+    int k = enc->k, m = enc->m;
+    int blocksize = enc->blocksize;
+    int buffer_size = enc->blocksize + enc->metadata_size;
+    char *ptrs[EC_MAX_FRAGMENTS];
+    char *tmp = NULL;
+    uint64_t fragment_len;
+    struct ec_fused_chksum fused;
+    struct ec_fused_chksum *fc;
+    int ret = 0;
+
+    int rc = instances_read_lock();
+    if (rc != 0) {
+        /* Should just be EDEADLOCK */
+        return rc < 0 ? rc : -rc;
+    }
+    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(enc->desc);
+    if (NULL == instance) {
+        ret = -EBACKENDNOTAVAIL;
+        goto unlock;
+    }
+    fc = init_fused_chksum(instance, &fused);
+
+    if (len == enc->segment_size) {
+        /*
+         * The data is in place already: just reset the headers and zero
+         * everything around it (nothing is copied from an empty cursor).
+         * Its checksums are left to the encode, which reads it anyway.
+         */
+        struct ec_iov_cursor none = { NULL, 0, 0 };
+        for (i = 0; i < k + m; i++) {
+            int64_t in_frag = (int64_t)len - (int64_t)i * blocksize;
+            int copy_size = (i >= k || in_frag <= 0) ? 0
+                : (in_frag > blocksize ? blocksize : (int)in_frag);
+            fill_fragment_buffer(enc->fragments[i], buffer_size, enc->data_offset, &none,
+                copy_size, NULL, 0);
+            ptrs[i] = get_data_ptr_from_fragment(enc->fragments[i]);
+        }
+    } else {
+        /*
+         * A short, final segment gets a smaller layout.  When neither the
+         * blocksize nor the data offset grow back, every byte moves to the
+         * same or a later address in the slab: lay the data out again in
+         * place, last byte first.  Otherwise (the offset follows the backend
+         * metadata, which may shrink with the blocksize) gather it into a
+         * temporary buffer first.  prepare_fragments_for_encode_into() then
+         * fills in the headers and padding around it.
+         */
+        int new_blocksize, metadata_size, data_offset;
+        struct iovec iov = { NULL, len };
+        uint64_t end = len;
+
+        get_encode_layout(instance, len, &new_blocksize, &metadata_size, &data_offset);
+        if (data_offset >= enc->data_offset && new_blocksize <= blocksize) {
+            while (end > 0) {
+                uint64_t old_start = (end - 1) / blocksize * blocksize;
+                uint64_t new_start = (end - 1) / new_blocksize * new_blocksize;
+                uint64_t start = old_start > new_start ? old_start : new_start;
+
+                memmove(get_data_ptr_from_fragment(enc->fragments[start / new_blocksize])
+                        + data_offset + start % new_blocksize,
+                    get_data_ptr_from_fragment(enc->fragments[start / blocksize])
+                        + enc->data_offset + start % blocksize,
+                    end - start);
+                end = start;
+            }
+        } else {
+            uint64_t off = 0;
+
+            tmp = malloc(len ? len : 1);
+            if (NULL == tmp) {
+                ret = -ENOMEM;
+                goto unlock;
+            }
+            for (i = 0; i < k && off < len; i++) {
+                uint64_t n = len - off > (uint64_t)blocksize ? (uint64_t)blocksize : len - off;
+                memcpy(tmp + off, get_data_ptr_from_fragment(enc->fragments[i]) + enc->data_offset,
+                    n);
+                off += n;
+            }
+            iov.iov_base = tmp;
+        }
+        ret = prepare_fragments_for_encode_into(instance, k, m, tmp ? &iov : NULL, tmp ? 1 : 0,
+            len, enc->fragments, ptrs, ptrs + k, &blocksize, fc);
+        if (ret < 0) {
+            goto unlock;
+        }
+    }
+
+    ret = encode_stripe(instance, ptrs, ptrs + k, blocksize, fc);
+    if (ret < 0) {
+        log_error("Encountered error in backend encode function!");
+        goto unlock;
+    }
+
+    ret = finalize_fragments_after_encode(instance, k, m, blocksize, len, ptrs, ptrs + k, fc);
+
+unlock:
+    instances_read_unlock();
+    free(tmp);
+    if (ret < 0) {
+        return ret;
+    }
+
+    /* Don't hold up instance create/destroy while the caller sends data */
+    fragment_len = get_fragment_size(ptrs[0]);
+    enc->segments++;
+    return enc->emit(enc->ctx, ptrs, k + m, fragment_len);
+}
+
+/**
+ * Feed data to a streaming encoder
+ *
+ * @param encoder - streaming encoder from ec_stream_encoder_create()
+ * @param data - next bytes of the object
+ * @param len - number of bytes in data
+ * @return 0 on success, -error code or the emit callback's non-zero return
+ *         otherwise
+ */
+int ec_stream_encoder_feed(ec_stream_encoder_t *encoder, const char *data, uint64_t len)
+{
+    struct ec_stream_encoder *enc = encoder;
+    int ret = 0;
+
+    if (NULL == enc || (NULL == data && len > 0)) {
+        return -EINVALIDPARAMS;
+    }
+
+    while (len > 0) {
+        /* Copy straight to where this byte goes in its data fragment */
+        uint64_t idx = enc->filled / enc->blocksize;
+        uint64_t off = enc->filled % enc->blocksize;
+        uint64_t n = enc->blocksize - off;
+
+        if (n > enc->segment_size - enc->filled) {
+            n = enc->segment_size - enc->filled;
+        }
+        if (n > len) {
+            n = len;
+        }
+        memcpy(get_data_ptr_from_fragment(enc->fragments[idx]) + enc->data_offset + off, data, n);
+        enc->filled += n;
+        data += n;
+        len -= n;
+
+        if (enc->filled == enc->segment_size) {
+            enc->filled = 0;
+            ret = stream_encode_segment(enc, enc->segment_size);
+            if (ret) {
+                return ret;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Encode and emit whatever data is left, then release the encoder
+ *
+ * @param encoder - streaming encoder from ec_stream_encoder_create()
+ * @return 0 on success, -error code or the emit callback's non-zero return
+ *         otherwise
+ */
+int ec_stream_encoder_finish(ec_stream_encoder_t *encoder)
+{
+    struct ec_stream_encoder *enc = encoder;
+    int ret = 0;
+
+    if (NULL == enc) {
+        return -EINVALIDPARAMS;
+    }
+
+    /* An empty object still gets (empty) fragments */
+    if (enc->filled > 0 || enc->segments == 0) {
+        ret = stream_encode_segment(enc, enc->filled);
+    }
+
+    ec_stream_encoder_destroy(enc);
+    return ret;
+}
+
+/**
+ * Release a streaming encoder without encoding any pending data
+ *
+ * @param encoder - streaming encoder from ec_stream_encoder_create()
+ */
+void ec_stream_encoder_destroy(ec_stream_encoder_t *encoder)
+{
+    if (NULL == encoder) {
+        return;
+    }
+    free(encoder->slab);
+    free(encoder);
+}
+
+/* =~=*=~==~=*=~==~=*=~==~=*=~= streaming decode =~=*=~==~=*=~==~=*=~==~=*=~= */
+
+struct ec_stream_source {
+    char *buf; /* current fragment */
+    uint64_t buf_cap;
+    uint64_t received; /* bytes of the current fragment seen */
+    uint64_t fragment_len; /* known once the header is in */
+    uint64_t segment; /* segment the current fragment belongs to */
+    int complete;
+};
+
+struct ec_stream_decoder {
+    int desc;
+    int k, m;
+    uint64_t segment; /* segment being assembled */
+    int num_complete; /* sources holding a whole fragment of it */
+    ec_stream_output_fn output;
+    void *ctx;
+    char *out; /* decode buffer for segments that need decoding */
+    uint64_t out_cap;
+    struct ec_stream_source sources[EC_MAX_FRAGMENTS];
+};
+
+/**
+ * Create a streaming decoder
+ *
+ * @param desc - liberasurecode descriptor/handle
+ *        from liberasurecode_instance_create()
+ * @param output - callback receiving the decoded object bytes in order
+ * @param ctx - opaque pointer passed to output
+ * @param decoder - _output_ new streaming decoder
+ * @return 0 on success, -error code otherwise
+ */
+int ec_stream_decoder_create(
+    int desc, ec_stream_output_fn output, void *ctx, ec_stream_decoder_t **decoder)
+{
+    struct ec_stream_decoder *dec = NULL;
+    int ret = 0;
+
+    if (NULL == output || NULL == decoder) {
+        log_error("Invalid params passed to ec_stream_decoder_create!");
+        return -EINVALIDPARAMS;
+    }
+
+    int rc = instances_read_lock();
+    if (rc != 0) {
+        /* Should just be EDEADLOCK */
+        return rc < 0 ? rc : -rc;
+    }
+    ec_backend_t instance = liberasurecode_backend_instance_get_by_desc(desc);
+    if (NULL == instance) {
+        ret = -EBACKENDNOTAVAIL;
+        goto unlock;
+    }
+
+    dec = calloc(1, sizeof(*dec));
+    if (NULL == dec) {
+        ret = -ENOMEM;
+        goto unlock;
+    }
+    dec->desc = desc;
+    dec->k = instance->args.uargs.k;
+    dec->m = instance->args.uargs.m;
+    dec->output = output;
+    dec->ctx = ctx;
+    *decoder = dec;
+
+unlock:
+    instances_read_unlock();
+    return ret;
+}
+
+/*
+ * Decode the current segment from the sources holding a whole fragment of
+ * it, pass the data on and move every source on to the next segment.  The
+ * segment is left in place if those fragments are not enough to decode it.
+ */
+static int stream_decode_segment(struct ec_stream_decoder *dec)
+{
+    char *frags[EC_MAX_FRAGMENTS];
+    struct iovec iov[EC_MAX_FRAGMENTS];
+    int iovcnt = EC_MAX_FRAGMENTS;
+    uint64_t fragment_len = 0;
+    uint64_t out_len = 0;
+    int num_frags = 0;
+    int i;
+    int ret;
+
+    for (i = 0; i < dec->k + dec->m; i++) {
+        struct ec_stream_source *src = &dec->sources[i];
+        if (src->complete && src->segment == dec->segment) {
+            if (num_frags > 0 && src->fragment_len != fragment_len) {
+                log_error("Inconsistent fragment sizes in segment %lu!",
+                    (unsigned long)dec->segment);
+                return -EBADHEADER;
+            }
+            fragment_len = src->fragment_len;
+            frags[num_frags++] = src->buf;
+        }
+    }
+
+    /* No copy at all if the data fragments are there */
+    ret = liberasurecode_decode_iov(
+        dec->desc, frags, num_frags, fragment_len, iov, &iovcnt, &out_len);
+    if (ret == -EINSUFFFRAGS || ret == -EBACKENDNOTSUPP) {
+        uint64_t needed = get_orig_data_size(frags[0]);
+        if (needed > dec->out_cap) {
+            char *out = realloc(dec->out, needed);
+            if (NULL == out) {
+                return -ENOMEM;
+            }
+            dec->out = out;
+            dec->out_cap = needed;
+        }
+        ret = liberasurecode_decode_into(
+            dec->desc, frags, num_frags, fragment_len, 0, dec->out, dec->out_cap, &out_len);
+        iov[0].iov_base = dec->out;
+        iov[0].iov_len = out_len;
+        iovcnt = 1;
+    }
+    if (ret == -EBADHEADER || ret == -ENOMEM) {
+        return ret;
+    } else if (ret) {
+        /*
+         * Not every set of k fragments decodes with a non-MDS code; wait
+         * for the next one as long as any source may still deliver it
+         */
+        if (num_frags < dec->k + dec->m) {
+            return 0;
+        }
+        return ret;
+    }
+
+    for (i = 0; i < iovcnt; i++) {
+        ret = dec->output(dec->ctx, iov[i].iov_base, iov[i].iov_len);
+        if (ret) {
+            return ret;
+        }
+    }
+
+    /*
+     * Sources with a partial (or no) fragment of this segment are behind
+     * now, their fragment gets skipped
+     */
+    for (i = 0; i < dec->k + dec->m; i++) {
+        struct ec_stream_source *src = &dec->sources[i];
+        if (src->complete) {
+            src->complete = 0;
+            src->received = 0;
+            src->segment++;
+        }
+    }
+    dec->num_complete = 0;
+    dec->segment++;
+
+    return 0;
+}
+
+/**
+ * Feed fragment bytes from one source to a streaming decoder
+ *
+ * @param decoder - streaming decoder from ec_stream_decoder_create()
+ * @param source - which of the k + m fragment streams the bytes belong to
+ * @param data - next bytes of that fragment stream
+ * @param len - number of bytes in data
+ * @param consumed - _output_ number of bytes taken; less than len when
+ *        the source is ahead of the others, feed the rest later
+ * @return 0 on success, -error code or the output callback's non-zero
+ *         return otherwise
+ */
+int ec_stream_decoder_feed(ec_stream_decoder_t *decoder, int source, const char *data,
+    uint64_t len, uint64_t *consumed)
+{
+    struct ec_stream_decoder *dec = decoder;
+    struct ec_stream_source *src;
+    int ret = 0;
+
+    if (NULL == dec || NULL == consumed || (NULL == data && len > 0) || source < 0
+        || source >= dec->k + dec->m) {
+        return -EINVALIDPARAMS;
+    }
+
+    *consumed = 0;
+    src = &dec->sources[source];
+
+    while (len > 0) {
+        uint64_t n;
+
+        if (src->complete) {
+            /* Ahead of the others: hold off until the segment is decoded */
+            break;
+        }
+
+        if (src->received < sizeof(fragment_header_t)) {
+            if (NULL == src->buf) {
+                if (posix_memalign((void **)&src->buf, EC_CACHELINE_SIZE,
+                        sizeof(fragment_header_t)) != 0) {
+                    src->buf = NULL;
+                    return -ENOMEM;
+                }
+                src->buf_cap = sizeof(fragment_header_t);
+            }
+            n = sizeof(fragment_header_t) - src->received;
+            n = n < len ? n : len;
+            memcpy(src->buf + src->received, data, n);
+        } else {
+            n = src->fragment_len - src->received;
+            n = n < len ? n : len;
+            /* Fragments of segments already decoded are skipped */
+            if (src->segment == dec->segment) {
+                memcpy(src->buf + src->received, data, n);
+            }
+        }
+        src->received += n;
+        data += n;
+        len -= n;
+        *consumed += n;
+
+        if (src->received == sizeof(fragment_header_t)) {
+            if (is_invalid_fragment_header((fragment_header_t *)src->buf)) {
+                log_error("Invalid fragment header in stream %d!", source);
+                return -EBADHEADER;
+            }
+            src->fragment_len = get_fragment_size(src->buf);
+            if (src->fragment_len > src->buf_cap && src->segment == dec->segment) {
+                char *buf = NULL;
+                if (posix_memalign((void **)&buf, EC_CACHELINE_SIZE, src->fragment_len) != 0) {
+                    return -ENOMEM;
+                }
+                memcpy(buf, src->buf, sizeof(fragment_header_t));
+                free(src->buf);
+                src->buf = buf;
+                src->buf_cap = src->fragment_len;
+            }
+        }
+
+        if (src->received >= sizeof(fragment_header_t) && src->received == src->fragment_len) {
+            if (src->segment < dec->segment) {
+                src->segment++;
+                src->received = 0;
+                continue;
+            }
+            src->complete = 1;
+            if (++dec->num_complete >= dec->k) {
+                ret = stream_decode_segment(dec);
+                if (ret) {
+                    return ret;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Check that the streams ended on a segment boundary, then release the
+ * decoder
+ *
+ * @param decoder - streaming decoder from ec_stream_decoder_create()
+ * @return 0 on success, -EINSUFFFRAGS if a segment was left incomplete,
+ *         -error code otherwise
+ */
+int ec_stream_decoder_finish(ec_stream_decoder_t *decoder)
+{
+    struct ec_stream_decoder *dec = decoder;
+    int ret = 0;
+    int i;
+
+    if (NULL == dec) {
+        return -EINVALIDPARAMS;
+    }
+
+    for (i = 0; i < dec->k + dec->m; i++) {
+        if (dec->sources[i].segment == dec->segment && dec->sources[i].received > 0) {
+            log_error("Stream ended without enough fragments for segment %lu!",
+                (unsigned long)dec->segment);
+            ret = -EINSUFFFRAGS;
+            break;
+        }
+    }
+
+    ec_stream_decoder_destroy(dec);
+    return ret;
+}
+
+/**
+ * Release a streaming decoder
+ *
+ * @param decoder - streaming decoder from ec_stream_decoder_create()
+ */
+void ec_stream_decoder_destroy(ec_stream_decoder_t *decoder)
+{
+    int i;
+
+    if (NULL == decoder) {
+        return;
+    }
+    for (i = 0; i < EC_MAX_FRAGMENTS; i++) {
+        free(decoder->sources[i].buf);
+    }
+    free(decoder->out);
+    free(decoder);
+}
+
 /* ==~=*=~==~=*=~==~=*=~==~=*=~==~=* misc *=~==~=*=~==~=*=~==~=*=~==~=*=~== */
 
 #if 0
@@ -33,7 +33,6 @@
 #include <assert.h>
 #include <stdarg.h>
 #include <stdio.h>
-#include <zlib.h>
 
 #include "alg_sig.h"
 #include "erasurecode_log.h"
@@ -460,12 +459,34 @@ int get_backend_version(char *buf, uint32_t *version)
 
 /* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
 
+/*
+ * Whether CRC32 checksums should be written with the legacy
+ * liberasurecode_crc32_alt() rather than liberasurecode_crc32(), so that
+ * older readers can still verify them
+ */
+__attribute__((visibility("internal"))) int use_legacy_crc(void)
+{
+    char *flag = getenv("LIBERASURECODE_WRITE_LEGACY_CRC");
+
+    return flag && !(flag[0] == '\0' || (flag[0] == '0' && flag[1] == '\0'));
+}
+
+static void set_md5_words(fragment_header_t *header, const unsigned char *digest)
+{
+    uint32_t words[4];
+    int i;
+
+    md5_digest_to_chksum(digest, words);
+    for (i = 0; i < 4; i++) {
+        header->meta.chksum[i] = words[i];
+    }
+}
+
 __attribute__((visibility("internal"))) inline int set_checksum(
     ec_checksum_type_t ct, char *buf, int blocksize)
 {
     fragment_header_t *header = (fragment_header_t *)buf;
     char *data = get_data_ptr_from_fragment(buf);
-    char *flag;
 
     assert(NULL != header);
     if (header->magic != LIBERASURECODE_FRAG_HEADER_MAGIC) {
@@ -478,15 +499,27 @@ __attribute__((visibility("internal"))) inline int set_checksum(
 
     switch (header->meta.chksum_type) {
     case CHKSUM_CRC32:
-        flag = getenv("LIBERASURECODE_WRITE_LEGACY_CRC");
-        if (flag && !(flag[0] == '\0' || (flag[0] == '0' && flag[1] == '\0'))) {
+        if (use_legacy_crc()) {
             header->meta.chksum[0] = liberasurecode_crc32_alt(0, data, blocksize);
         } else {
-            header->meta.chksum[0] = crc32(0, (unsigned char *)data, blocksize);
+            header->meta.chksum[0] = liberasurecode_crc32(0, data, blocksize);
         }
         break;
-    case CHKSUM_MD5:
+    case CHKSUM_CRC32C:
+        header->meta.chksum[0] = liberasurecode_crc32c(0, data, blocksize);
+        break;
+    case CHKSUM_XXH64: {
+        uint64_t h = liberasurecode_xxh64(0, data, blocksize);
+        header->meta.chksum[0] = (uint32_t)h;
+        header->meta.chksum[1] = (uint32_t)(h >> 32);
         break;
+    }
+    case CHKSUM_MD5: {
+        unsigned char digest[16];
+        liberasurecode_md5(data, blocksize, digest);
+        set_md5_words(header, digest);
+        break;
+    }
     case CHKSUM_NONE:
     default:
         break;
@@ -495,4 +528,75 @@ __attribute__((visibility("internal"))) inline int set_checksum(
     return 0;
 }
 
+/*
+ * MD5 digests are kept as the four words of the MD5 state, in host order
+ * like every other checksum word, so that headers written on an
+ * opposite-endian host are fixed up the same way
+ */
+__attribute__((visibility("internal"))) void md5_digest_to_chksum(
+    const unsigned char *digest, uint32_t *chksum)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        chksum[i] = (uint32_t)digest[i * 4] | (uint32_t)digest[i * 4 + 1] << 8
+            | (uint32_t)digest[i * 4 + 2] << 16 | (uint32_t)digest[i * 4 + 3] << 24;
+    }
+}
+
+/*
+ * Same as set_checksum() for CHKSUM_MD5, with the digest of the payload
+ * already computed by the caller
+ */
+__attribute__((visibility("internal"))) int set_md5_checksum(char *buf, const unsigned char *digest)
+{
+    fragment_header_t *header = (fragment_header_t *)buf;
+
+    assert(NULL != header);
+    if (header->magic != LIBERASURECODE_FRAG_HEADER_MAGIC) {
+        log_error("Invalid fragment header (set chksum)!\n");
+        return -1;
+    }
+
+    header->meta.chksum_type = CHKSUM_MD5;
+    header->meta.chksum_mismatch = 0;
+    set_md5_words(header, digest);
+
+    return 0;
+}
+
+/*
+ * Same as set_checksum() for CHKSUM_CRC32, with the CRC of the payload
+ * already computed by the caller
+ */
+__attribute__((visibility("internal"))) int set_crc32_checksum(char *buf, uint32_t crc)
+{
+    fragment_header_t *header = (fragment_header_t *)buf;
+
+    assert(NULL != header);
+    if (header->magic != LIBERASURECODE_FRAG_HEADER_MAGIC) {
+        log_error("Invalid fragment header (set chksum)!\n");
+        return -1;
+    }
+
+    header->meta.chksum_type = CHKSUM_CRC32;
+    header->meta.chksum_mismatch = 0;
+    header->meta.chksum[0] = crc;
+
+    return 0;
+}
+
+/*
+ * Continue the CRC32 of a payload over the next len bytes, using the
+ * same function set_checksum() would
+ */
+__attribute__((visibility("internal"))) uint32_t fused_chksum_update(
+    const struct ec_fused_chksum *fc, uint32_t crc, const char *buf, uint64_t len)
+{
+    if (fc->legacy) {
+        return liberasurecode_crc32_alt(crc, buf, len);
+    }
+    return liberasurecode_crc32(crc, buf, len);
+}
+
 /* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
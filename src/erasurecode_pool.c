@@ -0,0 +1,372 @@
+/*
+ * Copyright 2026 liberasurecode authors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.  THIS SOFTWARE IS PROVIDED BY
+ * THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * liberasurecode per-thread fragment buffer pool
+ *
+ * Fragment buffers are rounded up to a size class (four classes per power
+ * of two, so at most 25% is wasted) and, once released, kept on a free
+ * list owned by the releasing thread instead of going back to malloc.
+ * Every pooled buffer is preceded by a cacheline-sized header recording
+ * its class and how many buffers of that class a thread may keep.
+ *
+ * vi: set noai tw=79 ts=4 sw=4:
+ */
+#include "erasurecode.h"
+#include "erasurecode_backend.h"
+#include "erasurecode_helpers.h"
+#include "erasurecode_helpers_ext.h"
+#include "erasurecode_stdinc.h"
+#include "list.h"
+
+#include "erasurecode_log.h"
+
+#define EC_POOL_MAGIC 0xec9001
+#define EC_POOL_MIN_SHIFT 12 /* smallest class: 4 KiB */
+#define EC_POOL_MAX_SHIFT 30 /* buffers above 1 GiB are never cached */
+#define EC_POOL_NUM_CLASSES (((EC_POOL_MAX_SHIFT - EC_POOL_MIN_SHIFT) * 4) + 1)
+#define EC_POOL_HDR_SIZE EC_CACHELINE_SIZE
+
+struct ec_pool_hdr {
+    uint32_t magic;
+    int cls; /* size class, -1 if not cacheable */
+    int depth; /* max buffers of this class a thread may keep */
+    struct ec_pool_hdr *next; /* free list link */
+};
+
+struct ec_pool_class {
+    struct ec_pool_hdr *head;
+    int count;
+};
+
+struct ec_thread_pool {
+    struct ec_pool_class classes[EC_POOL_NUM_CLASSES];
+    struct ec_buffer_pool_stats stats; /* written by the owner thread only */
+    SLIST_ENTRY(ec_thread_pool) link;
+};
+
+static pthread_once_t pool_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t pool_key;
+static int pool_key_valid = 0;
+
+/* All live thread pools, plus the stats of threads that already exited */
+static pthread_mutex_t pool_list_lock = PTHREAD_MUTEX_INITIALIZER;
+static SLIST_HEAD(pool_list, ec_thread_pool) pool_list = SLIST_HEAD_INITIALIZER(pool_list);
+static struct ec_buffer_pool_stats retired_stats;
+
+static inline void pool_stat_inc(uint64_t *counter)
+{
+    /* Only the owner writes, but stats readers may look at any time */
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+}
+
+static void add_pool_stats(struct ec_buffer_pool_stats *dst, struct ec_buffer_pool_stats *src)
+{
+    dst->hits += __atomic_load_n(&src->hits, __ATOMIC_RELAXED);
+    dst->misses += __atomic_load_n(&src->misses, __ATOMIC_RELAXED);
+    dst->recycled += __atomic_load_n(&src->recycled, __ATOMIC_RELAXED);
+    dst->released += __atomic_load_n(&src->released, __ATOMIC_RELAXED);
+}
+
+static void flush_thread_pool(struct ec_thread_pool *tp)
+{
+    int i;
+
+    for (i = 0; i < EC_POOL_NUM_CLASSES; i++) {
+        struct ec_pool_hdr *hdr = tp->classes[i].head;
+        while (NULL != hdr) {
+            struct ec_pool_hdr *next = hdr->next;
+            free(hdr);
+            hdr = next;
+        }
+        tp->classes[i].head = NULL;
+        tp->classes[i].count = 0;
+    }
+}
+
+static void destroy_thread_pool(void *arg)
+{
+    struct ec_thread_pool *tp = (struct ec_thread_pool *)arg;
+
+    flush_thread_pool(tp);
+
+    pthread_mutex_lock(&pool_list_lock);
+    SLIST_REMOVE(&pool_list, tp, ec_thread_pool, link);
+    add_pool_stats(&retired_stats, &tp->stats);
+    pthread_mutex_unlock(&pool_list_lock);
+
+    free(tp);
+}
+
+static void create_pool_key(void)
+{
+    pool_key_valid = (pthread_key_create(&pool_key, destroy_thread_pool) == 0);
+}
+
+/*
+ * Return the calling thread's pool, creating it on first use.  NULL
+ * means the pool is unavailable, in which case buffers are simply not
+ * cached.
+ */
+static struct ec_thread_pool *get_thread_pool(int create)
+{
+    struct ec_thread_pool *tp;
+
+    pthread_once(&pool_key_once, create_pool_key);
+    if (!pool_key_valid) {
+        return NULL;
+    }
+
+    tp = (struct ec_thread_pool *)pthread_getspecific(pool_key);
+    if (NULL != tp || !create) {
+        return tp;
+    }
+
+    tp = (struct ec_thread_pool *)calloc(1, sizeof(*tp));
+    if (NULL == tp) {
+        return NULL;
+    }
+    if (pthread_setspecific(pool_key, tp) != 0) {
+        free(tp);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&pool_list_lock);
+    SLIST_INSERT_HEAD(&pool_list, tp, link);
+    pthread_mutex_unlock(&pool_list_lock);
+
+    return tp;
+}
+
+/*
+ * Map an allocation size (pool header included) to its size class and
+ * the number of bytes actually allocated for that class.
+ */
+static int get_size_class(size_t total, size_t *class_size)
+{
+    int shift = EC_POOL_MIN_SHIFT;
+    size_t steps;
+
+    if (total <= ((size_t)1 << EC_POOL_MIN_SHIFT)) {
+        *class_size = (size_t)1 << EC_POOL_MIN_SHIFT;
+        return 0;
+    }
+
+    /* shift = floor(log2(total - 1)); classes are quarters of 2^shift */
+    while (((total - 1) >> (shift + 1)) != 0) {
+        shift++;
+    }
+    if (shift >= EC_POOL_MAX_SHIFT) {
+        *class_size = total;
+        return -1;
+    }
+
+    steps = ((total - 1) >> (shift - 2)) + 1; /* 5..8 quarters */
+    *class_size = steps << (shift - 2);
+    return ((shift - EC_POOL_MIN_SHIFT) * 4) + (int)(steps - 5) + 1;
+}
+
+/*
+ * Take a buffer for a fragment of 'size' payload bytes off the calling
+ * thread's pool, or allocate a new one.  Its contents are undefined.
+ */
+static char *get_pooled_buffer(int size, int depth)
+{
+    struct ec_thread_pool *tp;
+    struct ec_pool_hdr *hdr = NULL;
+    size_t total = (size_t)size + sizeof(fragment_header_t) + EC_POOL_HDR_SIZE;
+    size_t class_size = 0;
+    int cls;
+
+    tp = get_thread_pool(1);
+    cls = get_size_class(total, &class_size);
+    if (cls >= 0 && NULL != tp && NULL != tp->classes[cls].head) {
+        hdr = tp->classes[cls].head;
+        tp->classes[cls].head = hdr->next;
+        tp->classes[cls].count--;
+        pool_stat_inc(&tp->stats.hits);
+    } else {
+        if (NULL != tp) {
+            pool_stat_inc(&tp->stats.misses);
+        }
+        if (posix_memalign((void **)&hdr, EC_CACHELINE_SIZE, class_size) != 0) {
+            return NULL;
+        }
+        hdr->magic = EC_POOL_MAGIC;
+        hdr->cls = cls;
+    }
+    hdr->depth = depth;
+    hdr->next = NULL;
+
+    return (char *)hdr + EC_POOL_HDR_SIZE;
+}
+
+/*
+ * Like alloc_fragment_buffer(), but recycle a buffer from the calling
+ * thread's pool if 'depth' (buffers per size class a thread may keep) is
+ * positive.  Buffers must be released with free_fragment_buffer_pooled()
+ * using the same 'depth' sign.
+ */
+__attribute__((visibility("internal"))) char *alloc_fragment_buffer_pooled(int size, int depth)
+{
+    char *buf;
+
+    if (depth <= 0) {
+        return alloc_fragment_buffer(size);
+    }
+
+    buf = get_pooled_buffer(size, depth);
+    if (NULL == buf) {
+        return NULL;
+    }
+
+    /* Same contract as alloc_fragment_buffer(): zeroed, magic set */
+    memset(buf, 0, (size_t)size + sizeof(fragment_header_t));
+    init_fragment_header(buf);
+
+    return buf;
+}
+
+/*
+ * Same as alloc_fragment_buffer_pooled(), but a recycled buffer is handed
+ * out as is, for callers that lay the whole fragment out themselves with
+ * fill_fragment_buffer()
+ */
+__attribute__((visibility("internal"))) char *alloc_fragment_buffer_pooled_dirty(
+    int size, int depth)
+{
+    if (depth <= 0) {
+        return alloc_fragment_buffer(size);
+    }
+
+    return get_pooled_buffer(size, depth);
+}
+
+/*
+ * Release a fragment buffer (header included) obtained from
+ * alloc_fragment_buffer_pooled().  It goes back to the calling thread's
+ * pool if there is one; a pool is never created just to take it, so
+ * buffers outliving a released pool are simply freed.
+ */
+__attribute__((visibility("internal"))) int free_fragment_buffer_pooled(char *buf, int depth)
+{
+    struct ec_thread_pool *tp;
+    struct ec_pool_hdr *hdr;
+
+    if (NULL == buf) {
+        return -1;
+    }
+
+    if (depth <= 0) {
+        free(buf);
+        return 0;
+    }
+
+    hdr = (struct ec_pool_hdr *)(buf - EC_POOL_HDR_SIZE);
+    if (hdr->magic != EC_POOL_MAGIC) {
+        log_error("Invalid pool header (free fragment)!");
+        return -EBADHEADER;
+    }
+
+    tp = get_thread_pool(0);
+    if (NULL != tp && hdr->cls >= 0 && tp->classes[hdr->cls].count < hdr->depth) {
+        hdr->next = tp->classes[hdr->cls].head;
+        tp->classes[hdr->cls].head = hdr;
+        tp->classes[hdr->cls].count++;
+        pool_stat_inc(&tp->stats.recycled);
+        return 0;
+    }
+
+    if (NULL != tp) {
+        pool_stat_inc(&tp->stats.released);
+    }
+    free(hdr);
+    return 0;
+}
+
+/*
+ * Free the calling thread's pool and every buffer it caches.  Threads
+ * that exit have theirs freed by the key destructor, but that never runs
+ * for the main thread.
+ */
+__attribute__((visibility("internal"))) void release_thread_buffer_pool(void)
+{
+    struct ec_thread_pool *tp = get_thread_pool(0);
+
+    if (NULL != tp) {
+        pthread_setspecific(pool_key, NULL);
+        destroy_thread_pool(tp);
+    }
+}
+
+/*
+ * Delete the pool thread key at library unload, so threads that outlive
+ * a dlclose() do not run a destructor that is no longer mapped.  Their
+ * pools are leaked rather than freed.
+ */
+__attribute__((visibility("internal"))) void delete_thread_buffer_pool_key(void)
+{
+    if (pool_key_valid) {
+        pool_key_valid = 0;
+        pthread_key_delete(pool_key);
+    }
+}
+
+/**
+ * Get the fragment buffer pool statistics, summed over all threads
+ *
+ * @param stats - _output_ pool statistics
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_get_buffer_pool_stats(struct ec_buffer_pool_stats *stats)
+{
+    struct ec_thread_pool *tp;
+
+    if (NULL == stats) {
+        return -EINVALIDPARAMS;
+    }
+
+    pthread_mutex_lock(&pool_list_lock);
+    *stats = retired_stats;
+    SLIST_FOREACH(tp, &pool_list, link) {
+        add_pool_stats(stats, &tp->stats);
+    }
+    pthread_mutex_unlock(&pool_list_lock);
+
+    return 0;
+}
+
+/**
+ * Release all fragment buffers cached by the calling thread
+ *
+ * @return 0 on success, -error code otherwise
+ */
+int liberasurecode_buffer_pool_flush(void)
+{
+    struct ec_thread_pool *tp = get_thread_pool(0);
+
+    if (NULL != tp) {
+        flush_thread_pool(tp);
+    }
+
+    return 0;
+}
@@ -32,7 +32,7 @@
 #include "erasurecode_helpers_ext.h"
 #include "erasurecode_log.h"
 #include "erasurecode_stdinc.h"
-#include <zlib.h>
+#include "md5.h"
 
 __attribute__((visibility("internal"))) void add_fragment_metadata(ec_backend_t be, char *fragment,
     int idx, uint64_t orig_data_size, int blocksize, ec_checksum_type_t ct, int add_chksum)
@@ -58,23 +58,45 @@ __attribute__((visibility("internal"))) void add_fragment_metadata(ec_backend_t
         return;
     }
 
-    char *flag = getenv("LIBERASURECODE_WRITE_LEGACY_CRC");
-    if (flag && !(flag[0] == '\0' || (flag[0] == '0' && flag[1] == '\0'))) {
+    if (use_legacy_crc()) {
         header->metadata_chksum
             = liberasurecode_crc32_alt(0, &header->meta, sizeof(fragment_metadata_t));
     } else {
         header->metadata_chksum
-            = crc32(0, (unsigned char *)&header->meta, sizeof(fragment_metadata_t));
+            = liberasurecode_crc32(0, &header->meta, sizeof(fragment_metadata_t));
     }
 }
 
 __attribute__((visibility("internal"))) int finalize_fragments_after_encode(ec_backend_t instance,
     int k, int m, int blocksize, uint64_t orig_data_size, char **encoded_data,
-    char **encoded_parity)
+    char **encoded_parity, const struct ec_fused_chksum *fc)
 {
     int i, set_chksum = 1;
     ec_checksum_type_t ct = instance->args.uargs.ct;
 
+    /* checksums computed during the encode only need storing */
+    if (NULL != fc) {
+        for (i = 0; i < k + m; i++) {
+            char *data = i < k ? encoded_data[i] : encoded_parity[i - k];
+            set_crc32_checksum(get_fragment_ptr_from_data(data), fc->crc[i]);
+        }
+        set_chksum = 0;
+    } else if (ct == CHKSUM_MD5) {
+        /* The payloads are all blocksize long: digest them side by side */
+        const unsigned char *payloads[EC_MAX_FRAGMENTS] = { NULL };
+        unsigned char digests[EC_MAX_FRAGMENTS][16];
+
+        for (i = 0; i < k + m; i++) {
+            payloads[i] = (unsigned char *)(i < k ? encoded_data[i] : encoded_parity[i - k]);
+        }
+        md5_multi(payloads, k + m, blocksize, digests);
+        for (i = 0; i < k + m; i++) {
+            char *data = i < k ? encoded_data[i] : encoded_parity[i - k];
+            set_md5_checksum(get_fragment_ptr_from_data(data), digests[i]);
+        }
+        set_chksum = 0;
+    }
+
     /* finalize data fragments */
     for (i = 0; i < k; i++) {
         char *fragment = get_fragment_ptr_from_data(encoded_data[i]);
@@ -33,53 +33,245 @@
 #include "erasurecode_log.h"
 #include "erasurecode_stdinc.h"
 
+/*
+ * Compute the layout shared by every fragment of one encode: the payload
+ * size (blocksize), the backend metadata size and the offset of the data
+ * within the payload.
+ *
+ * Returns the full fragment length, header included.
+ */
+__attribute__((visibility("internal"))) uint64_t get_encode_layout(ec_backend_t instance,
+    uint64_t orig_data_size, int *blocksize, int *metadata_size, int *data_offset)
+{
+    int k = instance->args.uargs.k;
+
+    /* aligned_data_len guaranteed to be divisible by k */
+    *blocksize = get_aligned_data_size(instance, orig_data_size) / k;
+    *metadata_size
+        = instance->common.ops->get_backend_metadata_size(instance->desc.backend_desc, *blocksize);
+    *data_offset
+        = instance->common.ops->get_encode_offset(instance->desc.backend_desc, *metadata_size);
+
+    return sizeof(fragment_header_t) + *blocksize + *metadata_size;
+}
+
+/*
+ * Copy len bytes out of a scatter-gather list, advancing the cursor.  A
+ * segment may be split across several calls, and several segments may be
+ * gathered by a single call.
+ */
+__attribute__((visibility("internal"))) void iov_cursor_copy(
+    struct ec_iov_cursor *cur, char *dst, uint64_t len)
+{
+    while (len > 0 && cur->iovcnt > 0) {
+        size_t avail = cur->iov->iov_len - cur->off;
+        size_t n = avail < len ? avail : len;
+
+        memcpy(dst, (char *)cur->iov->iov_base + cur->off, n);
+        dst += n;
+        len -= n;
+        cur->off += n;
+
+        if (cur->off == cur->iov->iov_len) {
+            cur->iov++;
+            cur->iovcnt--;
+            cur->off = 0;
+        }
+    }
+}
+
+/*
+ * Copy copy_size bytes from src at data_offset in a payload whose other
+ * bytes are zeroed already.  With fc set, the copy goes a chunk at a time
+ * and each chunk is CRCed while still in cache, leaving the checksum of
+ * the whole payload in fc->crc[idx].
+ */
+static void copy_payload(char *payload, int data_offset, struct ec_iov_cursor *src,
+    int copy_size, struct ec_fused_chksum *fc, int idx)
+{
+    uint32_t crc;
+    int off;
+
+    if (NULL == fc) {
+        if (copy_size > 0) {
+            iov_cursor_copy(src, payload + data_offset, copy_size);
+        }
+        return;
+    }
+
+    crc = fused_chksum_update(fc, 0, payload, data_offset);
+    for (off = 0; off < copy_size; off += EC_FUSED_CHKSUM_CHUNK) {
+        int n = copy_size - off > EC_FUSED_CHKSUM_CHUNK ? EC_FUSED_CHKSUM_CHUNK : copy_size - off;
+
+        iov_cursor_copy(src, payload + data_offset + off, n);
+        crc = fused_chksum_update(fc, crc, payload + data_offset + off, n);
+    }
+    fc->crc[idx] = fused_chksum_update(fc, crc, payload + data_offset + copy_size,
+        fc->payload_size - data_offset - copy_size);
+}
+
+/*
+ * Lay out a fragment in a buffer that is not known to be zeroed: write a
+ * clean header, copy copy_size bytes from src at data_offset in the payload
+ * and zero whatever the copy does not cover.  buffer_size excludes the
+ * header.  With fc set, the payload CRC ends up in fc->crc[idx].
+ */
+__attribute__((visibility("internal"))) void fill_fragment_buffer(char *fragment, int buffer_size,
+    int data_offset, struct ec_iov_cursor *src, int copy_size, struct ec_fused_chksum *fc, int idx)
+{
+    char *payload = get_data_ptr_from_fragment(fragment);
+
+    memset(fragment, 0, sizeof(fragment_header_t));
+    init_fragment_header(fragment);
+
+    if (copy_size <= 0) {
+        copy_size = 0;
+        data_offset = 0;
+    }
+    memset(payload, 0, data_offset);
+    memset(payload + data_offset + copy_size, 0, buffer_size - data_offset - copy_size);
+    copy_payload(payload, data_offset, src, copy_size, fc, idx);
+}
+
+/*
+ * Same as prepare_fragments_for_encode(), but lays the k + m fragments out
+ * in caller-owned buffers instead of allocating them.  The caller has
+ * checked that each buffer is aligned and big enough for the layout
+ * returned by get_encode_layout().
+ */
+__attribute__((visibility("internal"))) int prepare_fragments_for_encode_into(
+    ec_backend_t instance, int k, int m, const struct iovec *iov, int iovcnt, /* input */
+    uint64_t orig_data_size, char **fragments, /* input */
+    char **encoded_data, char **encoded_parity, /* output */
+    int *blocksize, struct ec_fused_chksum *fc)
+{
+    int i;
+    int metadata_size, data_offset;
+    uint64_t data_len = orig_data_size;
+    int buffer_size;
+    struct ec_iov_cursor src = { iov, iovcnt, 0 };
+
+    get_encode_layout(instance, orig_data_size, blocksize, &metadata_size, &data_offset);
+    buffer_size = *blocksize + metadata_size;
+    if (NULL != fc) {
+        fc->payload_size = *blocksize;
+        fc->have_data = 1;
+    }
+
+    for (i = 0; i < k; i++) {
+        int copy_size = data_len > *blocksize ? *blocksize : data_len;
+
+        fill_fragment_buffer(fragments[i], buffer_size, data_offset, &src, copy_size, fc, i);
+        encoded_data[i] = get_data_ptr_from_fragment(fragments[i]);
+
+        data_len -= copy_size;
+    }
+
+    for (i = 0; i < m; i++) {
+        fill_fragment_buffer(fragments[k + i], buffer_size, 0, NULL, 0, NULL, 0);
+        encoded_parity[i] = get_data_ptr_from_fragment(fragments[k + i]);
+    }
+
+    return 0;
+}
+
+/*
+ * Same as prepare_fragments_for_encode(), but the k + m fragments and the
+ * data/parity pointer arrays are carved out of a single cache-line aligned
+ * slab.  Only the bytes the data copy does not overwrite get zeroed.
+ *
+ * The data array holds one extra slot, (*encoded_data)[k], which points back
+ * at the slab itself; liberasurecode_encode_cleanup() uses it to tell that
+ * everything goes away with a single free().
+ */
+__attribute__((visibility("internal"))) int prepare_fragments_for_encode_slab(
+    ec_backend_t instance, int k, int m, const struct iovec *iov, int iovcnt, /* input */
+    uint64_t orig_data_size, /* input */
+    char ***encoded_data, char ***encoded_parity, /* output */
+    int *blocksize, struct ec_fused_chksum *fc)
+{
+    int i;
+    int metadata_size, data_offset;
+    uint64_t ptrs_size, stride;
+    char *fragments[EC_MAX_FRAGMENTS];
+    char **ptrs = NULL;
+    char *slab = NULL;
+
+    ptrs_size = EC_ALIGN_UP(sizeof(char *) * (k + 1 + m), EC_CACHELINE_SIZE);
+    stride = EC_ALIGN_UP(
+        get_encode_layout(instance, orig_data_size, blocksize, &metadata_size, &data_offset),
+        EC_CACHELINE_SIZE);
+
+    if (posix_memalign((void **)&slab, EC_CACHELINE_SIZE, ptrs_size + stride * (k + m)) != 0) {
+        log_error("Could not allocate fragment slab!");
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < k + m; i++) {
+        fragments[i] = slab + ptrs_size + stride * i;
+    }
+
+    ptrs = (char **)slab;
+    ptrs[k] = slab;
+    *encoded_data = ptrs;
+    *encoded_parity = ptrs + k + 1;
+
+    return prepare_fragments_for_encode_into(
+        instance, k, m, iov, iovcnt, orig_data_size, fragments, ptrs, ptrs + k + 1, blocksize, fc);
+}
+
 __attribute__((visibility("internal"))) int prepare_fragments_for_encode(ec_backend_t instance,
-    int k, int m, const char *orig_data, uint64_t orig_data_size, /* input */
+    int k, int m, const struct iovec *iov, int iovcnt, uint64_t orig_data_size, /* input */
     char **encoded_data, char **encoded_parity, /* output */
-    int *blocksize)
+    int *blocksize, struct ec_fused_chksum *fc)
 {
     int i, ret = 0;
     int data_len; /* data len to write to fragment headers */
-    int aligned_data_len; /* EC algorithm compatible data length */
     int buffer_size, payload_size = 0;
     int metadata_size, data_offset = 0;
+    struct ec_iov_cursor src = { iov, iovcnt, 0 };
+    int pool_depth = instance->opts[EC_OPT_BUFFER_POOL];
 
-    /* Calculate data sizes, aligned_data_len guaranteed to be divisible by k*/
+    /* Calculate data sizes */
     data_len = orig_data_size;
-    aligned_data_len = get_aligned_data_size(instance, orig_data_size);
-    *blocksize = payload_size = (aligned_data_len / k);
-    metadata_size
-        = instance->common.ops->get_backend_metadata_size(instance->desc.backend_desc, *blocksize);
-    data_offset
-        = instance->common.ops->get_encode_offset(instance->desc.backend_desc, metadata_size);
+    get_encode_layout(instance, orig_data_size, blocksize, &metadata_size, &data_offset);
+    payload_size = *blocksize;
     buffer_size = payload_size + metadata_size;
+    if (NULL != fc) {
+        fc->payload_size = payload_size;
+        fc->have_data = 1;
+    }
 
     for (i = 0; i < k; i++) {
         int copy_size = data_len > payload_size ? payload_size : data_len;
-        char *fragment = (char *)alloc_fragment_buffer(buffer_size);
+        char *fragment = alloc_fragment_buffer_pooled_dirty(buffer_size, pool_depth);
         if (NULL == fragment) {
             ret = -ENOMEM;
             goto out_error;
         }
 
-        /* Copy existing data into clean, zero'd out buffer */
         encoded_data[i] = get_data_ptr_from_fragment(fragment);
-
-        if (data_len > 0) {
-            memcpy(encoded_data[i] + data_offset, orig_data, copy_size);
+        if (pool_depth > 0) {
+            /* Recycled buffers are not zeroed: only clear what the copy leaves */
+            fill_fragment_buffer(fragment, buffer_size, data_offset, &src, copy_size, fc, i);
+        } else {
+            /* Copy existing data into clean, zero'd out buffer */
+            copy_payload(encoded_data[i], data_offset, &src, copy_size, fc, i);
         }
 
-        orig_data += copy_size;
         data_len -= copy_size;
     }
 
     for (i = 0; i < m; i++) {
-        char *fragment = (char *)alloc_fragment_buffer(buffer_size);
+        char *fragment = alloc_fragment_buffer_pooled_dirty(buffer_size, pool_depth);
         if (NULL == fragment) {
             ret = -ENOMEM;
             goto out_error;
         }
 
+        if (pool_depth > 0) {
+            fill_fragment_buffer(fragment, buffer_size, 0, NULL, 0, NULL, 0);
+        }
         encoded_parity[i] = get_data_ptr_from_fragment(fragment);
     }
 
@@ -87,27 +279,18 @@ out:
     return ret;
 
 out_error:
-    printf("ERROR in encode\n");
-    if (encoded_data) {
-        for (i = 0; i < k; i++) {
-            if (encoded_data[i])
-                free_fragment_buffer(encoded_data[i]);
-        }
-        check_and_free_buffer(encoded_data);
-    }
-
-    if (encoded_parity) {
-        for (i = 0; i < m; i++) {
-            if (encoded_parity[i])
-                free_fragment_buffer(encoded_parity[i]);
-        }
-        check_and_free_buffer(encoded_parity);
-    }
-
+    /*
+     * The caller owns whatever was allocated so far and releases it with
+     * liberasurecode_encode_cleanup()
+     */
+    log_error("Could not allocate fragment buffer for encode!");
     goto out;
 }
 
 /*
+ * Buffers for missing parity are only allocated if with_missing_parity is
+ * set, otherwise those entries stay NULL.
+ *
  * Note that the caller should always check realloc_bm during success or
  * failure to free buffers allocated here.  We could free up in this function,
  * but it is internal to this library and only used in a few places.  In any
@@ -116,7 +299,7 @@ out_error:
  */
 __attribute__((visibility("internal"))) int prepare_fragments_for_decode(int k, int m, char **data,
     char **parity, int *missing_idxs, int *orig_size, int *fragment_payload_size, int fragment_size,
-    struct ec_bm *realloc_bm)
+    int pool_depth, int with_missing_parity, struct ec_bm *realloc_bm)
 {
     int i; /* a counter */
     struct ec_bm missing_bm = NEW_BM; /* bitmap form of missing indexes list */
@@ -139,14 +322,16 @@ __attribute__((visibility("internal"))) int prepare_fragments_for_decode(int k,
          * 'data_list'
          */
         if (NULL == data[i]) {
-            data[i] = alloc_fragment_buffer(fragment_size - sizeof(fragment_header_t));
+            data[i] = alloc_fragment_buffer_pooled(
+                fragment_size - sizeof(fragment_header_t), pool_depth);
             if (NULL == data[i]) {
                 log_error("Could not allocate data buffer!");
                 return -ENOMEM;
             }
             bm_set_value(realloc_bm, i, 1);
         } else if (!is_addr_aligned((unsigned long)data[i], 16)) {
-            char *tmp_buf = alloc_fragment_buffer(fragment_size - sizeof(fragment_header_t));
+            char *tmp_buf = alloc_fragment_buffer_pooled(
+                fragment_size - sizeof(fragment_header_t), pool_depth);
             if (NULL == tmp_buf) {
                 log_error("Could not allocate temp buffer!");
                 return -ENOMEM;
@@ -178,14 +363,19 @@ __attribute__((visibility("internal"))) int prepare_fragments_for_decode(int k,
          * DO NOT FREE: the python GC should free the original when cleaning up 'data_list'
          */
         if (NULL == parity[i]) {
-            parity[i] = alloc_fragment_buffer(fragment_size - sizeof(fragment_header_t));
+            if (!with_missing_parity) {
+                continue;
+            }
+            parity[i] = alloc_fragment_buffer_pooled(
+                fragment_size - sizeof(fragment_header_t), pool_depth);
             if (NULL == parity[i]) {
                 log_error("Could not allocate parity buffer!");
                 return -ENOMEM;
             }
             bm_set_value(realloc_bm, k + i, 1);
         } else if (!is_addr_aligned((unsigned long)parity[i], 16)) {
-            char *tmp_buf = alloc_fragment_buffer(fragment_size - sizeof(fragment_header_t));
+            char *tmp_buf = alloc_fragment_buffer_pooled(
+                fragment_size - sizeof(fragment_header_t), pool_depth);
             if (NULL == tmp_buf) {
                 log_error("Could not allocate temp buffer!");
                 return -ENOMEM;
@@ -266,42 +456,28 @@ int get_fragment_partition(
     return 0;
 }
 
-__attribute__((visibility("internal"))) int fragments_to_string(
-    int k, int m, char **fragments, int num_fragments, char **orig_payload, uint64_t *payload_len)
+/*
+ * Pick the k data fragments out of 'fragments' and place them in index
+ * order in 'data', validating the headers along the way.
+ *
+ * Returns 0 when all k data fragments are present, 1 when some are
+ * missing (not an error), -error otherwise.
+ */
+static int get_data_fragments_in_order(
+    int k, char **fragments, int num_fragments, char **data, int *orig_size)
 {
-    char *internal_payload = NULL;
-    char **data = NULL;
     int orig_data_size = -1;
     int i;
     int index;
     int data_size;
     int num_data = 0;
-    int string_off = 0;
-    int ret = -1;
-
-    if (num_fragments < k) {
-        /*
-         * This is not necessarily an error condition, so *do not log here*
-         * We can maybe debug log, if necessary.
-         */
-        goto out;
-    }
-
-    data = (char **)get_aligned_buffer16(sizeof(char *) * k);
-
-    if (NULL == data) {
-        log_error("Could not allocate buffer for data!!");
-        ret = -ENOMEM;
-        goto out;
-    }
 
     for (i = 0; i < num_fragments; i++) {
         index = get_fragment_idx(fragments[i]);
         data_size = get_fragment_payload_size(fragments[i]);
         if ((index < 0) || (data_size < 0)) {
             log_error("Invalid fragment header information!");
-            ret = -EBADHEADER;
-            goto out;
+            return -EBADHEADER;
         }
 
         /* Validate the original data size */
@@ -310,8 +486,7 @@ __attribute__((visibility("internal"))) int fragments_to_string(
         } else {
             if (get_orig_data_size(fragments[i]) != orig_data_size) {
                 log_error("Inconsistent orig_data_size in fragment header!");
-                ret = -EBADHEADER;
-                goto out;
+                return -EBADHEADER;
             }
         }
 
@@ -327,8 +502,41 @@ __attribute__((visibility("internal"))) int fragments_to_string(
         }
     }
 
+    *orig_size = orig_data_size;
+
     /* We do not have enough data fragments to do this! */
-    if (num_data != k) {
+    return (num_data == k) ? 0 : 1;
+}
+
+/*
+ * Copy the payloads of the k index-ordered data fragments into 'dst',
+ * stopping once orig_data_size bytes have been written.
+ */
+static void copy_data_fragments(int k, char **data, int orig_data_size, char *dst)
+{
+    int i;
+    int string_off = 0;
+
+    /* Copy fragment data into cstring (fragments should be in index order) */
+    for (i = 0; i < k && orig_data_size > 0; i++) {
+        char *fragment_data = get_data_ptr_from_fragment(data[i]);
+        int fragment_size = get_fragment_payload_size(data[i]);
+        int payload_size = orig_data_size > fragment_size ? fragment_size : orig_data_size;
+        memcpy(dst + string_off, fragment_data, payload_size);
+        orig_data_size -= payload_size;
+        string_off += payload_size;
+    }
+}
+
+__attribute__((visibility("internal"))) int fragments_to_string(
+    int k, int m, char **fragments, int num_fragments, char **orig_payload, uint64_t *payload_len)
+{
+    char *internal_payload = NULL;
+    char **data = NULL;
+    int orig_data_size = -1;
+    int ret = -1;
+
+    if (num_fragments < k) {
         /*
          * This is not necessarily an error condition, so *do not log here*
          * We can maybe debug log, if necessary.
@@ -336,6 +544,24 @@ __attribute__((visibility("internal"))) int fragments_to_string(
         goto out;
     }
 
+    data = (char **)get_aligned_buffer16(sizeof(char *) * k);
+
+    if (NULL == data) {
+        log_error("Could not allocate buffer for data!!");
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    ret = get_data_fragments_in_order(k, fragments, num_fragments, data, &orig_data_size);
+    if (ret != 0) {
+        /*
+         * Missing data fragments are not necessarily an error condition,
+         * so *do not log here*
+         */
+        ret = (ret < 0) ? ret : -1;
+        goto out;
+    }
+
     /* Create the string to return */
     internal_payload = (char *)get_aligned_buffer16(orig_data_size);
     if (NULL == internal_payload) {
@@ -347,15 +573,7 @@ __attribute__((visibility("internal"))) int fragments_to_string(
     /* Pass the original data length back */
     *payload_len = orig_data_size;
 
-    /* Copy fragment data into cstring (fragments should be in index order) */
-    for (i = 0; i < num_data && orig_data_size > 0; i++) {
-        char *fragment_data = get_data_ptr_from_fragment(data[i]);
-        int fragment_size = get_fragment_payload_size(data[i]);
-        int payload_size = orig_data_size > fragment_size ? fragment_size : orig_data_size;
-        memcpy(internal_payload + string_off, fragment_data, payload_size);
-        orig_data_size -= payload_size;
-        string_off += payload_size;
-    }
+    copy_data_fragments(k, data, orig_data_size, internal_payload);
 
     /* Everything worked just fine */
     ret = 0;
@@ -368,3 +586,73 @@ out:
     *orig_payload = internal_payload;
     return ret;
 }
+
+__attribute__((visibility("internal"))) int fragments_to_buffer(int k, int m, char **fragments,
+    int num_fragments, char *buf, uint64_t buf_len, uint64_t *payload_len)
+{
+    char *data[EC_MAX_FRAGMENTS] = { NULL };
+    int orig_data_size = -1;
+    int ret = -1;
+
+    if (num_fragments < k) {
+        /*
+         * This is not necessarily an error condition, so *do not log here*
+         * We can maybe debug log, if necessary.
+         */
+        return -1;
+    }
+
+    ret = get_data_fragments_in_order(k, fragments, num_fragments, data, &orig_data_size);
+    if (ret != 0) {
+        return (ret < 0) ? ret : -1;
+    }
+
+    /* Pass the original data length back, even if it does not fit */
+    *payload_len = orig_data_size;
+    if (buf_len < (uint64_t)orig_data_size) {
+        log_error("Decode buffer too small, need %d bytes, got %lu!", orig_data_size,
+            (unsigned long)buf_len);
+        return -EINVALIDPARAMS;
+    }
+
+    copy_data_fragments(k, data, orig_data_size, buf);
+
+    return 0;
+}
+
+__attribute__((visibility("internal"))) int fragments_to_iov(int k, int m, char **fragments,
+    int num_fragments, struct iovec *iov, int *iovcnt, uint64_t *payload_len)
+{
+    char *data[EC_MAX_FRAGMENTS] = { NULL };
+    int orig_data_size = -1;
+    int num_iov = 0;
+    int i;
+    int ret = -1;
+
+    if (num_fragments < k) {
+        return -1;
+    }
+
+    ret = get_data_fragments_in_order(k, fragments, num_fragments, data, &orig_data_size);
+    if (ret != 0) {
+        return (ret < 0) ? ret : -1;
+    }
+
+    /* Point at the payloads in place, trimmed to the original data size */
+    *payload_len = orig_data_size;
+    for (i = 0; i < k && orig_data_size > 0; i++) {
+        int fragment_size = get_fragment_payload_size(data[i]);
+        int payload_size = orig_data_size > fragment_size ? fragment_size : orig_data_size;
+        if (num_iov >= *iovcnt) {
+            log_error("Not enough iovec entries, need at least %d!", num_iov + 1);
+            return -EINVALIDPARAMS;
+        }
+        iov[num_iov].iov_base = get_data_ptr_from_fragment(data[i]);
+        iov[num_iov].iov_len = payload_size;
+        orig_data_size -= payload_size;
+        num_iov++;
+    }
+    *iovcnt = num_iov;
+
+    return 0;
+}
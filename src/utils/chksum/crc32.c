@@ -40,8 +40,17 @@
  * CRC32 code derived from work by Gary S. Brown.
  */
 
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <sys/param.h>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define CRC32_HAVE_PCLMUL 1
+#endif
+
 static int crc32_tab[] = { 0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
     0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988, 0x09b64c2b, 0x7eb17cbd,
     0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2, 0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb,
@@ -76,16 +85,340 @@ static int crc32_tab[] = { 0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076
     0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94, 0xb40bbe37, 0xc30c8ea1,
     0x5a05df1b, 0x2d02ef8d };
 
+/*
+ * Slice-by-8 tables for one CRC: byte[] is its classic byte-at-a-time
+ * table and t[j][v] the register after eight bytes when starting from
+ * zero with byte j set to v and the others cleared.  The CRCs are linear,
+ * so eight bytes are handled with eight lookups, the first four bytes of
+ * input xored with the register.  For the legacy CRC the sign smeared in
+ * by the top bit of the register adds 'smear'.
+ */
+struct crc32_slice8_tables {
+    uint32_t byte[256];
+    uint32_t t[8][256];
+    uint32_t smear;
+    int legacy;
+};
+
+static struct crc32_slice8_tables crc32_zlib_tables;
+static struct crc32_slice8_tables crc32_legacy_tables;
+static struct crc32_slice8_tables crc32c_tables;
+static uint32_t (*crc32_zlib_impl)(uint32_t crc, const unsigned char *buf, size_t size);
+static uint32_t (*crc32c_impl)(uint32_t crc, const unsigned char *buf, size_t size);
+static pthread_once_t crc32_init_once = PTHREAD_ONCE_INIT;
+
+/*
+ * One byte, bit-reflected, over the conditioned register.  The legacy CRC
+ * shifts the register arithmetically: a signed int was shifted where an
+ * unsigned one was meant, and fragments with those checksums are still
+ * around.
+ */
+static uint32_t crc32_step(const struct crc32_slice8_tables *tables, uint32_t crc, unsigned char b)
+{
+    uint32_t shifted = crc >> 8;
+
+    if (tables->legacy && (crc & 0x80000000U)) {
+        shifted |= 0xFF000000U;
+    }
+    return tables->byte[(crc ^ b) & 0xFF] ^ shifted;
+}
+
+static uint32_t crc32_run8(const struct crc32_slice8_tables *tables, uint32_t crc,
+    const unsigned char *b)
+{
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        crc = crc32_step(tables, crc, b[i]);
+    }
+    return crc;
+}
+
+/* Fill in the slice tables from the byte table */
+static void crc32_fill_tables(struct crc32_slice8_tables *tables, int legacy)
+{
+    unsigned char b[8] = { 0 };
+    int j, v;
+
+    tables->legacy = legacy;
+    for (j = 0; j < 8; j++) {
+        for (v = 0; v < 256; v++) {
+            b[j] = (unsigned char)v;
+            tables->t[j][v] = crc32_run8(tables, 0, b);
+        }
+        b[j] = 0;
+    }
+    tables->smear = crc32_run8(tables, 0x80000000U, b) ^ tables->t[3][0x80];
+}
+
+/* Byte table of the reflected polynomial poly */
+static void crc32_fill_byte_table(struct crc32_slice8_tables *tables, uint32_t poly)
+{
+    int i, v;
+
+    for (v = 0; v < 256; v++) {
+        uint32_t c = v;
+
+        for (i = 0; i < 8; i++) {
+            c = (c & 1) ? poly ^ (c >> 1) : c >> 1;
+        }
+        tables->byte[v] = c;
+    }
+}
+
+static uint32_t crc32_slice8(
+    const struct crc32_slice8_tables *tables, uint32_t crc, const unsigned char *p, size_t size)
+{
+    const uint32_t(*t)[256] = tables->t;
+
+    while (size >= 8) {
+        uint32_t lo = crc
+            ^ ((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+
+        crc = t[7][p[7]] ^ t[6][p[6]] ^ t[5][p[5]] ^ t[4][p[4]] ^ t[3][lo >> 24]
+            ^ t[2][(lo >> 16) & 0xFF] ^ t[1][(lo >> 8) & 0xFF] ^ t[0][lo & 0xFF]
+            ^ ((0U - (crc >> 31)) & tables->smear);
+        p += 8;
+        size -= 8;
+    }
+    while (size--) {
+        crc = crc32_step(tables, crc, *p++);
+    }
+    return crc;
+}
+
+static uint32_t crc32_zlib_slice8(uint32_t crc, const unsigned char *buf, size_t size)
+{
+    return crc32_slice8(&crc32_zlib_tables, crc, buf, size);
+}
+
+static uint32_t crc32c_slice8(uint32_t crc, const unsigned char *buf, size_t size)
+{
+    return crc32_slice8(&crc32c_tables, crc, buf, size);
+}
+
+#ifdef CRC32_HAVE_PCLMUL
+/*
+ * Fold 16 bytes at a time with carry-less multiplies, four lanes in
+ * parallel, then Barrett-reduce to 32 bits; see Gopal et al., "Fast CRC
+ * Computation for Generic Polynomials Using PCLMULQDQ Instruction".  The
+ * constants are those of the bit-reflected zlib polynomial.  Takes at
+ * least 64 bytes and a multiple of 16.
+ */
+__attribute__((target("pclmul,sse4.1"))) static uint32_t crc32_fold_pclmul(
+    uint32_t crc, const unsigned char *buf, size_t size)
+{
+    static const uint64_t k1k2[2] __attribute__((aligned(16))) = { 0x0154442bd4, 0x01c6e41596 };
+    static const uint64_t k3k4[2] __attribute__((aligned(16))) = { 0x01751997d0, 0x00ccaa009e };
+    static const uint64_t k5k0[2] __attribute__((aligned(16))) = { 0x0163cd6124, 0x0000000000 };
+    static const uint64_t poly[2] __attribute__((aligned(16))) = { 0x01db710641, 0x01f7011641 };
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+    x1 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    x0 = _mm_load_si128((const __m128i *)k1k2);
+    buf += 64;
+    size -= 64;
+
+    /* Fold four lanes of 16 bytes over the next 64 */
+    while (size >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+        y5 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+        y6 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+        y7 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+        y8 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+        buf += 64;
+        size -= 64;
+    }
+
+    /* Fold the four lanes into one */
+    x0 = _mm_load_si128((const __m128i *)k3k4);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    /* Then the remaining 16 byte blocks */
+    while (size >= 16) {
+        x2 = _mm_loadu_si128((const __m128i *)buf);
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        buf += 16;
+        size -= 16;
+    }
+
+    /* 128 bits down to 64 */
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+    x0 = _mm_loadl_epi64((const __m128i *)k5k0);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /* Barrett reduction to 32 bits */
+    x0 = _mm_load_si128((const __m128i *)poly);
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+static uint32_t crc32_zlib_pclmul(uint32_t crc, const unsigned char *buf, size_t size)
+{
+    if (size >= 64) {
+        size_t folded = size & ~(size_t)15;
+
+        crc = crc32_fold_pclmul(crc, buf, folded);
+        buf += folded;
+        size -= folded;
+    }
+    return crc32_slice8(&crc32_zlib_tables, crc, buf, size);
+}
+
+/* CRC32C has an instruction of its own in SSE4.2 */
+__attribute__((target("sse4.2"))) static uint32_t crc32c_sse42(
+    uint32_t crc, const unsigned char *buf, size_t size)
+{
+    uint64_t crc64 = crc;
+
+    while (size > 0 && ((uintptr_t)buf & 7) != 0) {
+        crc64 = _mm_crc32_u8((uint32_t)crc64, *buf++);
+        size--;
+    }
+    while (size >= 8) {
+        uint64_t word;
+
+        memcpy(&word, buf, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        buf += 8;
+        size -= 8;
+    }
+    while (size--) {
+        crc64 = _mm_crc32_u8((uint32_t)crc64, *buf++);
+    }
+    return (uint32_t)crc64;
+}
+#endif
+
+static void crc32_init(void)
+{
+    int v;
+
+    for (v = 0; v < 256; v++) {
+        crc32_zlib_tables.byte[v] = (uint32_t)crc32_tab[v];
+        crc32_legacy_tables.byte[v] = (uint32_t)crc32_tab[v];
+    }
+    crc32_fill_byte_table(&crc32c_tables, 0x82f63b78U);
+
+    crc32_fill_tables(&crc32_zlib_tables, 0);
+    crc32_fill_tables(&crc32_legacy_tables, 1);
+    crc32_fill_tables(&crc32c_tables, 0);
+
+    crc32_zlib_impl = crc32_zlib_slice8;
+    crc32c_impl = crc32c_slice8;
+#ifdef CRC32_HAVE_PCLMUL
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+        crc32_zlib_impl = crc32_zlib_pclmul;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc32c_impl = crc32c_sse42;
+    }
+#endif
+}
+
+/*
+ * Same result as zlib's crc32(), picking the fastest implementation the
+ * CPU supports
+ */
+int liberasurecode_crc32(int crc, const void *buf, size_t size)
+{
+    pthread_once(&crc32_init_once, crc32_init);
+
+    return crc32_zlib_impl((uint32_t)crc ^ ~0U, buf, size) ^ ~0U;
+}
+
 int liberasurecode_crc32_alt(int crc, const void *buf, size_t size)
 {
-    const char *p;
+    pthread_once(&crc32_init_once, crc32_init);
+
+    return crc32_slice8(&crc32_legacy_tables, (uint32_t)crc ^ ~0U, buf, size) ^ ~0U;
+}
+
+/* x^-1 modulo the CRC-32 polynomial, in zlib's reflected bit order */
+#define CRC32_X_INVERSE 0xdb710641U
+
+/* a * b modulo the CRC-32 polynomial, reflected like the CRC register */
+static uint32_t crc32_multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m = 1U << 31;
+    uint32_t p = 0;
 
-    p = buf;
-    crc = crc ^ ~0U;
+    for (; m != 0 && a != 0; m >>= 1) {
+        if (a & m) {
+            p ^= b;
+            a ^= m;
+        }
+        b = b & 1 ? (b >> 1) ^ 0xedb88320U : b >> 1;
+    }
 
-    while (size--)
-        crc = crc32_tab[(crc ^ *p++) & 0xFF]
-            ^ ((((crc >> 8) & 0x00FFFFFF) ^ 0x00800000) - 0x00800000);
+    return p;
+}
+
+/*
+ * zlib CRC-32 of a message once its last len bytes, all zeros, are cut
+ * off.  Each zero byte fed to the register multiplies it by x^8, so
+ * undo them by multiplying by x^-8len.
+ */
+__attribute__((visibility("internal"))) uint32_t crc32_trim_zeros(uint32_t crc, uint64_t len)
+{
+    uint32_t factor = 1U << 31; /* x^0 */
+    uint32_t power = CRC32_X_INVERSE;
+    uint64_t bits = len * 8;
+
+    for (; bits != 0; bits >>= 1) {
+        if (bits & 1) {
+            factor = crc32_multmodp(power, factor);
+        }
+        power = crc32_multmodp(power, power);
+    }
+
+    return crc32_multmodp(factor, crc ^ ~0U) ^ ~0U;
+}
+
+/*
+ * CRC32C (Castagnoli), as computed by the SSE4.2 crc32 instruction and
+ * iSCSI; that instruction is used when the CPU has it
+ */
+uint32_t liberasurecode_crc32c(uint32_t crc, const void *buf, size_t size)
+{
+    pthread_once(&crc32_init_once, crc32_init);
 
-    return crc ^ ~0U;
+    return crc32c_impl(crc ^ ~0U, buf, size) ^ ~0U;
 }
@@ -35,8 +35,8 @@
  * compile-time configuration.
  */
 
-#ifndef HAVE_OPENSSL
-
+#include <pthread.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "md5.h"
@@ -61,6 +61,85 @@
     (a) = (((a) << (s)) | (((a) & 0xffffffff) >> (32 - (s))));                                     \
     (a) += (b);
 
+/*
+ * The 64 steps of one block over a, b, c, d; X(n) fetches word n of the
+ * block the first time it is used and Y(n) after that.
+ */
+#define MD5_ROUNDS(a, b, c, d, X, Y)                                                               \
+    /* Round 1 */                                                                                  \
+    STEP(F, a, b, c, d, X(0), 0xd76aa478, 7)                                                       \
+    STEP(F, d, a, b, c, X(1), 0xe8c7b756, 12)                                                      \
+    STEP(F, c, d, a, b, X(2), 0x242070db, 17)                                                      \
+    STEP(F, b, c, d, a, X(3), 0xc1bdceee, 22)                                                      \
+    STEP(F, a, b, c, d, X(4), 0xf57c0faf, 7)                                                       \
+    STEP(F, d, a, b, c, X(5), 0x4787c62a, 12)                                                      \
+    STEP(F, c, d, a, b, X(6), 0xa8304613, 17)                                                      \
+    STEP(F, b, c, d, a, X(7), 0xfd469501, 22)                                                      \
+    STEP(F, a, b, c, d, X(8), 0x698098d8, 7)                                                       \
+    STEP(F, d, a, b, c, X(9), 0x8b44f7af, 12)                                                      \
+    STEP(F, c, d, a, b, X(10), 0xffff5bb1, 17)                                                     \
+    STEP(F, b, c, d, a, X(11), 0x895cd7be, 22)                                                     \
+    STEP(F, a, b, c, d, X(12), 0x6b901122, 7)                                                      \
+    STEP(F, d, a, b, c, X(13), 0xfd987193, 12)                                                     \
+    STEP(F, c, d, a, b, X(14), 0xa679438e, 17)                                                     \
+    STEP(F, b, c, d, a, X(15), 0x49b40821, 22)                                                     \
+                                                                                                   \
+    /* Round 2 */                                                                                  \
+    STEP(G, a, b, c, d, Y(1), 0xf61e2562, 5)                                                       \
+    STEP(G, d, a, b, c, Y(6), 0xc040b340, 9)                                                       \
+    STEP(G, c, d, a, b, Y(11), 0x265e5a51, 14)                                                     \
+    STEP(G, b, c, d, a, Y(0), 0xe9b6c7aa, 20)                                                      \
+    STEP(G, a, b, c, d, Y(5), 0xd62f105d, 5)                                                       \
+    STEP(G, d, a, b, c, Y(10), 0x02441453, 9)                                                      \
+    STEP(G, c, d, a, b, Y(15), 0xd8a1e681, 14)                                                     \
+    STEP(G, b, c, d, a, Y(4), 0xe7d3fbc8, 20)                                                      \
+    STEP(G, a, b, c, d, Y(9), 0x21e1cde6, 5)                                                       \
+    STEP(G, d, a, b, c, Y(14), 0xc33707d6, 9)                                                      \
+    STEP(G, c, d, a, b, Y(3), 0xf4d50d87, 14)                                                      \
+    STEP(G, b, c, d, a, Y(8), 0x455a14ed, 20)                                                      \
+    STEP(G, a, b, c, d, Y(13), 0xa9e3e905, 5)                                                      \
+    STEP(G, d, a, b, c, Y(2), 0xfcefa3f8, 9)                                                       \
+    STEP(G, c, d, a, b, Y(7), 0x676f02d9, 14)                                                      \
+    STEP(G, b, c, d, a, Y(12), 0x8d2a4c8a, 20)                                                     \
+                                                                                                   \
+    /* Round 3 */                                                                                  \
+    STEP(H, a, b, c, d, Y(5), 0xfffa3942, 4)                                                       \
+    STEP(H, d, a, b, c, Y(8), 0x8771f681, 11)                                                      \
+    STEP(H, c, d, a, b, Y(11), 0x6d9d6122, 16)                                                     \
+    STEP(H, b, c, d, a, Y(14), 0xfde5380c, 23)                                                     \
+    STEP(H, a, b, c, d, Y(1), 0xa4beea44, 4)                                                       \
+    STEP(H, d, a, b, c, Y(4), 0x4bdecfa9, 11)                                                      \
+    STEP(H, c, d, a, b, Y(7), 0xf6bb4b60, 16)                                                      \
+    STEP(H, b, c, d, a, Y(10), 0xbebfbc70, 23)                                                     \
+    STEP(H, a, b, c, d, Y(13), 0x289b7ec6, 4)                                                      \
+    STEP(H, d, a, b, c, Y(0), 0xeaa127fa, 11)                                                      \
+    STEP(H, c, d, a, b, Y(3), 0xd4ef3085, 16)                                                      \
+    STEP(H, b, c, d, a, Y(6), 0x04881d05, 23)                                                      \
+    STEP(H, a, b, c, d, Y(9), 0xd9d4d039, 4)                                                       \
+    STEP(H, d, a, b, c, Y(12), 0xe6db99e5, 11)                                                     \
+    STEP(H, c, d, a, b, Y(15), 0x1fa27cf8, 16)                                                     \
+    STEP(H, b, c, d, a, Y(2), 0xc4ac5665, 23)                                                      \
+                                                                                                   \
+    /* Round 4 */                                                                                  \
+    STEP(I, a, b, c, d, Y(0), 0xf4292244, 6)                                                       \
+    STEP(I, d, a, b, c, Y(7), 0x432aff97, 10)                                                      \
+    STEP(I, c, d, a, b, Y(14), 0xab9423a7, 15)                                                     \
+    STEP(I, b, c, d, a, Y(5), 0xfc93a039, 21)                                                      \
+    STEP(I, a, b, c, d, Y(12), 0x655b59c3, 6)                                                      \
+    STEP(I, d, a, b, c, Y(3), 0x8f0ccc92, 10)                                                      \
+    STEP(I, c, d, a, b, Y(10), 0xffeff47d, 15)                                                     \
+    STEP(I, b, c, d, a, Y(1), 0x85845dd1, 21)                                                      \
+    STEP(I, a, b, c, d, Y(8), 0x6fa87e4f, 6)                                                       \
+    STEP(I, d, a, b, c, Y(15), 0xfe2ce6e0, 10)                                                     \
+    STEP(I, c, d, a, b, Y(6), 0xa3014314, 15)                                                      \
+    STEP(I, b, c, d, a, Y(13), 0x4e0811a1, 21)                                                     \
+    STEP(I, a, b, c, d, Y(4), 0xf7537e82, 6)                                                       \
+    STEP(I, d, a, b, c, Y(11), 0xbd3af235, 10)                                                     \
+    STEP(I, c, d, a, b, Y(2), 0x2ad7d2bb, 15)                                                      \
+    STEP(I, b, c, d, a, Y(9), 0xeb86d391, 21)
+
+#ifndef HAVE_OPENSSL
+
 /*
  * SET reads 4 input bytes in little-endian byte order and stores them
  * in a properly aligned word in host byte order.
@@ -102,77 +181,7 @@ static void *body(MD5_CTX *ctx, void *data, unsigned long size)
         saved_c = c;
         saved_d = d;
 
-        /* Round 1 */
-        STEP(F, a, b, c, d, SET(0), 0xd76aa478, 7)
-        STEP(F, d, a, b, c, SET(1), 0xe8c7b756, 12)
-        STEP(F, c, d, a, b, SET(2), 0x242070db, 17)
-        STEP(F, b, c, d, a, SET(3), 0xc1bdceee, 22)
-        STEP(F, a, b, c, d, SET(4), 0xf57c0faf, 7)
-        STEP(F, d, a, b, c, SET(5), 0x4787c62a, 12)
-        STEP(F, c, d, a, b, SET(6), 0xa8304613, 17)
-        STEP(F, b, c, d, a, SET(7), 0xfd469501, 22)
-        STEP(F, a, b, c, d, SET(8), 0x698098d8, 7)
-        STEP(F, d, a, b, c, SET(9), 0x8b44f7af, 12)
-        STEP(F, c, d, a, b, SET(10), 0xffff5bb1, 17)
-        STEP(F, b, c, d, a, SET(11), 0x895cd7be, 22)
-        STEP(F, a, b, c, d, SET(12), 0x6b901122, 7)
-        STEP(F, d, a, b, c, SET(13), 0xfd987193, 12)
-        STEP(F, c, d, a, b, SET(14), 0xa679438e, 17)
-        STEP(F, b, c, d, a, SET(15), 0x49b40821, 22)
-
-        /* Round 2 */
-        STEP(G, a, b, c, d, GET(1), 0xf61e2562, 5)
-        STEP(G, d, a, b, c, GET(6), 0xc040b340, 9)
-        STEP(G, c, d, a, b, GET(11), 0x265e5a51, 14)
-        STEP(G, b, c, d, a, GET(0), 0xe9b6c7aa, 20)
-        STEP(G, a, b, c, d, GET(5), 0xd62f105d, 5)
-        STEP(G, d, a, b, c, GET(10), 0x02441453, 9)
-        STEP(G, c, d, a, b, GET(15), 0xd8a1e681, 14)
-        STEP(G, b, c, d, a, GET(4), 0xe7d3fbc8, 20)
-        STEP(G, a, b, c, d, GET(9), 0x21e1cde6, 5)
-        STEP(G, d, a, b, c, GET(14), 0xc33707d6, 9)
-        STEP(G, c, d, a, b, GET(3), 0xf4d50d87, 14)
-        STEP(G, b, c, d, a, GET(8), 0x455a14ed, 20)
-        STEP(G, a, b, c, d, GET(13), 0xa9e3e905, 5)
-        STEP(G, d, a, b, c, GET(2), 0xfcefa3f8, 9)
-        STEP(G, c, d, a, b, GET(7), 0x676f02d9, 14)
-        STEP(G, b, c, d, a, GET(12), 0x8d2a4c8a, 20)
-
-        /* Round 3 */
-        STEP(H, a, b, c, d, GET(5), 0xfffa3942, 4)
-        STEP(H, d, a, b, c, GET(8), 0x8771f681, 11)
-        STEP(H, c, d, a, b, GET(11), 0x6d9d6122, 16)
-        STEP(H, b, c, d, a, GET(14), 0xfde5380c, 23)
-        STEP(H, a, b, c, d, GET(1), 0xa4beea44, 4)
-        STEP(H, d, a, b, c, GET(4), 0x4bdecfa9, 11)
-        STEP(H, c, d, a, b, GET(7), 0xf6bb4b60, 16)
-        STEP(H, b, c, d, a, GET(10), 0xbebfbc70, 23)
-        STEP(H, a, b, c, d, GET(13), 0x289b7ec6, 4)
-        STEP(H, d, a, b, c, GET(0), 0xeaa127fa, 11)
-        STEP(H, c, d, a, b, GET(3), 0xd4ef3085, 16)
-        STEP(H, b, c, d, a, GET(6), 0x04881d05, 23)
-        STEP(H, a, b, c, d, GET(9), 0xd9d4d039, 4)
-        STEP(H, d, a, b, c, GET(12), 0xe6db99e5, 11)
-        STEP(H, c, d, a, b, GET(15), 0x1fa27cf8, 16)
-        STEP(H, b, c, d, a, GET(2), 0xc4ac5665, 23)
-
-        /* Round 4 */
-        STEP(I, a, b, c, d, GET(0), 0xf4292244, 6)
-        STEP(I, d, a, b, c, GET(7), 0x432aff97, 10)
-        STEP(I, c, d, a, b, GET(14), 0xab9423a7, 15)
-        STEP(I, b, c, d, a, GET(5), 0xfc93a039, 21)
-        STEP(I, a, b, c, d, GET(12), 0x655b59c3, 6)
-        STEP(I, d, a, b, c, GET(3), 0x8f0ccc92, 10)
-        STEP(I, c, d, a, b, GET(10), 0xffeff47d, 15)
-        STEP(I, b, c, d, a, GET(1), 0x85845dd1, 21)
-        STEP(I, a, b, c, d, GET(8), 0x6fa87e4f, 6)
-        STEP(I, d, a, b, c, GET(15), 0xfe2ce6e0, 10)
-        STEP(I, c, d, a, b, GET(6), 0xa3014314, 15)
-        STEP(I, b, c, d, a, GET(13), 0x4e0811a1, 21)
-        STEP(I, a, b, c, d, GET(4), 0xf7537e82, 6)
-        STEP(I, d, a, b, c, GET(11), 0xbd3af235, 10)
-        STEP(I, c, d, a, b, GET(2), 0x2ad7d2bb, 15)
-        STEP(I, b, c, d, a, GET(9), 0xeb86d391, 21)
+        MD5_ROUNDS(a, b, c, d, SET, GET)
 
         a += saved_a;
         b += saved_b;
@@ -190,7 +199,7 @@ static void *body(MD5_CTX *ctx, void *data, unsigned long size)
     return ptr;
 }
 
-void MD5_Init(MD5_CTX *ctx)
+__attribute__((visibility("internal"))) void MD5_Init(MD5_CTX *ctx)
 {
     ctx->a = 0x67452301;
     ctx->b = 0xefcdab89;
@@ -201,7 +210,8 @@ void MD5_Init(MD5_CTX *ctx)
     ctx->hi = 0;
 }
 
-void MD5_Update(MD5_CTX *ctx, void *data, unsigned long size)
+__attribute__((visibility("internal"))) void MD5_Update(
+    MD5_CTX *ctx, void *data, unsigned long size)
 {
     MD5_u32plus saved_lo;
     unsigned long used, free;
@@ -235,7 +245,7 @@ void MD5_Update(MD5_CTX *ctx, void *data, unsigned long size)
     memcpy(ctx->buffer, data, size);
 }
 
-void MD5_Final(unsigned char *result, MD5_CTX *ctx)
+__attribute__((visibility("internal"))) void MD5_Final(unsigned char *result, MD5_CTX *ctx)
 {
     unsigned long used, free;
 
@@ -287,3 +297,173 @@ void MD5_Final(unsigned char *result, MD5_CTX *ctx)
 }
 
 #endif
+
+/* ==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~==~=*=~== */
+
+/*
+ * Multi-buffer MD5: the buffers of a stripe all have the same length, so
+ * one vector lane per buffer runs the very same steps.  The lane kernels
+ * are built from GCC vector types, which the compiler maps onto SSE2,
+ * AVX2 or AVX-512 registers (or NEON, or plain integers elsewhere).
+ */
+#define MD5_MB_MAX_LANES 16
+
+typedef uint32_t md5_x4 __attribute__((vector_size(16)));
+typedef uint32_t md5_x8 __attribute__((vector_size(32)));
+typedef uint32_t md5_x16 __attribute__((vector_size(64)));
+
+typedef void (*md5_mb_blocks_fn)(
+    uint32_t state[4][MD5_MB_MAX_LANES], const unsigned char *const *ptrs, size_t blocks);
+
+static inline uint32_t md5_load_le32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/*
+ * Define NAME, which runs 'blocks' 64-byte blocks starting at ptrs[lane]
+ * through lanes copies of MD5 at once, lane i of state holding the
+ * registers of buffer i
+ */
+#define MD5_MB_BLOCKS(NAME, VTYPE, LANES, ATTR)                                                    \
+    ATTR static void NAME(                                                                         \
+        uint32_t state[4][MD5_MB_MAX_LANES], const unsigned char *const *ptrs, size_t blocks)      \
+    {                                                                                              \
+        uint32_t words[16][LANES];                                                                 \
+        VTYPE a, b, c, d, saved_a, saved_b, saved_c, saved_d, x[16];                               \
+        size_t off;                                                                                \
+        int i, w;                                                                                  \
+                                                                                                   \
+        memcpy(&a, state[0], sizeof(a));                                                           \
+        memcpy(&b, state[1], sizeof(b));                                                           \
+        memcpy(&c, state[2], sizeof(c));                                                           \
+        memcpy(&d, state[3], sizeof(d));                                                           \
+        for (off = 0; off < blocks * 64; off += 64) {                                              \
+            for (w = 0; w < 16; w++) {                                                             \
+                for (i = 0; i < LANES; i++) {                                                      \
+                    words[w][i] = md5_load_le32(ptrs[i] + off + w * 4);                            \
+                }                                                                                  \
+                memcpy(&x[w], words[w], sizeof(x[w]));                                             \
+            }                                                                                      \
+            saved_a = a;                                                                           \
+            saved_b = b;                                                                           \
+            saved_c = c;                                                                           \
+            saved_d = d;                                                                           \
+            MD5_ROUNDS(a, b, c, d, MD5_MB_WORD, MD5_MB_WORD)                                       \
+            a += saved_a;                                                                          \
+            b += saved_b;                                                                          \
+            c += saved_c;                                                                          \
+            d += saved_d;                                                                          \
+        }                                                                                          \
+        memcpy(state[0], &a, sizeof(a));                                                           \
+        memcpy(state[1], &b, sizeof(b));                                                           \
+        memcpy(state[2], &c, sizeof(c));                                                           \
+        memcpy(state[3], &d, sizeof(d));                                                           \
+    }
+
+#define MD5_MB_WORD(n) x[(n)]
+
+MD5_MB_BLOCKS(md5_mb_blocks_x4, md5_x4, 4, )
+#if defined(__x86_64__) && defined(__GNUC__)
+#define MD5_MB_HAVE_WIDE 1
+MD5_MB_BLOCKS(md5_mb_blocks_x8, md5_x8, 8, __attribute__((target("avx2"))))
+MD5_MB_BLOCKS(md5_mb_blocks_x16, md5_x16, 16, __attribute__((target("avx512f"))))
+#endif
+
+/* Kernels the CPU supports, narrowest first */
+static struct {
+    md5_mb_blocks_fn blocks;
+    int lanes;
+} md5_mb_kernels[3] = { { md5_mb_blocks_x4, 4 } };
+static int md5_mb_num_kernels = 1;
+static pthread_once_t md5_mb_init_once = PTHREAD_ONCE_INIT;
+
+static void md5_mb_init(void)
+{
+#ifdef MD5_MB_HAVE_WIDE
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        md5_mb_kernels[md5_mb_num_kernels].blocks = md5_mb_blocks_x8;
+        md5_mb_kernels[md5_mb_num_kernels].lanes = 8;
+        md5_mb_num_kernels++;
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        md5_mb_kernels[md5_mb_num_kernels].blocks = md5_mb_blocks_x16;
+        md5_mb_kernels[md5_mb_num_kernels].lanes = 16;
+        md5_mb_num_kernels++;
+    }
+#endif
+}
+
+/* MD5 digest of one buffer */
+void liberasurecode_md5(const void *buf, size_t size, unsigned char *digest)
+{
+    MD5_CTX ctx;
+
+    MD5_Init(&ctx);
+    MD5_Update(&ctx, (void *)buf, size);
+    MD5_Final(digest, &ctx);
+}
+
+/*
+ * MD5 digests of the n buffers in bufs, each len bytes long, into
+ * digests.  The buffers are hashed as many at a time as the CPU has
+ * vector lanes for, using the narrowest kernel that still covers the
+ * buffers left so few lanes go to waste; a lone buffer goes through the
+ * scalar MD5.
+ */
+__attribute__((visibility("internal"))) void md5_multi(
+    const unsigned char *const *bufs, int n, size_t len, unsigned char (*digests)[16])
+{
+    unsigned char tail[MD5_MB_MAX_LANES][128];
+    const unsigned char *ptrs[MD5_MB_MAX_LANES];
+    uint32_t state[4][MD5_MB_MAX_LANES];
+    size_t rest = len % 64;
+    size_t tail_blocks = rest < 56 ? 1 : 2;
+    uint64_t bits = (uint64_t)len << 3;
+    md5_mb_blocks_fn blocks;
+    int lanes, first, i, j;
+
+    pthread_once(&md5_mb_init_once, md5_mb_init);
+
+    for (first = 0; first < n; first += lanes) {
+        if (n - first == 1) {
+            liberasurecode_md5(bufs[first], len, digests[first]);
+            return;
+        }
+        i = 0;
+        while (i < md5_mb_num_kernels - 1 && md5_mb_kernels[i].lanes < n - first) {
+            i++;
+        }
+        blocks = md5_mb_kernels[i].blocks;
+        lanes = md5_mb_kernels[i].lanes;
+
+        /* Spare lanes of the last group just hash the first buffer again */
+        for (i = 0; i < lanes; i++) {
+            ptrs[i] = bufs[first + i < n ? first + i : first];
+            state[0][i] = 0x67452301;
+            state[1][i] = 0xefcdab89;
+            state[2][i] = 0x98badcfe;
+            state[3][i] = 0x10325476;
+        }
+        blocks(state, ptrs, len / 64);
+
+        /* The padded tail has the same shape in every lane */
+        for (i = 0; i < lanes; i++) {
+            memcpy(tail[i], ptrs[i] + len - rest, rest);
+            tail[i][rest] = 0x80;
+            memset(tail[i] + rest + 1, 0, tail_blocks * 64 - rest - 1);
+            for (j = 0; j < 8; j++) {
+                tail[i][tail_blocks * 64 - 8 + j] = (unsigned char)(bits >> (8 * j));
+            }
+            ptrs[i] = tail[i];
+        }
+        blocks(state, ptrs, tail_blocks);
+
+        for (i = 0; i < lanes && first + i < n; i++) {
+            for (j = 0; j < 16; j++) {
+                digests[first + i][j] = (unsigned char)(state[j / 4][i] >> (8 * (j % 4)));
+            }
+        }
+    }
+}
@@ -557,9 +557,20 @@ static void validate_fragment_checksum(struct ec_args *args,
     uint32_t size = metadata->size;
     char *flag;
     switch (args->ct) {
-        case CHKSUM_MD5:
-            assert(false); //currently only have support crc32
+        case CHKSUM_MD5: {
+            unsigned char digest[16];
+            uint32_t words[4];
+            int i;
+            liberasurecode_md5(fragment_data, size, digest);
+            for (i = 0; i < 4; i++) {
+                words[i] = digest[i * 4] | digest[i * 4 + 1] << 8 |
+                           digest[i * 4 + 2] << 16 | (uint32_t) digest[i * 4 + 3] << 24;
+            }
+            computed = words[0];
+            if (!metadata->chksum_mismatch)
+                assert(memcmp(metadata->chksum, words, sizeof(words)) == 0);
             break;
+        }
         case CHKSUM_CRC32:
             flag = getenv("LIBERASURECODE_WRITE_LEGACY_CRC");
             if (flag && !(flag[0] == '\0' || (flag[0] == '0' && flag[1] == '\0'))) {
@@ -568,6 +579,15 @@ static void validate_fragment_checksum(struct ec_args *args,
                 computed = crc32(0, (unsigned char *) fragment_data, size);
             }
             break;
+        case CHKSUM_CRC32C:
+            computed = liberasurecode_crc32c(0, fragment_data, size);
+            break;
+        case CHKSUM_XXH64:
+            computed = (uint32_t) liberasurecode_xxh64(0, fragment_data, size);
+            if (!metadata->chksum_mismatch)
+                assert(metadata->chksum[1] ==
+                       (uint32_t) (liberasurecode_xxh64(0, fragment_data, size) >> 32));
+            break;
         case CHKSUM_NONE:
             assert(metadata->chksum_mismatch == 0);
             break;
@@ -1535,6 +1555,119 @@ static void test_get_fragment_metadata(const ec_backend_id_t be_id, struct ec_ar
     free(orig_data);
 }
 
+static void test_fragment_checksum_mismatch(const ec_backend_id_t be_id,
+                                            struct ec_args *args)
+{
+    int i;
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 16 * 1024 + 3;
+    int num_fragments = args->k + args->m;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    fragment_metadata_t metadata;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'y');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+
+    for (i = 0; i < num_fragments; i++) {
+        char *frag = (i < args->k) ? encoded_data[i] : encoded_parity[i - args->k];
+        assert(is_invalid_fragment(desc, frag) == 0);
+
+        // a single flipped payload bit must be caught
+        get_data_ptr_from_fragment(frag)[i * 7 % (encoded_fragment_len -
+                                     sizeof(fragment_header_t))] ^= 0x10;
+        rc = liberasurecode_get_fragment_metadata(frag, &metadata);
+        assert(rc == 0);
+        assert(metadata.chksum_type == args->ct);
+        assert(metadata.chksum_mismatch == 1);
+        assert(is_invalid_fragment(desc, frag) != 0);
+    }
+
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+static void test_md5_fragment_without_digest(const ec_backend_id_t be_id,
+                                             struct ec_args *args)
+{
+    int i;
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 16 * 1024 + 3;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    fragment_header_t *hdr = NULL;
+    fragment_metadata_t metadata;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'y');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+
+    // releases before 1.9.0 wrote CHKSUM_MD5 fragments with zeroed words
+    hdr = (fragment_header_t *) encoded_data[0];
+    for (i = 0; i < LIBERASURECODE_MAX_CHECKSUM_LEN; i++) {
+        hdr->meta.chksum[i] = 0;
+    }
+    hdr->libec_version = _VERSION(1, 8, 0);
+    hdr->metadata_chksum = crc32(0, (unsigned char *) &hdr->meta,
+                                 sizeof(fragment_metadata_t));
+    rc = liberasurecode_get_fragment_metadata(encoded_data[0], &metadata);
+    assert(rc == 0);
+    assert(metadata.chksum_type == CHKSUM_MD5);
+    assert(metadata.chksum_mismatch == 0);
+    assert(is_invalid_fragment(desc, encoded_data[0]) == 0);
+
+    // the same fragment from this release must carry a digest
+    hdr->libec_version = LIBERASURECODE_VERSION;
+    assert(is_invalid_fragment(desc, encoded_data[0]) != 0);
+
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+static void test_checksum_known_values(void)
+{
+    const char *check = "123456789";
+    const char *text = "Nobody inspects the spammish repetition";
+    unsigned char digest[16];
+
+    assert(liberasurecode_crc32c(0, check, strlen(check)) == 0xe3069283);
+    assert(liberasurecode_crc32c(0, "", 0) == 0);
+    assert(liberasurecode_xxh64(0, "", 0) == 0xef46db3751d8e999ULL);
+    assert(liberasurecode_xxh64(0, "abc", 3) == 0x44bc2cf5ad770999ULL);
+    assert(liberasurecode_xxh64(0, text, strlen(text)) == 0xfbcea83c8a378bf1ULL);
+    liberasurecode_md5("abc", 3, digest);
+    assert(memcmp(digest, "\x90\x01\x50\x98\x3c\xd2\x4f\xb0"
+                          "\xd6\x96\x3f\x7d\x28\xe1\x7f\x72", 16) == 0);
+    // chainable, like zlib's crc32()
+    assert(liberasurecode_crc32c(liberasurecode_crc32c(0, check, 4), check + 4, 5) ==
+           0xe3069283);
+}
+
 static void test_write_legacy_fragment_metadata(const ec_backend_id_t be_id, struct ec_args *args)
 {
     // any value except 0 will write legacy crc
@@ -1986,115 +2119,1898 @@ static void test_simple_encode_decode(const ec_backend_id_t be_id,
     free(skip);
 }
 
-static void test_jerasure_rs_vand_simple_encode_decode_over_max_frags(void)
+static void test_encode_into(const ec_backend_id_t be_id,
+                             struct ec_args *args)
 {
-    struct ec_args over_args = {
-        .k = 300,
-        .m = 20,
-    };
+    int i = 0;
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024 * 1024 + 3;
+    int num_fragments = args->k + args->m;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    uint64_t fragment_len = 0;
+    char **fragments = NULL;
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
 
-    int *skip = create_skips_array(&over_args, 1);
-    assert(skip != NULL);
-    // should return an error
-    encode_decode_test_impl(EC_BACKEND_JERASURE_RS_VAND,
-                            &over_args, skip);
-    free(skip);
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+
+    rc = liberasurecode_get_encoded_fragment_len(desc, orig_data_size, &fragment_len);
+    assert(rc == 0);
+    assert(fragment_len == encoded_fragment_len);
+
+    fragments = malloc(num_fragments * sizeof(char *));
+    assert(fragments != NULL);
+    for (i = 0; i < num_fragments; i++) {
+        rc = posix_memalign((void **)&fragments[i],
+                LIBERASURECODE_FRAGMENT_ALIGNMENT, fragment_len);
+        assert(rc == 0);
+        /* encode_into must not rely on zeroed buffers */
+        memset(fragments[i], 0xa5, fragment_len);
+    }
+
+    rc = liberasurecode_encode_into(desc, orig_data, orig_data_size,
+            fragments, fragment_len - 1);
+    assert(rc == -EINVALIDPARAMS);
+    rc = liberasurecode_encode_into(desc, orig_data, orig_data_size,
+            fragments, fragment_len);
+    assert(rc == 0);
+
+    // shss & libphazr fragments are not deterministic
+    if (be_id != EC_BACKEND_SHSS && be_id != EC_BACKEND_LIBPHAZR) {
+        for (i = 0; i < num_fragments; i++) {
+            char *cmp = (i < args->k) ? encoded_data[i] : encoded_parity[i - args->k];
+            assert(memcmp(fragments[i], cmp, fragment_len) == 0);
+        }
+    }
+
+    rc = liberasurecode_decode(desc, fragments, num_fragments, fragment_len, 1,
+                               &decoded_data, &decoded_data_len);
+    assert(rc == 0);
+    assert(decoded_data_len == orig_data_size);
+    assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+    liberasurecode_decode_cleanup(desc, decoded_data);
+
+    for (i = 0; i < num_fragments; i++) {
+        free(fragments[i]);
+    }
+    free(fragments);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
 }
 
-static void test_simple_reconstruct(const ec_backend_id_t be_id,
-                                    struct ec_args *args)
+static void test_encode_into_invalid_args(void)
 {
-    if (args->k + args->m > 100) {
-        fprintf(stderr, "Too many total frags; skipping\n");
+    int i = 0;
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024;
+    int num_fragments = null_args.k + null_args.m;
+    char *orig_data = create_buffer(orig_data_size, 'x');
+    uint64_t fragment_len = 0;
+    char **fragments = NULL;
+    char *unaligned = NULL;
+
+    assert(orig_data != NULL);
+    rc = liberasurecode_get_encoded_fragment_len(desc, orig_data_size, &fragment_len);
+    assert(rc < 0);
+
+    desc = liberasurecode_instance_create(EC_BACKEND_NULL, &null_args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
         return;
     }
-    int i = 0;
-    for (i = 0; i < args->k + args->m; i++) {
-        int *skip = create_skips_array(args,i);
-        assert(skip != NULL);
-        reconstruct_test_impl(be_id, args, skip);
-        free(skip);
+    assert(desc > 0);
+
+    rc = liberasurecode_get_encoded_fragment_len(desc, orig_data_size, NULL);
+    assert(rc < 0);
+    rc = liberasurecode_get_encoded_fragment_len(desc, orig_data_size, &fragment_len);
+    assert(rc == 0);
+
+    fragments = calloc(num_fragments, sizeof(char *));
+    assert(fragments != NULL);
+
+    rc = liberasurecode_encode_into(desc, orig_data, orig_data_size,
+            fragments, fragment_len);
+    assert(rc == -EINVALIDPARAMS);
+
+    for (i = 0; i < num_fragments; i++) {
+        rc = posix_memalign((void **)&fragments[i],
+                LIBERASURECODE_FRAGMENT_ALIGNMENT, fragment_len + 1);
+        assert(rc == 0);
     }
-}
 
-static void test_fragments_needed(const ec_backend_id_t be_id,
-                                  struct ec_args *args)
-{
-    test_fragments_needed_impl(be_id, args);
+    rc = liberasurecode_encode_into(-1, orig_data, orig_data_size,
+            fragments, fragment_len);
+    assert(rc < 0);
+    rc = liberasurecode_encode_into(desc, NULL, orig_data_size,
+            fragments, fragment_len);
+    assert(rc < 0);
+    rc = liberasurecode_encode_into(desc, orig_data, orig_data_size,
+            NULL, fragment_len);
+    assert(rc < 0);
+
+    unaligned = fragments[0];
+    fragments[0] = unaligned + 1;
+    rc = liberasurecode_encode_into(desc, orig_data, orig_data_size,
+            fragments, fragment_len);
+    assert(rc == -EINVALIDPARAMS);
+    fragments[0] = unaligned;
+
+    rc = liberasurecode_encode_into(desc, orig_data, orig_data_size,
+            fragments, fragment_len);
+    assert(rc == 0);
+
+    for (i = 0; i < num_fragments; i++) {
+        free(fragments[i]);
+    }
+    free(fragments);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
 }
 
-static void test_verify_stripe_metadata(const ec_backend_id_t be_id,
-                                        struct ec_args *args)
+static void test_encode_slab(const ec_backend_id_t be_id,
+                             struct ec_args *args)
 {
-    int orig_data_size = 1024;
+    int i = 0;
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 4096 + 7;
+    int num_fragments = args->k + args->m;
+    char *orig_data = NULL;
     char **encoded_data = NULL, **encoded_parity = NULL;
-    char **avail_frags = NULL;
+    char **slab_data = NULL, **slab_parity = NULL;
     uint64_t encoded_fragment_len = 0;
-    int rc = -1;
-    int num_avail_frags = -1;
-    int *skip = create_skips_array(args,-1);
-    char *orig_data = create_buffer(orig_data_size, 'x');
-    int desc = liberasurecode_instance_create(be_id, args);
+    uint64_t slab_fragment_len = 0;
+    char **avail_frags = NULL;
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
 
+    desc = liberasurecode_instance_create(be_id, args);
     if (-EBACKENDNOTAVAIL == desc) {
         fprintf(stderr, "Backend library not available!\n");
-        free(orig_data);
-        free(skip);
         return;
     }
     assert(desc > 0);
 
+    orig_data = create_buffer(orig_data_size, 'x');
     assert(orig_data != NULL);
     rc = liberasurecode_encode(desc, orig_data, orig_data_size,
             &encoded_data, &encoded_parity, &encoded_fragment_len);
-    assert(0 == rc);
+    assert(rc == 0);
 
-    num_avail_frags = create_frags_array(&avail_frags, encoded_data,
-            encoded_parity, args, skip);
+    rc = liberasurecode_instance_set_option(desc, EC_OPT_SLAB_ALLOC, 1);
+    assert(rc == 0);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &slab_data, &slab_parity, &slab_fragment_len);
+    assert(rc == 0);
+    assert(slab_fragment_len == encoded_fragment_len);
 
-    rc = liberasurecode_verify_stripe_metadata(desc, avail_frags,
-            num_avail_frags);
-    assert(0 == rc);
+    for (i = 0; i < num_fragments; i++) {
+        char *frag = (i < args->k) ? slab_data[i] : slab_parity[i - args->k];
+        char *cmp = (i < args->k) ? encoded_data[i] : encoded_parity[i - args->k];
+        assert(is_addr_aligned((unsigned long)frag, EC_CACHELINE_SIZE));
+        // shss & libphazr fragments are not deterministic
+        if (be_id != EC_BACKEND_SHSS && be_id != EC_BACKEND_LIBPHAZR) {
+            assert(memcmp(frag, cmp, slab_fragment_len) == 0);
+        }
+    }
+
+    int *skip = create_skips_array(args, args->k - 1);
+    assert(skip != NULL);
+    int num_avail_frags = create_frags_array(&avail_frags, slab_data,
+                                             slab_parity, args, skip);
+    rc = liberasurecode_decode(desc, avail_frags, num_avail_frags,
+                               slab_fragment_len, 1,
+                               &decoded_data, &decoded_data_len);
+    assert(rc == 0);
+    assert(decoded_data_len == orig_data_size);
+    assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+    liberasurecode_decode_cleanup(desc, decoded_data);
+
+    /* Cleanup must tell slab and per-fragment allocations apart
+     * regardless of the current setting */
+    rc = liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    assert(rc == 0);
+    rc = liberasurecode_instance_set_option(desc, EC_OPT_SLAB_ALLOC, 0);
+    assert(rc == 0);
+    rc = liberasurecode_encode_cleanup(desc, slab_data, slab_parity);
+    assert(rc == 0);
 
-    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
-    liberasurecode_instance_destroy(desc);
-    free(orig_data);
     free(skip);
     free(avail_frags);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
 }
 
-static void verify_fragment_metadata_mismatch_impl(const ec_backend_id_t be_id, struct ec_args *args,
-        fragment_mismatch_scenario_t scenario)
+static void test_encode_worker_threads(const ec_backend_id_t be_id,
+                                       struct ec_args *args)
 {
-    int orig_data_size = 1024;
+    int i = 0;
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = args->k * 1024 * 1024 + 12345;
+    int num_fragments = args->k + args->m;
+    char *orig_data = NULL;
     char **encoded_data = NULL, **encoded_parity = NULL;
-    char **avail_frags = NULL;
+    char **threaded_data = NULL, **threaded_parity = NULL;
     uint64_t encoded_fragment_len = 0;
-    int rc = -1;
-    int num_avail_frags = -1;
-    int i = 0;
-    uint32_t orig_libec_ver = 0;
-    uint32_t orig_be_ver = 0;
-    uint8_t orig_be_id = 0;
-    uint32_t orig_frag_idx = 0;
-    int *skip = create_skips_array(args,-1);
-    char *orig_data = create_buffer(orig_data_size, 'x');
-    int desc = liberasurecode_instance_create(be_id, args);
+    uint64_t threaded_fragment_len = 0;
+    char **avail_frags = NULL;
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
 
+    desc = liberasurecode_instance_create(be_id, args);
     if (-EBACKENDNOTAVAIL == desc) {
         fprintf(stderr, "Backend library not available!\n");
-        free(orig_data);
-        free(skip);
         return;
     }
     assert(desc > 0);
+
+    orig_data = malloc(orig_data_size);
     assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = (char)(i * 31 + (i >> 11));
+    }
     rc = liberasurecode_encode(desc, orig_data, orig_data_size,
             &encoded_data, &encoded_parity, &encoded_fragment_len);
-    assert(0 == rc);
-    num_avail_frags = create_frags_array(&avail_frags, encoded_data,
-            encoded_parity, args, skip);
-    for (i = 0; i < num_avail_frags; i++) {
+    assert(rc == 0);
+
+    /* The column-wise split must produce exactly the same fragments */
+    rc = liberasurecode_instance_set_option(desc, EC_OPT_WORKER_THREADS, 4);
+    assert(rc == 0);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &threaded_data, &threaded_parity, &threaded_fragment_len);
+    assert(rc == 0);
+    assert(threaded_fragment_len == encoded_fragment_len);
+
+    for (i = 0; i < num_fragments; i++) {
+        char *frag = (i < args->k) ? threaded_data[i] : threaded_parity[i - args->k];
+        char *cmp = (i < args->k) ? encoded_data[i] : encoded_parity[i - args->k];
+        // shss & libphazr fragments are not deterministic
+        if (be_id != EC_BACKEND_SHSS && be_id != EC_BACKEND_LIBPHAZR) {
+            assert(memcmp(frag, cmp, threaded_fragment_len) == 0);
+        }
+    }
+
+    int *skip = create_skips_array(args, args->k - 1);
+    assert(skip != NULL);
+    int num_avail_frags = create_frags_array(&avail_frags, threaded_data,
+                                             threaded_parity, args, skip);
+    rc = liberasurecode_decode(desc, avail_frags, num_avail_frags,
+                               threaded_fragment_len, 1,
+                               &decoded_data, &decoded_data_len);
+    assert(rc == 0);
+    assert(decoded_data_len == orig_data_size);
+    assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+    liberasurecode_decode_cleanup(desc, decoded_data);
+
+    rc = liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    assert(rc == 0);
+    rc = liberasurecode_encode_cleanup(desc, threaded_data, threaded_parity);
+    assert(rc == 0);
+    free(skip);
+    free(avail_frags);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+static void test_encode_checksums(const ec_backend_id_t be_id,
+                                  struct ec_args *args)
+{
+    int i, pass;
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = args->k * 1024 * 1024 + 12345;
+    int num_fragments = args->k + args->m;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = malloc(orig_data_size);
+    assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = (char)(i * 7 + (i >> 13));
+    }
+
+    /* Checksums computed along with the encode match a pass over the
+     * payloads, single or multi-threaded, legacy CRC or not */
+    for (pass = 0; pass < 4; pass++) {
+        if (pass & 1) {
+            setenv("LIBERASURECODE_WRITE_LEGACY_CRC", "1", 1);
+        } else {
+            unsetenv("LIBERASURECODE_WRITE_LEGACY_CRC");
+        }
+        rc = liberasurecode_instance_set_option(desc, EC_OPT_WORKER_THREADS,
+                                                pass & 2 ? 4 : 0);
+        assert(rc == 0);
+        rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+                &encoded_data, &encoded_parity, &encoded_fragment_len);
+        assert(rc == 0);
+
+        for (i = 0; i < num_fragments; i++) {
+            char *frag = (i < args->k) ? encoded_data[i] : encoded_parity[i - args->k];
+            fragment_metadata_t metadata;
+            rc = liberasurecode_get_fragment_metadata(frag, &metadata);
+            assert(rc == 0);
+            assert(metadata.chksum_type == args->ct);
+            validate_fragment_checksum(args, &metadata,
+                                       get_data_ptr_from_fragment(frag));
+        }
+        rc = liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+        assert(rc == 0);
+    }
+    unsetenv("LIBERASURECODE_WRITE_LEGACY_CRC");
+
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+static void test_encode_iov(const ec_backend_id_t be_id,
+                            struct ec_args *args)
+{
+    int i = 0;
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024 * 1024 + 5;
+    int num_fragments = args->k + args->m;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char **iov_data = NULL, **iov_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    uint64_t iov_fragment_len = 0;
+    /* Odd-sized segments, including empty ones, so that segments get
+     * split across fragment boundaries */
+    int seg_lens[] = { 1, 0, 4095, 65537, 0, 333333, 17 };
+    int num_segs = sizeof(seg_lens) / sizeof(seg_lens[0]);
+    struct iovec iov[sizeof(seg_lens) / sizeof(seg_lens[0]) + 1];
+    int off = 0;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < num_segs; i++) {
+        iov[i].iov_base = orig_data + off;
+        iov[i].iov_len = seg_lens[i];
+        off += seg_lens[i];
+    }
+    iov[num_segs].iov_base = orig_data + off;
+    iov[num_segs].iov_len = orig_data_size - off;
+
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+    rc = liberasurecode_encode_iov(desc, iov, num_segs + 1,
+            &iov_data, &iov_parity, &iov_fragment_len);
+    assert(rc == 0);
+    assert(iov_fragment_len == encoded_fragment_len);
+
+    // shss & libphazr fragments are not deterministic
+    if (be_id != EC_BACKEND_SHSS && be_id != EC_BACKEND_LIBPHAZR) {
+        for (i = 0; i < num_fragments; i++) {
+            char *frag = (i < args->k) ? iov_data[i] : iov_parity[i - args->k];
+            char *cmp = (i < args->k) ? encoded_data[i] : encoded_parity[i - args->k];
+            assert(memcmp(frag, cmp, iov_fragment_len) == 0);
+        }
+    }
+
+    liberasurecode_encode_cleanup(desc, iov_data, iov_parity);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+
+    /* invalid segment lists */
+    rc = liberasurecode_encode_iov(desc, NULL, 1,
+            &iov_data, &iov_parity, &iov_fragment_len);
+    assert(rc == -EINVALIDPARAMS);
+    rc = liberasurecode_encode_iov(desc, iov, 0,
+            &iov_data, &iov_parity, &iov_fragment_len);
+    assert(rc == -EINVALIDPARAMS);
+    iov[2].iov_base = NULL;
+    rc = liberasurecode_encode_iov(desc, iov, num_segs + 1,
+            &iov_data, &iov_parity, &iov_fragment_len);
+    assert(rc == -EINVALIDPARAMS);
+
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+static void test_encode_batch(const ec_backend_id_t be_id,
+                              struct ec_args *args)
+{
+    int i = 0, j = 0;
+    int rc = 0;
+    int desc = -1;
+    int num_fragments = args->k + args->m;
+    uint64_t lens[] = { 1, 100, 4096, 65537, 1000 };
+    int n = sizeof(lens) / sizeof(lens[0]);
+    const char *objs[sizeof(lens) / sizeof(lens[0])];
+    struct ec_encode_output outputs[sizeof(lens) / sizeof(lens[0])];
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    char **avail_frags = NULL;
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
+    int *skip = NULL;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    skip = create_skips_array(args, -1);
+    assert(skip != NULL);
+    for (i = 0; i < n; i++) {
+        objs[i] = create_buffer(lens[i], 'a' + i);
+        assert(objs[i] != NULL);
+    }
+
+    rc = liberasurecode_encode_batch(desc, objs, lens, n, outputs);
+    assert(rc == 0);
+
+    for (i = 0; i < n; i++) {
+        rc = liberasurecode_encode(desc, objs[i], lens[i],
+                &encoded_data, &encoded_parity, &encoded_fragment_len);
+        assert(rc == 0);
+        assert(outputs[i].fragment_len == encoded_fragment_len);
+        // shss & libphazr fragments are not deterministic
+        if (be_id != EC_BACKEND_SHSS && be_id != EC_BACKEND_LIBPHAZR) {
+            for (j = 0; j < num_fragments; j++) {
+                char *frag = (j < args->k) ? outputs[i].encoded_data[j]
+                                           : outputs[i].encoded_parity[j - args->k];
+                char *cmp = (j < args->k) ? encoded_data[j] : encoded_parity[j - args->k];
+                assert(memcmp(frag, cmp, encoded_fragment_len) == 0);
+            }
+        }
+        liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+
+        create_frags_array(&avail_frags, outputs[i].encoded_data,
+                           outputs[i].encoded_parity, args, skip);
+        rc = liberasurecode_decode(desc, avail_frags, num_fragments,
+                outputs[i].fragment_len, 1, &decoded_data, &decoded_data_len);
+        assert(rc == 0);
+        assert(decoded_data_len == lens[i]);
+        assert(memcmp(decoded_data, objs[i], lens[i]) == 0);
+        liberasurecode_decode_cleanup(desc, decoded_data);
+        free(avail_frags);
+
+        liberasurecode_encode_cleanup(desc, outputs[i].encoded_data, outputs[i].encoded_parity);
+    }
+
+    rc = liberasurecode_encode_batch(desc, NULL, lens, n, outputs);
+    assert(rc == -EINVALIDPARAMS);
+    rc = liberasurecode_encode_batch(desc, objs, lens, 0, outputs);
+    assert(rc == -EINVALIDPARAMS);
+    rc = liberasurecode_encode_batch(-1, objs, lens, n, outputs);
+    assert(rc == -EBACKENDNOTAVAIL);
+
+    for (i = 0; i < n; i++) {
+        free((char *)objs[i]);
+    }
+    free(skip);
+    liberasurecode_instance_destroy(desc);
+}
+
+struct stream_check {
+    int desc;
+    ec_backend_id_t be_id;
+    struct ec_args *args;
+    const char *data; /* whole object */
+    uint64_t segment_size;
+    uint64_t off; /* start of the next expected segment */
+    int segments;
+};
+
+static int check_stream_segment(void *ctx, char **fragments, int num_fragments,
+                                uint64_t fragment_len)
+{
+    struct stream_check *c = ctx;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
+    uint64_t expected_len = 0;
+    int i, rc;
+
+    assert(num_fragments == c->args->k + c->args->m);
+    rc = liberasurecode_decode(c->desc, fragments, num_fragments, fragment_len, 1,
+                               &decoded_data, &decoded_data_len);
+    assert(rc == 0);
+    expected_len = decoded_data_len;
+    assert(expected_len <= c->segment_size);
+    assert(memcmp(decoded_data, c->data + c->off, decoded_data_len) == 0);
+    liberasurecode_decode_cleanup(c->desc, decoded_data);
+
+    /* Same fragments as encoding the segment by itself */
+    rc = liberasurecode_encode(c->desc, c->data + c->off, expected_len,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+    assert(encoded_fragment_len == fragment_len);
+    // shss & libphazr fragments are not deterministic
+    if (c->be_id != EC_BACKEND_SHSS && c->be_id != EC_BACKEND_LIBPHAZR) {
+        for (i = 0; i < num_fragments; i++) {
+            char *cmp = (i < c->args->k) ? encoded_data[i] : encoded_parity[i - c->args->k];
+            assert(memcmp(fragments[i], cmp, fragment_len) == 0);
+        }
+    }
+    liberasurecode_encode_cleanup(c->desc, encoded_data, encoded_parity);
+
+    c->off += expected_len;
+    c->segments++;
+    return 0;
+}
+
+static int abort_stream_segment(void *ctx, char **fragments, int num_fragments,
+                                uint64_t fragment_len)
+{
+    return -EIO;
+}
+
+static void test_stream_encoder(const ec_backend_id_t be_id,
+                                struct ec_args *args)
+{
+    int rc = 0;
+    int desc = -1;
+    uint64_t orig_data_size = 3 * 65536 + 1234;
+    uint64_t writes[] = { 1, 7, 65535, 100000, 3, 70000 };
+    int num_writes = sizeof(writes) / sizeof(writes[0]);
+    char *orig_data = NULL;
+    ec_stream_encoder_t *enc = NULL;
+    struct stream_check c;
+    uint64_t off = 0;
+    int i = 0;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = (char)(i * 7 + (i >> 9));
+    }
+
+    c = (struct stream_check) { desc, be_id, args, orig_data, 65536, 0, 0 };
+    rc = ec_stream_encoder_create(desc, c.segment_size, check_stream_segment, &c, &enc);
+    assert(rc == 0);
+    for (i = 0; off < orig_data_size; i = (i + 1) % num_writes) {
+        uint64_t n = writes[i] < orig_data_size - off ? writes[i] : orig_data_size - off;
+        rc = ec_stream_encoder_feed(enc, orig_data + off, n);
+        assert(rc == 0);
+        off += n;
+    }
+    assert(c.segments == 3);
+    rc = ec_stream_encoder_finish(enc);
+    assert(rc == 0);
+    assert(c.segments == 4);
+    assert(c.off == orig_data_size);
+
+    /* Final segments re-laid out across more or fewer fragments */
+    for (i = 0; i < 3; i++) {
+        uint64_t tails[] = { 1, 40001, 65535 };
+        c = (struct stream_check) { desc, be_id, args, orig_data, 65536, 0, 0 };
+        rc = ec_stream_encoder_create(desc, c.segment_size, check_stream_segment, &c, &enc);
+        assert(rc == 0);
+        rc = ec_stream_encoder_feed(enc, orig_data, 65536 + tails[i]);
+        assert(rc == 0);
+        rc = ec_stream_encoder_finish(enc);
+        assert(rc == 0);
+        assert(c.segments == 2);
+        assert(c.off == 65536 + tails[i]);
+    }
+
+    /*
+     * Backends with a nonzero encode offset (libphazr) put the data after
+     * metadata sized by the blocksize, so a short final segment moves the
+     * data offset as well as the blocksize
+     */
+    c = (struct stream_check) { desc, be_id, args, orig_data, 3 * 65536, 0, 0 };
+    rc = ec_stream_encoder_create(desc, c.segment_size, check_stream_segment, &c, &enc);
+    assert(rc == 0);
+    rc = ec_stream_encoder_feed(enc, orig_data, 3 * 65536 + 100);
+    assert(rc == 0);
+    rc = ec_stream_encoder_finish(enc);
+    assert(rc == 0);
+    assert(c.segments == 2);
+    assert(c.off == 3 * 65536 + 100);
+
+    /* An empty object still produces one (empty) segment */
+    c = (struct stream_check) { desc, be_id, args, orig_data, 65536, 0, 0 };
+    rc = ec_stream_encoder_create(desc, c.segment_size, check_stream_segment, &c, &enc);
+    assert(rc == 0);
+    rc = ec_stream_encoder_finish(enc);
+    assert(rc == 0);
+    assert(c.segments == 1);
+
+    /* The callback can abort the stream */
+    rc = ec_stream_encoder_create(desc, 4096, abort_stream_segment, NULL, &enc);
+    assert(rc == 0);
+    rc = ec_stream_encoder_feed(enc, orig_data, 8192);
+    assert(rc == -EIO);
+    ec_stream_encoder_destroy(enc);
+
+    rc = ec_stream_encoder_create(desc, 0, check_stream_segment, &c, &enc);
+    assert(rc == -EINVALIDPARAMS);
+    rc = ec_stream_encoder_create(-1, 4096, check_stream_segment, &c, &enc);
+    assert(rc == -EBACKENDNOTAVAIL);
+
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+struct stream_sink {
+    char *streams[EC_MAX_FRAGMENTS]; /* fragments, back to back */
+    uint64_t lens[EC_MAX_FRAGMENTS];
+    char *out; /* decoded object */
+    uint64_t out_len;
+};
+
+static int collect_stream_segment(void *ctx, char **fragments, int num_fragments,
+                                  uint64_t fragment_len)
+{
+    struct stream_sink *sink = ctx;
+    int i;
+
+    for (i = 0; i < num_fragments; i++) {
+        sink->streams[i] = realloc(sink->streams[i], sink->lens[i] + fragment_len);
+        assert(sink->streams[i] != NULL);
+        memcpy(sink->streams[i] + sink->lens[i], fragments[i], fragment_len);
+        sink->lens[i] += fragment_len;
+    }
+    return 0;
+}
+
+static int collect_stream_output(void *ctx, const char *data, uint64_t len)
+{
+    struct stream_sink *sink = ctx;
+
+    sink->out = realloc(sink->out, sink->out_len + len + 1);
+    assert(sink->out != NULL);
+    memcpy(sink->out + sink->out_len, data, len);
+    sink->out_len += len;
+    return 0;
+}
+
+static int abort_stream_output(void *ctx, const char *data, uint64_t len)
+{
+    return -EIO;
+}
+
+static void test_stream_decoder(const ec_backend_id_t be_id,
+                                struct ec_args *args)
+{
+    int rc = 0;
+    int desc = -1;
+    int num_fragments = args->k + args->m;
+    uint64_t orig_data_size = 3 * 65536 + 1234;
+    char *orig_data = NULL;
+    ec_stream_encoder_t *enc = NULL;
+    ec_stream_decoder_t *dec = NULL;
+    struct stream_sink sink;
+    uint64_t offs[EC_MAX_FRAGMENTS];
+    uint64_t consumed = 0;
+    char garbage[sizeof(fragment_header_t)];
+    int late = num_fragments - 1; /* only fed once the others are done */
+    int progress = 1;
+    int i = 0;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    for (i = 0; i < orig_data_size; i++) {
+        orig_data[i] = (char)(i * 7 + (i >> 9));
+    }
+
+    memset(&sink, 0, sizeof(sink));
+    rc = ec_stream_encoder_create(desc, 65536, collect_stream_segment, &sink, &enc);
+    assert(rc == 0);
+    rc = ec_stream_encoder_feed(enc, orig_data, orig_data_size);
+    assert(rc == 0);
+    rc = ec_stream_encoder_finish(enc);
+    assert(rc == 0);
+
+    /* Source 0 never shows up, the others are fed in uneven chunks so
+     * they run ahead of each other; the late one gets skipped over */
+    memset(offs, 0, sizeof(offs));
+    rc = ec_stream_decoder_create(desc, collect_stream_output, &sink, &dec);
+    assert(rc == 0);
+    while (progress) {
+        progress = 0;
+        for (i = 1; i < num_fragments; i++) {
+            uint64_t n = 1000 + 777 * i;
+            if (i == late && args->m > 1 && progress) {
+                continue;
+            }
+            if (n > sink.lens[i] - offs[i]) {
+                n = sink.lens[i] - offs[i];
+            }
+            if (n == 0) {
+                continue;
+            }
+            rc = ec_stream_decoder_feed(dec, i, sink.streams[i] + offs[i], n, &consumed);
+            assert(rc == 0);
+            assert(consumed <= n);
+            offs[i] += consumed;
+            progress |= consumed > 0;
+        }
+    }
+    rc = ec_stream_decoder_finish(dec);
+    assert(rc == 0);
+    assert(sink.out_len == orig_data_size);
+    assert(memcmp(sink.out, orig_data, orig_data_size) == 0);
+
+    /* Streams ending mid-segment */
+    rc = ec_stream_decoder_create(desc, collect_stream_output, &sink, &dec);
+    assert(rc == 0);
+    rc = ec_stream_decoder_feed(dec, 1, sink.streams[1], sizeof(fragment_header_t) + 1,
+                                &consumed);
+    assert(rc == 0);
+    assert(consumed == sizeof(fragment_header_t) + 1);
+    rc = ec_stream_decoder_finish(dec);
+    assert(rc == -EINSUFFFRAGS);
+
+    /* The callback can abort the stream */
+    rc = ec_stream_decoder_create(desc, abort_stream_output, NULL, &dec);
+    assert(rc == 0);
+    for (i = 0; i < num_fragments && rc == 0; i++) {
+        rc = ec_stream_decoder_feed(dec, i, sink.streams[i], sink.lens[i], &consumed);
+    }
+    assert(rc == -EIO);
+    ec_stream_decoder_destroy(dec);
+
+    rc = ec_stream_decoder_create(desc, collect_stream_output, &sink, &dec);
+    assert(rc == 0);
+    memset(garbage, 'g', sizeof(garbage));
+    rc = ec_stream_decoder_feed(dec, 0, garbage, sizeof(garbage), &consumed);
+    assert(rc == -EBADHEADER);
+    rc = ec_stream_decoder_feed(dec, num_fragments, garbage, sizeof(garbage), &consumed);
+    assert(rc == -EINVALIDPARAMS);
+    ec_stream_decoder_destroy(dec);
+
+    rc = ec_stream_decoder_create(-1, collect_stream_output, &sink, &dec);
+    assert(rc == -EBACKENDNOTAVAIL);
+    rc = ec_stream_decoder_create(desc, NULL, &sink, &dec);
+    assert(rc == -EINVALIDPARAMS);
+
+    for (i = 0; i < num_fragments; i++) {
+        free(sink.streams[i]);
+    }
+    free(sink.out);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+static void test_decode_table_cache(const ec_backend_id_t be_id,
+                                    struct ec_args *args)
+{
+    int i = 0;
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024 * 128;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    char **avail_frags = NULL;
+    int num_avail_frags = 0;
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
+    struct ec_table_cache_stats stats;
+    int *skip = NULL;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    rc = liberasurecode_get_table_cache_stats(desc, &stats);
+    if (rc == -EBACKENDNOTSUPP) {
+        liberasurecode_instance_destroy(desc);
+        return;
+    }
+    assert(rc == 0);
+    assert(stats.hits == 0 && stats.misses == 0 && stats.evictions == 0);
+    rc = liberasurecode_get_table_cache_stats(desc, NULL);
+    assert(rc == -EINVALIDPARAMS);
+    rc = liberasurecode_get_table_cache_stats(-1, &stats);
+    assert(rc == -EBACKENDNOTAVAIL);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+
+    /* The same erasure pattern only builds its tables once */
+    skip = create_skips_array(args, 0);
+    assert(skip != NULL);
+    num_avail_frags = create_frags_array(&avail_frags, encoded_data,
+                                         encoded_parity, args, skip);
+    for (i = 0; i < 3; i++) {
+        rc = liberasurecode_decode(desc, avail_frags, num_avail_frags,
+                                   encoded_fragment_len, 1,
+                                   &decoded_data, &decoded_data_len);
+        assert(rc == 0);
+        assert(decoded_data_len == orig_data_size);
+        assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+        liberasurecode_decode_cleanup(desc, decoded_data);
+    }
+    rc = liberasurecode_get_table_cache_stats(desc, &stats);
+    assert(rc == 0);
+    assert(stats.misses == 1);
+    assert(stats.hits == 2);
+    free(avail_frags);
+    free(skip);
+
+    /* A different pattern gets its own tables */
+    skip = create_skips_array(args, 1);
+    assert(skip != NULL);
+    num_avail_frags = create_frags_array(&avail_frags, encoded_data,
+                                         encoded_parity, args, skip);
+    rc = liberasurecode_decode(desc, avail_frags, num_avail_frags,
+                               encoded_fragment_len, 1,
+                               &decoded_data, &decoded_data_len);
+    assert(rc == 0);
+    assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+    liberasurecode_decode_cleanup(desc, decoded_data);
+    rc = liberasurecode_get_table_cache_stats(desc, &stats);
+    assert(rc == 0);
+    assert(stats.misses == 2);
+    assert(stats.hits == 2);
+    assert(stats.evictions == 0);
+    free(avail_frags);
+    free(skip);
+
+    /* Reconstruct tables are kept per destination */
+    if (args->m >= 2) {
+        char *out = malloc(encoded_fragment_len);
+        assert(out != NULL);
+        skip = create_skips_array(args, 0);
+        assert(skip != NULL);
+        skip[1] = 1;
+        num_avail_frags = create_frags_array(&avail_frags, encoded_data,
+                                             encoded_parity, args, skip);
+        for (i = 0; i < 3; i++) {
+            rc = liberasurecode_reconstruct_fragment(desc, avail_frags, num_avail_frags,
+                                                     encoded_fragment_len, i % 2, out);
+            assert(rc == 0);
+            assert(memcmp(out, encoded_data[i % 2], encoded_fragment_len) == 0);
+        }
+        rc = liberasurecode_get_table_cache_stats(desc, &stats);
+        assert(rc == 0);
+        assert(stats.misses == 4);
+        assert(stats.hits == 3);
+        free(avail_frags);
+        free(skip);
+        free(out);
+    }
+
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+static void test_decode_into(const ec_backend_id_t be_id,
+                             struct ec_args *args)
+{
+    int i = 0;
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024 * 1024 + 7;
+    int num_fragments = args->k + args->m;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    char **avail_frags = NULL;
+    char *out_buf = NULL;
+    uint64_t out_len = 0;
+    int num_avail_frags = 0;
+    int *skip = NULL;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    skip = create_skips_array(args, -1);
+    assert(skip != NULL);
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+
+    out_buf = malloc(orig_data_size + 1);
+    assert(out_buf != NULL);
+    memset(out_buf, 0xa5, orig_data_size + 1);
+
+    /* All fragments available */
+    num_avail_frags = create_frags_array(&avail_frags, encoded_data,
+                                         encoded_parity, args, skip);
+    assert(num_avail_frags == num_fragments);
+    rc = liberasurecode_decode_into(desc, avail_frags, num_avail_frags,
+            encoded_fragment_len, 1, out_buf, orig_data_size + 1, &out_len);
+    assert(rc == 0);
+    assert(out_len == orig_data_size);
+    assert(memcmp(out_buf, orig_data, orig_data_size) == 0);
+    /* Nothing past the decoded data may be touched */
+    assert((unsigned char)out_buf[orig_data_size] == 0xa5);
+    free(avail_frags);
+
+    /* Too small a buffer reports the size needed */
+    num_avail_frags = create_frags_array(&avail_frags, encoded_data,
+                                         encoded_parity, args, skip);
+    out_len = 0;
+    rc = liberasurecode_decode_into(desc, avail_frags, num_avail_frags,
+            encoded_fragment_len, 0, out_buf, orig_data_size - 1, &out_len);
+    assert(rc == -EINVALIDPARAMS);
+    assert(out_len == orig_data_size);
+    free(avail_frags);
+
+    /* A missing data fragment forces a real decode */
+    memset(out_buf, 0, orig_data_size + 1);
+    skip[0] = 1;
+    num_avail_frags = create_frags_array(&avail_frags, encoded_data,
+                                         encoded_parity, args, skip);
+    rc = liberasurecode_decode_into(desc, avail_frags, num_avail_frags,
+            encoded_fragment_len, 0, out_buf, orig_data_size, &out_len);
+    assert(rc == 0);
+    assert(out_len == orig_data_size);
+    assert(memcmp(out_buf, orig_data, orig_data_size) == 0);
+    free(avail_frags);
+
+    rc = liberasurecode_decode_into(desc, encoded_data, args->k,
+            encoded_fragment_len, 0, NULL, orig_data_size, &out_len);
+    assert(rc == -EINVALIDPARAMS);
+
+    /*
+     * With data[0] missing, corrupted payloads are only caught with
+     * metadata checks forced
+     */
+    num_avail_frags = create_frags_array(&avail_frags, encoded_data,
+                                         encoded_parity, args, skip);
+    for (i = 0; i < args->m; i++) {
+        get_data_ptr_from_fragment(avail_frags[i])[0] ^= 0x10;
+    }
+    rc = liberasurecode_decode_into(desc, avail_frags, num_avail_frags,
+            encoded_fragment_len, 0, out_buf, orig_data_size, &out_len);
+    assert(rc == 0);
+    rc = liberasurecode_decode_into(desc, avail_frags, num_avail_frags,
+            encoded_fragment_len, 1, out_buf, orig_data_size, &out_len);
+    assert(rc == -EINSUFFFRAGS);
+    for (i = 0; i < args->m; i++) {
+        get_data_ptr_from_fragment(avail_frags[i])[0] ^= 0x10;
+    }
+    free(avail_frags);
+
+    free(out_buf);
+    free(skip);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+static void test_decode_iov(const ec_backend_id_t be_id,
+                            struct ec_args *args)
+{
+    int i = 0;
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024 * 1024 + 9;
+    int num_fragments = args->k + args->m;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    char **avail_frags = NULL;
+    struct iovec iov[EC_MAX_FRAGMENTS];
+    int iovcnt = 0;
+    uint64_t out_len = 0;
+    uint64_t off = 0;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+
+    /* Hand the fragments over in reverse order */
+    avail_frags = malloc(num_fragments * sizeof(char *));
+    assert(avail_frags != NULL);
+    for (i = 0; i < num_fragments; i++) {
+        int idx = num_fragments - 1 - i;
+        avail_frags[i] = (idx < args->k) ? encoded_data[idx] : encoded_parity[idx - args->k];
+    }
+
+    iovcnt = EC_MAX_FRAGMENTS;
+    rc = liberasurecode_decode_iov(desc, avail_frags, num_fragments,
+            encoded_fragment_len, iov, &iovcnt, &out_len);
+    if (rc == -EBACKENDNOTSUPP) {
+        /* not a systematic code */
+        goto out;
+    }
+    assert(rc == 0);
+    assert(out_len == orig_data_size);
+    assert(iovcnt > 0 && iovcnt <= args->k);
+    for (i = 0; i < iovcnt; i++) {
+        assert(off + iov[i].iov_len <= out_len);
+        assert(memcmp(iov[i].iov_base, orig_data + off, iov[i].iov_len) == 0);
+        off += iov[i].iov_len;
+    }
+    assert(off == out_len);
+
+    /* Not enough room for the segments */
+    if (iovcnt > 1) {
+        int short_cnt = iovcnt - 1;
+        rc = liberasurecode_decode_iov(desc, avail_frags, num_fragments,
+                encoded_fragment_len, iov, &short_cnt, &out_len);
+        assert(rc == -EINVALIDPARAMS);
+    }
+
+    /* Without data fragment 0 the caller has to decode */
+    iovcnt = EC_MAX_FRAGMENTS;
+    rc = liberasurecode_decode_iov(desc, avail_frags, num_fragments - 1,
+            encoded_fragment_len, iov, &iovcnt, &out_len);
+    assert(rc == -EINSUFFFRAGS);
+
+    rc = liberasurecode_decode_iov(desc, avail_frags, num_fragments,
+            encoded_fragment_len, NULL, &iovcnt, &out_len);
+    assert(rc == -EINVALIDPARAMS);
+
+out:
+    free(avail_frags);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+/* Rewrite a fragment header as a host of the opposite byte order would have */
+static void swap_fragment_header(char *fragment)
+{
+    fragment_header_t *hdr = (fragment_header_t *) fragment;
+    int i;
+
+    hdr->meta.idx = __builtin_bswap32(hdr->meta.idx);
+    hdr->meta.size = __builtin_bswap32(hdr->meta.size);
+    hdr->meta.frag_backend_metadata_size =
+        __builtin_bswap32(hdr->meta.frag_backend_metadata_size);
+    hdr->meta.orig_data_size = __builtin_bswap64(hdr->meta.orig_data_size);
+    for (i = 0; i < LIBERASURECODE_MAX_CHECKSUM_LEN; i++) {
+        hdr->meta.chksum[i] = __builtin_bswap32(hdr->meta.chksum[i]);
+    }
+    hdr->meta.backend_version = __builtin_bswap32(hdr->meta.backend_version);
+    hdr->magic = __builtin_bswap32(hdr->magic);
+    hdr->libec_version = __builtin_bswap32(hdr->libec_version);
+    hdr->metadata_chksum = __builtin_bswap32(crc32(0, (unsigned char *) &hdr->meta,
+                                                   sizeof(fragment_metadata_t)));
+}
+
+static void test_get_object_crc32(const ec_backend_id_t be_id,
+                                  struct ec_args *args)
+{
+    int sizes[] = { 1, 100, 4096 + 3, 1024 * 1024 + 9 };
+    int i, j;
+    int rc = 0;
+    int desc = -1;
+    int num_fragments = args->k + args->m;
+    struct ec_args no_chksum_args = *args;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    char **avail_frags = NULL;
+    char *swapped_frags[EC_MAX_FRAGMENTS];
+    char *other_obj = NULL;
+    char **other_data = NULL, **other_parity = NULL;
+    uint64_t other_fragment_len = 0;
+    char *saved_frag = NULL;
+    uint32_t crc = 0;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    avail_frags = malloc(num_fragments * sizeof(char *));
+    assert(avail_frags != NULL);
+    for (i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+        orig_data = malloc(sizes[i]);
+        assert(orig_data != NULL);
+        for (j = 0; j < sizes[i]; j++) {
+            orig_data[j] = rand();
+        }
+        rc = liberasurecode_encode(desc, orig_data, sizes[i],
+                &encoded_data, &encoded_parity, &encoded_fragment_len);
+        assert(rc == 0);
+        for (j = 0; j < num_fragments; j++) {
+            int idx = num_fragments - 1 - j;
+            avail_frags[j] = (idx < args->k) ? encoded_data[idx] : encoded_parity[idx - args->k];
+        }
+
+        rc = liberasurecode_get_object_crc32(desc, avail_frags, num_fragments,
+                encoded_fragment_len, &crc);
+        if (rc == -EBACKENDNOTSUPP) {
+            /* not a systematic code */
+            liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+            free(orig_data);
+            goto out;
+        }
+        assert(rc == 0);
+        assert(crc == crc32(0, (unsigned char *) orig_data, sizes[i]));
+
+        /* Same result from fragments written on an opposite-endian host */
+        for (j = 0; j < num_fragments; j++) {
+            swapped_frags[j] = malloc(encoded_fragment_len);
+            assert(swapped_frags[j] != NULL);
+            memcpy(swapped_frags[j], avail_frags[j], encoded_fragment_len);
+            swap_fragment_header(swapped_frags[j]);
+        }
+        crc = 0;
+        rc = liberasurecode_get_object_crc32(desc, swapped_frags, num_fragments,
+                encoded_fragment_len, &crc);
+        assert(rc == 0);
+        assert(crc == crc32(0, (unsigned char *) orig_data, sizes[i]));
+        for (j = 0; j < num_fragments; j++) {
+            free(swapped_frags[j]);
+        }
+
+        /* Without data fragment 0 the payload has to be read */
+        rc = liberasurecode_get_object_crc32(desc, avail_frags, num_fragments - 1,
+                encoded_fragment_len, &crc);
+        assert(rc == -EINSUFFFRAGS);
+
+        /* A data fragment of another object is rejected */
+        other_obj = create_buffer(sizes[i] + 1, 'y');
+        assert(other_obj != NULL);
+        rc = liberasurecode_encode(desc, other_obj, sizes[i] + 1,
+                &other_data, &other_parity, &other_fragment_len);
+        assert(rc == 0);
+        saved_frag = avail_frags[num_fragments - 1];
+        avail_frags[num_fragments - 1] = other_data[0];
+        rc = liberasurecode_get_object_crc32(desc, avail_frags, num_fragments,
+                encoded_fragment_len, &crc);
+        assert(rc == -EBADHEADER);
+        avail_frags[num_fragments - 1] = saved_frag;
+        liberasurecode_encode_cleanup(desc, other_data, other_parity);
+        free(other_obj);
+
+        liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+        free(orig_data);
+    }
+
+    rc = liberasurecode_get_object_crc32(desc, avail_frags, num_fragments,
+            encoded_fragment_len, NULL);
+    assert(rc == -EINVALIDPARAMS);
+
+    /* Legacy CRCs can not be combined into a zlib CRC */
+    setenv("LIBERASURECODE_WRITE_LEGACY_CRC", "1", 1);
+    orig_data = create_buffer(sizes[2], 'x');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, sizes[2],
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    unsetenv("LIBERASURECODE_WRITE_LEGACY_CRC");
+    assert(rc == 0);
+    rc = liberasurecode_get_object_crc32(desc, encoded_data, args->k,
+            encoded_fragment_len, &crc);
+    assert(rc == -EBADCHKSUM);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    free(orig_data);
+
+    /* Fragments without CRC32 checksums */
+    liberasurecode_instance_destroy(desc);
+    no_chksum_args.ct = CHKSUM_NONE;
+    desc = liberasurecode_instance_create(be_id, &no_chksum_args);
+    assert(desc > 0);
+    orig_data = create_buffer(sizes[0], 'x');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, sizes[0],
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+    rc = liberasurecode_get_object_crc32(desc, encoded_data, args->k,
+            encoded_fragment_len, &crc);
+    assert(rc == -EBADCHKSUM);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    free(orig_data);
+
+out:
+    free(avail_frags);
+    liberasurecode_instance_destroy(desc);
+}
+
+static void test_buffer_pool(const ec_backend_id_t be_id,
+                             struct ec_args *args)
+{
+    int i = 0;
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024 * 1024 + 11;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    char **avail_frags = NULL;
+    int num_avail_frags = 0;
+    char *decoded_data = NULL;
+    uint64_t decoded_data_len = 0;
+    int *skip = NULL;
+    char *pooled_frags = NULL;
+    struct ec_buffer_pool_stats before, after;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    rc = liberasurecode_instance_set_option(desc, EC_OPT_BUFFER_POOL, args->k + args->m);
+    assert(rc == 0);
+    skip = create_skips_array(args, 0);
+    assert(skip != NULL);
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+
+    rc = liberasurecode_get_buffer_pool_stats(&before);
+    assert(rc == 0);
+
+    /* The second round should be served from the pool */
+    for (i = 0; i < 2; i++) {
+        rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+                &encoded_data, &encoded_parity, &encoded_fragment_len);
+        assert(rc == 0);
+
+        num_avail_frags = create_frags_array(&avail_frags, encoded_data,
+                                             encoded_parity, args, skip);
+        rc = liberasurecode_decode(desc, avail_frags, num_avail_frags,
+                encoded_fragment_len, 1, &decoded_data, &decoded_data_len);
+        assert(rc == 0);
+        assert(decoded_data_len == orig_data_size);
+        assert(memcmp(decoded_data, orig_data, orig_data_size) == 0);
+
+        liberasurecode_decode_cleanup(desc, decoded_data);
+        free(avail_frags);
+        liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    }
+
+    rc = liberasurecode_get_buffer_pool_stats(&after);
+    assert(rc == 0);
+    assert(after.hits >= before.hits + args->k + args->m);
+    assert(after.recycled > before.recycled);
+
+    /*
+     * Recycled buffers come back dirty: a shorter object laid out in them
+     * must match the same object encoded into fresh buffers, padding
+     * included
+     */
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size - 4099,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+    pooled_frags = malloc((args->k + args->m) * encoded_fragment_len);
+    assert(pooled_frags != NULL);
+    for (i = 0; i < args->k + args->m; i++) {
+        char *frag = i < args->k ? encoded_data[i] : encoded_parity[i - args->k];
+        memcpy(pooled_frags + i * encoded_fragment_len, frag, encoded_fragment_len);
+    }
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    rc = liberasurecode_instance_set_option(desc, EC_OPT_BUFFER_POOL, 0);
+    assert(rc == 0);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size - 4099,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+    for (i = 0; i < args->k + args->m; i++) {
+        char *frag = i < args->k ? encoded_data[i] : encoded_parity[i - args->k];
+        assert(memcmp(pooled_frags + i * encoded_fragment_len, frag,
+                      encoded_fragment_len) == 0);
+    }
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    free(pooled_frags);
+    rc = liberasurecode_instance_set_option(desc, EC_OPT_BUFFER_POOL, args->k + args->m);
+    assert(rc == 0);
+
+    /* Fragments from the pool are still freed fine once it is turned off */
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+    rc = liberasurecode_instance_set_option(desc, EC_OPT_BUFFER_POOL, 0);
+    assert(rc == 0);
+    rc = liberasurecode_get_buffer_pool_stats(&before);
+    assert(rc == 0);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    /* ... and do not bring the released pool back */
+    rc = liberasurecode_get_buffer_pool_stats(&after);
+    assert(rc == 0);
+    assert(after.recycled == before.recycled);
+    assert(after.released == before.released);
+
+    /* Destroying the last instance using the pool frees this thread's */
+    rc = liberasurecode_instance_set_option(desc, EC_OPT_BUFFER_POOL, args->k + args->m);
+    assert(rc == 0);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    desc = liberasurecode_instance_create(be_id, args);
+    assert(desc > 0);
+    rc = liberasurecode_instance_set_option(desc, EC_OPT_BUFFER_POOL, args->k + args->m);
+    assert(rc == 0);
+    rc = liberasurecode_get_buffer_pool_stats(&before);
+    assert(rc == 0);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+    rc = liberasurecode_get_buffer_pool_stats(&after);
+    assert(rc == 0);
+    assert(after.hits == before.hits);
+    assert(after.misses >= before.misses + args->k + args->m);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+
+    assert(liberasurecode_buffer_pool_flush() == 0);
+
+    free(skip);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+}
+
+static void test_instance_set_option_invalid_args(void)
+{
+    int rc = 0;
+    int desc = -1;
+
+    rc = liberasurecode_instance_set_option(desc, EC_OPT_SLAB_ALLOC, 1);
+    assert(rc == -EBACKENDNOTAVAIL);
+
+    desc = liberasurecode_instance_create(EC_BACKEND_NULL, &null_args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    rc = liberasurecode_instance_set_option(desc, EC_OPTS_MAX, 1);
+    assert(rc == -EINVALIDPARAMS);
+    rc = liberasurecode_instance_set_option(desc, -1, 1);
+    assert(rc == -EINVALIDPARAMS);
+    rc = liberasurecode_instance_set_option(desc, EC_OPT_BUFFER_POOL, -1);
+    assert(rc == -EINVALIDPARAMS);
+    rc = liberasurecode_instance_set_option(desc, EC_OPT_SLAB_ALLOC, 1);
+    assert(rc == 0);
+
+    rc = liberasurecode_get_buffer_pool_stats(NULL);
+    assert(rc == -EINVALIDPARAMS);
+
+    liberasurecode_instance_destroy(desc);
+}
+
+static void test_jerasure_rs_vand_simple_encode_decode_over_max_frags(void)
+{
+    struct ec_args over_args = {
+        .k = 300,
+        .m = 20,
+    };
+
+    int *skip = create_skips_array(&over_args, 1);
+    assert(skip != NULL);
+    // should return an error
+    encode_decode_test_impl(EC_BACKEND_JERASURE_RS_VAND,
+                            &over_args, skip);
+    free(skip);
+}
+
+static void test_simple_reconstruct(const ec_backend_id_t be_id,
+                                    struct ec_args *args)
+{
+    if (args->k + args->m > 100) {
+        fprintf(stderr, "Too many total frags; skipping\n");
+        return;
+    }
+    int i = 0;
+    for (i = 0; i < args->k + args->m; i++) {
+        int *skip = create_skips_array(args,i);
+        assert(skip != NULL);
+        reconstruct_test_impl(be_id, args, skip);
+        free(skip);
+    }
+}
+
+static void test_reconstruct_parity_from_data(const ec_backend_id_t be_id,
+                                              struct ec_args *args)
+{
+    int i = 0;
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024 * 128;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    char **avail_frags = NULL;
+    int num_avail_frags = 0;
+    char *out = NULL;
+    int *skip = NULL;
+    struct ec_table_cache_stats stats;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+    out = malloc(encoded_fragment_len);
+    assert(out != NULL);
+
+    /* Only the data is left: every parity comes back from it alone */
+    skip = create_skips_array(args, -1);
+    assert(skip != NULL);
+    for (i = args->k; i < args->k + args->m; i++) {
+        skip[i] = 1;
+    }
+    num_avail_frags = create_frags_array(&avail_frags, encoded_data,
+                                         encoded_parity, args, skip);
+    assert(num_avail_frags == args->k);
+    for (i = 0; i < args->m; i++) {
+        memset(out, 0, encoded_fragment_len);
+        rc = liberasurecode_reconstruct_fragment(desc, avail_frags, num_avail_frags,
+                                                 encoded_fragment_len, args->k + i, out);
+        assert(rc == 0);
+        assert(memcmp(out, encoded_parity[i], encoded_fragment_len) == 0);
+    }
+
+    /* No decoding tables were needed for that */
+    rc = liberasurecode_get_table_cache_stats(desc, &stats);
+    if (rc == 0) {
+        assert(stats.misses == 0);
+    }
+
+    free(avail_frags);
+    free(skip);
+    free(out);
+    free(orig_data);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+}
+
+static void reconstruct_fragments_test_impl(int desc, struct ec_args *args,
+                                            char **encoded_data,
+                                            char **encoded_parity,
+                                            uint64_t encoded_fragment_len,
+                                            int *dests)
+{
+    int i = 0;
+    int rc = 0;
+    int *skip = NULL;
+    char **avail_frags = NULL;
+    int num_avail_frags = 0;
+    char *outs[EC_MAX_FRAGMENTS];
+
+    skip = create_skips_array(args, -1);
+    assert(skip != NULL);
+    for (i = 0; dests[i] > -1; i++) {
+        skip[dests[i]] = 1;
+        outs[i] = malloc(encoded_fragment_len);
+        assert(outs[i] != NULL);
+        memset(outs[i], 0, encoded_fragment_len);
+    }
+    num_avail_frags = create_frags_array(&avail_frags, encoded_data,
+                                         encoded_parity, args, skip);
+    rc = liberasurecode_reconstruct_fragments(desc, avail_frags, num_avail_frags,
+                                              encoded_fragment_len, dests, outs);
+    assert(rc == 0);
+    for (i = 0; dests[i] > -1; i++) {
+        char *cmp = dests[i] < args->k ? encoded_data[dests[i]]
+                                       : encoded_parity[dests[i] - args->k];
+        assert(memcmp(outs[i], cmp, encoded_fragment_len) == 0);
+        free(outs[i]);
+    }
+    free(avail_frags);
+    free(skip);
+}
+
+static void test_reconstruct_fragments(const ec_backend_id_t be_id,
+                                       struct ec_args *args)
+{
+    int i = 0;
+    int rc = 0;
+    int desc = -1;
+    int orig_data_size = 1024 * 128;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    char *outs[2] = { NULL, NULL };
+    int dests[EC_MAX_FRAGMENTS + 1];
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+
+    /* A data and a parity fragment */
+    dests[0] = 0;
+    dests[1] = args->k;
+    dests[2] = -1;
+    reconstruct_fragments_test_impl(desc, args, encoded_data, encoded_parity,
+                                    encoded_fragment_len, dests);
+
+    /* Two data fragments */
+    if (args->m >= 2) {
+        dests[1] = 1;
+        reconstruct_fragments_test_impl(desc, args, encoded_data,
+                                        encoded_parity, encoded_fragment_len,
+                                        dests);
+    }
+
+    /* Every parity fragment, from the data alone */
+    for (i = 0; i < args->m; i++) {
+        dests[i] = args->k + i;
+    }
+    dests[args->m] = -1;
+    reconstruct_fragments_test_impl(desc, args, encoded_data, encoded_parity,
+                                    encoded_fragment_len, dests);
+
+    /* Empty, duplicate and out of range destinations are refused */
+    outs[0] = malloc(encoded_fragment_len);
+    outs[1] = malloc(encoded_fragment_len);
+    assert(outs[0] != NULL && outs[1] != NULL);
+    dests[0] = -1;
+    rc = liberasurecode_reconstruct_fragments(desc, encoded_data, args->k,
+                                              encoded_fragment_len, dests, outs);
+    assert(rc == -EINVALIDPARAMS);
+    dests[0] = args->k;
+    dests[1] = args->k;
+    dests[2] = -1;
+    rc = liberasurecode_reconstruct_fragments(desc, encoded_data, args->k,
+                                              encoded_fragment_len, dests, outs);
+    assert(rc == -EINVALIDPARAMS);
+    dests[1] = args->k + args->m;
+    rc = liberasurecode_reconstruct_fragments(desc, encoded_data, args->k,
+                                              encoded_fragment_len, dests, outs);
+    assert(rc == -EINVALIDPARAMS);
+    rc = liberasurecode_reconstruct_fragments(desc, encoded_data, args->k,
+                                              encoded_fragment_len, NULL, outs);
+    assert(rc == -EINVALIDPARAMS);
+
+    free(outs[0]);
+    free(outs[1]);
+    free(orig_data);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+}
+
+static void test_reconstruct_fragment_batch(const ec_backend_id_t be_id,
+                                            struct ec_args *args)
+{
+    int i = 0, t = 0;
+    int rc = 0;
+    int desc = -1;
+    int num_stripes = 7;
+    /* Large enough for the batch to be split across three threads */
+    int orig_data_size = 1024 * 128 * args->k;
+    char *orig_data = NULL;
+    char **encoded_data[7], **encoded_parity[7];
+    uint64_t encoded_fragment_len = 0;
+    char **avail_frags[7];
+    char *outs[7];
+    int *skip = NULL;
+    int dest = args->k;
+    struct ec_table_cache_stats before, stats;
+    int have_stats = 0;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    skip = create_skips_array(args, 0);
+    assert(skip != NULL);
+    skip[dest] = 1;
+    for (i = 0; i < num_stripes; i++) {
+        orig_data = create_buffer(orig_data_size, 'a' + i);
+        assert(orig_data != NULL);
+        rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+                &encoded_data[i], &encoded_parity[i], &encoded_fragment_len);
+        assert(rc == 0);
+        free(orig_data);
+        create_frags_array(&avail_frags[i], encoded_data[i],
+                           encoded_parity[i], args, skip);
+        outs[i] = malloc(encoded_fragment_len);
+        assert(outs[i] != NULL);
+    }
+
+    /* On the calling thread, then split across three workers */
+    for (t = 0; t < 2; t++) {
+        rc = liberasurecode_instance_set_option(desc, EC_OPT_WORKER_THREADS, t * 3);
+        assert(rc == 0);
+        for (i = 0; i < num_stripes; i++) {
+            memset(outs[i], 0, encoded_fragment_len);
+        }
+        have_stats = liberasurecode_get_table_cache_stats(desc, &before) == 0;
+        rc = liberasurecode_reconstruct_fragment_batch(desc, avail_frags,
+                num_stripes, args->k + args->m - 2, encoded_fragment_len,
+                dest, outs);
+        assert(rc == 0);
+        for (i = 0; i < num_stripes; i++) {
+            assert(memcmp(outs[i], encoded_parity[i][0],
+                          encoded_fragment_len) == 0);
+        }
+
+        /* The backend set its tables up once for the whole batch */
+        if (have_stats) {
+            rc = liberasurecode_get_table_cache_stats(desc, &stats);
+            assert(rc == 0);
+            assert(stats.hits + stats.misses == before.hits + before.misses + 1);
+            assert(stats.misses <= 1);
+        }
+    }
+
+    /* Every stripe has to share the pattern of the first one */
+    free(avail_frags[3]);
+    skip[1] = 1;
+    skip[0] = 0;
+    create_frags_array(&avail_frags[3], encoded_data[3], encoded_parity[3],
+                       args, skip);
+    rc = liberasurecode_reconstruct_fragment_batch(desc, avail_frags,
+            num_stripes, args->k + args->m - 2, encoded_fragment_len, dest,
+            outs);
+    assert(rc == -EINVALIDPARAMS);
+
+    rc = liberasurecode_reconstruct_fragment_batch(desc, avail_frags, 0,
+            args->k + args->m - 2, encoded_fragment_len, dest, outs);
+    assert(rc == -EINVALIDPARAMS);
+    rc = liberasurecode_reconstruct_fragment_batch(desc, NULL, num_stripes,
+            args->k + args->m - 2, encoded_fragment_len, dest, outs);
+    assert(rc == -EINVALIDPARAMS);
+
+    for (i = 0; i < num_stripes; i++) {
+        free(avail_frags[i]);
+        free(outs[i]);
+        liberasurecode_encode_cleanup(desc, encoded_data[i], encoded_parity[i]);
+    }
+    free(skip);
+    liberasurecode_instance_destroy(desc);
+}
+
+static void test_update_parity(const ec_backend_id_t be_id,
+                               struct ec_args *args)
+{
+    int i = 0;
+    int rc = 0;
+    int desc = -1;
+    int data_idx = args->k > 1 ? 1 : 0;
+    int orig_data_size = 1024 * 64;
+    char *orig_data = NULL;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char **expected_data = NULL, **expected_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    char *new_frag = NULL;
+    char **parity = NULL;
+    fragment_metadata_t metadata;
+    struct ec_args other_args = *args;
+    int other_desc = -1;
+    char **other_data = NULL, **other_parity = NULL;
+
+    desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+
+    orig_data = create_buffer(orig_data_size, 'x');
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(rc == 0);
+
+    /* Overwrite a few bytes of one data fragment and encode that too */
+    rc = liberasurecode_get_fragment_metadata(encoded_data[data_idx], &metadata);
+    assert(rc == 0);
+    for (i = 0; i < 100; i++) {
+        orig_data[(data_idx * metadata.size) + 10 + i] = (char)i;
+    }
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &expected_data, &expected_parity, &encoded_fragment_len);
+    assert(rc == 0);
+
+    new_frag = malloc(encoded_fragment_len);
+    parity = malloc(sizeof(char *) * args->m);
+    assert(new_frag != NULL && parity != NULL);
+    /* Only the new payload is needed: the header is rewritten */
+    memcpy(new_frag, expected_data[data_idx], encoded_fragment_len);
+    memset(new_frag, 0, sizeof(fragment_header_t));
+    for (i = 0; i < args->m; i++) {
+        parity[i] = malloc(encoded_fragment_len);
+        assert(parity[i] != NULL);
+        memcpy(parity[i], encoded_parity[i], encoded_fragment_len);
+    }
+
+    rc = liberasurecode_update_parity(desc, data_idx, encoded_data[data_idx],
+                                      new_frag, parity);
+    if (rc == -EBACKENDNOTSUPP) {
+        goto out;
+    }
+    assert(rc == 0);
+
+    /* The parity is what encoding the new data gives, checksums included */
+    for (i = 0; i < args->m; i++) {
+        assert(memcmp(parity[i], expected_parity[i], encoded_fragment_len) == 0);
+    }
+    assert(memcmp(new_frag, expected_data[data_idx], encoded_fragment_len) == 0);
+
+    rc = liberasurecode_update_parity(desc, args->k, encoded_data[data_idx],
+                                      new_frag, parity);
+    assert(rc == -EINVALIDPARAMS);
+    rc = liberasurecode_update_parity(desc, data_idx, encoded_data[data_idx],
+                                      new_frag, NULL);
+    assert(rc == -EINVALIDPARAMS);
+    if (args->k > 1) {
+        rc = liberasurecode_update_parity(desc, data_idx, encoded_data[0],
+                                          new_frag, parity);
+        assert(rc == -EINVALIDPARAMS);
+    }
+
+    /* Parity written with another checksum type is rejected, not re-stamped */
+    other_args.ct = CHKSUM_NONE;
+    other_desc = liberasurecode_instance_create(be_id, &other_args);
+    assert(other_desc > 0);
+    rc = liberasurecode_encode(other_desc, orig_data, orig_data_size,
+            &other_data, &other_parity, &encoded_fragment_len);
+    assert(rc == 0);
+    rc = liberasurecode_update_parity(desc, data_idx, encoded_data[data_idx],
+                                      new_frag, other_parity);
+    assert(rc == -EINVALIDPARAMS);
+    liberasurecode_encode_cleanup(other_desc, other_data, other_parity);
+    liberasurecode_instance_destroy(other_desc);
+
+out:
+    for (i = 0; i < args->m; i++) {
+        free(parity[i]);
+    }
+    free(parity);
+    free(new_frag);
+    free(orig_data);
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_encode_cleanup(desc, expected_data, expected_parity);
+    liberasurecode_instance_destroy(desc);
+}
+
+static void test_fragments_needed(const ec_backend_id_t be_id,
+                                  struct ec_args *args)
+{
+    test_fragments_needed_impl(be_id, args);
+}
+
+static void test_verify_stripe_metadata(const ec_backend_id_t be_id,
+                                        struct ec_args *args)
+{
+    int orig_data_size = 1024;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char **avail_frags = NULL;
+    uint64_t encoded_fragment_len = 0;
+    int rc = -1;
+    int num_avail_frags = -1;
+    int *skip = create_skips_array(args,-1);
+    char *orig_data = create_buffer(orig_data_size, 'x');
+    int desc = liberasurecode_instance_create(be_id, args);
+
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        free(orig_data);
+        free(skip);
+        return;
+    }
+    assert(desc > 0);
+
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+
+    num_avail_frags = create_frags_array(&avail_frags, encoded_data,
+            encoded_parity, args, skip);
+
+    rc = liberasurecode_verify_stripe_metadata(desc, avail_frags,
+            num_avail_frags);
+    assert(0 == rc);
+
+    liberasurecode_encode_cleanup(desc, encoded_data, encoded_parity);
+    liberasurecode_instance_destroy(desc);
+    free(orig_data);
+    free(skip);
+    free(avail_frags);
+}
+
+static void verify_fragment_metadata_mismatch_impl(const ec_backend_id_t be_id, struct ec_args *args,
+        fragment_mismatch_scenario_t scenario)
+{
+    int orig_data_size = 1024;
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    char **avail_frags = NULL;
+    uint64_t encoded_fragment_len = 0;
+    int rc = -1;
+    int num_avail_frags = -1;
+    int i = 0;
+    uint32_t orig_libec_ver = 0;
+    uint32_t orig_be_ver = 0;
+    uint8_t orig_be_id = 0;
+    uint32_t orig_frag_idx = 0;
+    int *skip = create_skips_array(args,-1);
+    char *orig_data = create_buffer(orig_data_size, 'x');
+    int desc = liberasurecode_instance_create(be_id, args);
+
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        free(orig_data);
+        free(skip);
+        return;
+    }
+    assert(desc > 0);
+    assert(orig_data != NULL);
+    rc = liberasurecode_encode(desc, orig_data, orig_data_size,
+            &encoded_data, &encoded_parity, &encoded_fragment_len);
+    assert(0 == rc);
+    num_avail_frags = create_frags_array(&avail_frags, encoded_data,
+            encoded_parity, args, skip);
+    for (i = 0; i < num_avail_frags; i++) {
         char * cur_frag = avail_frags[i];
         // corrupt fragment
         switch (scenario) {
@@ -2236,6 +4152,51 @@ static void test_verify_stripe_metadata_frag_idx_invalid(
     verify_fragment_metadata_mismatch_impl(be_id, args, FRAGIDX_AT_BOUNDARY);
 }
 
+/* Byte-at-a-time liberasurecode_crc32_alt(), as first shipped */
+static int reference_crc32_alt(int crc, const void *buf, size_t size)
+{
+    static int tab[256];
+    const char *p = buf;
+    int i, j;
+
+    for (i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (j = 0; j < 8; j++)
+            c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+        tab[i] = c;
+    }
+
+    crc = crc ^ ~0U;
+    while (size--)
+        crc = tab[(crc ^ *p++) & 0xFF]
+            ^ ((((crc >> 8) & 0x00FFFFFF) ^ 0x00800000) - 0x00800000);
+    return crc ^ ~0U;
+}
+
+static void test_crc32_implementations(void)
+{
+    int len = 64 * 1024;
+    unsigned char *buf = malloc(len + 64);
+    int i;
+
+    assert(buf != NULL);
+    srand(4242);
+    for (i = 0; i < len + 64; i++)
+        buf[i] = rand();
+
+    // every alignment and tail length, and some long runs
+    for (i = 0; i < 2000; i++) {
+        int off = i % 64;
+        int n = i < 1000 ? i % 300 : rand() % len;
+        int seed = rand();
+        assert((uint32_t) liberasurecode_crc32(seed, buf + off, n) ==
+               (uint32_t) crc32(seed, buf + off, n));
+        assert(liberasurecode_crc32_alt(seed, buf + off, n) ==
+               reference_crc32_alt(seed, buf + off, n));
+    }
+    free(buf);
+}
+
 static void test_metadata_crcs_le(void)
 {
     // We've observed headers like this in the wild, using our busted crc32
@@ -2430,16 +4391,41 @@ static void test_isa_l_rs_lrc_combine_local_frags(void)
     TEST({.with_args = test_create_and_destroy_backend},               backend, CHKSUM_NONE), \
     TEST({.with_args = test_create_and_destroy_multiple_backends},     backend, CHKSUM_NONE), \
     TEST({.with_args = test_simple_encode_decode},                     backend, CHKSUM_NONE), \
+    TEST({.with_args = test_encode_into},                              backend, CHKSUM_CRC32), \
+    TEST({.with_args = test_encode_slab},                              backend, CHKSUM_CRC32), \
+    TEST({.with_args = test_encode_worker_threads},                    backend, CHKSUM_CRC32), \
+    TEST({.with_args = test_encode_checksums},                         backend, CHKSUM_CRC32), \
+    TEST({.with_args = test_encode_iov},                               backend, CHKSUM_CRC32), \
+    TEST({.with_args = test_encode_batch},                             backend, CHKSUM_CRC32), \
+    TEST({.with_args = test_stream_encoder},                           backend, CHKSUM_CRC32), \
+    TEST({.with_args = test_stream_decoder},                           backend, CHKSUM_CRC32), \
+    TEST({.with_args = test_decode_into},                              backend, CHKSUM_CRC32), \
+    TEST({.with_args = test_decode_iov},                               backend, CHKSUM_NONE), \
+    TEST({.with_args = test_get_object_crc32},                         backend, CHKSUM_CRC32), \
+    TEST({.with_args = test_decode_table_cache},                       backend, CHKSUM_NONE), \
+    TEST({.with_args = test_buffer_pool},                              backend, CHKSUM_CRC32), \
     TEST({.with_args = test_decode_with_missing_data},                 backend, CHKSUM_NONE), \
     TEST({.with_args = test_decode_with_missing_parity},               backend, CHKSUM_NONE), \
     TEST({.with_args = test_decode_with_missing_multi_data},           backend, CHKSUM_NONE), \
     TEST({.with_args = test_decode_with_missing_multi_parity},         backend, CHKSUM_NONE), \
     TEST({.with_args = test_decode_with_missing_multi_data_parity},    backend, CHKSUM_NONE), \
     TEST({.with_args = test_simple_reconstruct},                       backend, CHKSUM_NONE), \
+    TEST({.with_args = test_reconstruct_parity_from_data},             backend, CHKSUM_NONE), \
+    TEST({.with_args = test_reconstruct_fragments},                    backend, CHKSUM_NONE), \
+    TEST({.with_args = test_reconstruct_fragment_batch},               backend, CHKSUM_NONE), \
+    TEST({.with_args = test_update_parity},                            backend, CHKSUM_CRC32), \
     TEST({.with_args = test_fragments_needed},                         backend, CHKSUM_NONE), \
     TEST({.with_args = test_get_fragment_metadata},                    backend, CHKSUM_NONE), \
     TEST({.with_args = test_get_fragment_metadata},                    backend, CHKSUM_CRC32), \
     TEST({.with_args = test_write_legacy_fragment_metadata},           backend, CHKSUM_CRC32), \
+    TEST({.with_args = test_get_fragment_metadata},                    backend, CHKSUM_CRC32C), \
+    TEST({.with_args = test_get_fragment_metadata},                    backend, CHKSUM_XXH64), \
+    TEST({.with_args = test_get_fragment_metadata},                    backend, CHKSUM_MD5), \
+    TEST({.with_args = test_fragment_checksum_mismatch},               backend, CHKSUM_CRC32), \
+    TEST({.with_args = test_fragment_checksum_mismatch},               backend, CHKSUM_CRC32C), \
+    TEST({.with_args = test_fragment_checksum_mismatch},               backend, CHKSUM_XXH64), \
+    TEST({.with_args = test_fragment_checksum_mismatch},               backend, CHKSUM_MD5), \
+    TEST({.with_args = test_md5_fragment_without_digest},              backend, CHKSUM_MD5), \
     TEST({.with_args = test_verify_stripe_metadata},                   backend, CHKSUM_CRC32), \
     TEST({.with_args = test_verify_stripe_metadata_libec_mismatch},    backend, CHKSUM_CRC32), \
     TEST({.with_args = test_verify_stripe_metadata_magic_mismatch},    backend, CHKSUM_CRC32), \
@@ -2454,6 +4440,8 @@ struct testcase testcases[] = {
     TEST({.no_args = test_destroy_backend_invalid_args}, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST({.no_args = test_encode_invalid_args}, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST({.no_args = test_encode_cleanup_invalid_args}, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
+    TEST({.no_args = test_encode_into_invalid_args}, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
+    TEST({.no_args = test_instance_set_option_invalid_args}, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST({.no_args = test_decode_invalid_args}, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST({.no_args = test_reconstruct_corrupt_payload_size}, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST({.no_args = test_decode_cleanup_invalid_args}, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
@@ -2465,10 +4453,13 @@ struct testcase testcases[] = {
     TEST({.no_args = test_liberasurecode_get_version}, EC_BACKENDS_MAX, CHKSUM_TYPES_MAX),
     TEST({.no_args = test_metadata_crcs_le}, EC_BACKENDS_MAX, 0),
     TEST({.no_args = test_metadata_crcs_be}, EC_BACKENDS_MAX, 0),
+    TEST({.no_args = test_crc32_implementations}, EC_BACKENDS_MAX, 0),
+    TEST({.no_args = test_checksum_known_values}, EC_BACKENDS_MAX, 0),
     TEST({.no_args = test_verify_fragment_metadata_idx_bounds}, EC_BACKENDS_MAX, 0),
     // NULL backend test
     TEST({.with_args = test_create_and_destroy_backend}, EC_BACKEND_NULL, CHKSUM_NONE),
     TEST({.with_args = test_simple_encode_decode}, EC_BACKEND_NULL, CHKSUM_NONE),
+    TEST({.with_args = test_encode_into}, EC_BACKEND_NULL, CHKSUM_CRC32),
     TEST({.with_args = test_get_fragment_metadata}, EC_BACKEND_NULL, CHKSUM_NONE),
     TEST({.with_args = test_decode_with_missing_parity}, EC_BACKEND_NULL, CHKSUM_NONE),
     TEST({.with_args = test_decode_with_missing_multi_parity}, EC_BACKEND_NULL, CHKSUM_NONE),
@@ -531,6 +531,93 @@ static void test_multi_thread_get_fragment_size_and_destroy_backend(
     free(rc2);
 }
 
+struct churn_state {
+    ec_backend_id_t be_id;
+    struct ec_args *args;
+    int desc;
+    int data_sz;
+    char *data;
+    int stop;
+};
+
+void* encode_loop_in_thread(void* arg)
+{
+    struct churn_state *s = arg;
+    int *rc = malloc(sizeof(int));
+    char **encoded_data = NULL, **encoded_parity = NULL;
+    uint64_t encoded_fragment_len = 0;
+    *rc = 0;
+    while (!__atomic_load_n(&s->stop, __ATOMIC_ACQUIRE) && *rc == 0) {
+        *rc = liberasurecode_encode(s->desc, s->data, s->data_sz,
+                &encoded_data, &encoded_parity, &encoded_fragment_len);
+        if (*rc == 0) {
+            *rc = liberasurecode_encode_cleanup(s->desc, encoded_data, encoded_parity);
+        }
+    }
+    return rc;
+}
+
+void* create_destroy_loop_in_thread(void* arg)
+{
+    struct churn_state *s = arg;
+    int *rc = malloc(sizeof(int));
+    int i;
+    *rc = 0;
+    for (i = 0; i < 50 && *rc == 0; i++) {
+        int desc = liberasurecode_instance_create(s->be_id, s->args);
+        if (desc <= 0) {
+            *rc = desc;
+            break;
+        }
+        *rc = liberasurecode_instance_destroy(desc);
+        /* A retired descriptor must not resolve again */
+        if (*rc == 0 && liberasurecode_instance_destroy(desc) != -EBACKENDNOTAVAIL) {
+            *rc = -1;
+        }
+    }
+    __atomic_store_n(&s->stop, 1, __ATOMIC_RELEASE);
+    return rc;
+}
+
+static void test_multi_thread_encode_while_creating_and_destroying(
+        ec_backend_id_t be_id,
+        struct ec_args *args)
+{
+    pthread_t encoders[4], churner;
+    int *rc;
+    int i;
+    int desc = liberasurecode_instance_create(be_id, args);
+    if (-EBACKENDNOTAVAIL == desc) {
+        fprintf(stderr, "Backend library not available!\n");
+        return;
+    }
+    assert(desc > 0);
+    struct churn_state s = {
+        be_id,
+        args,
+        desc,
+        64 * 1024,
+        create_buffer(64 * 1024),
+        0
+    };
+    assert(s.data != NULL);
+    for (i = 0; i < 4; i++) {
+        pthread_create(&encoders[i], NULL, encode_loop_in_thread, &s);
+    }
+    pthread_create(&churner, NULL, create_destroy_loop_in_thread, &s);
+    pthread_join(churner, (void *) &rc);
+    assert(*rc == 0);
+    free(rc);
+    for (i = 0; i < 4; i++) {
+        pthread_join(encoders[i], (void *) &rc);
+        /* Other instances coming and going never disturb this one */
+        assert(*rc == 0);
+        free(rc);
+    }
+    assert(liberasurecode_instance_destroy(desc) == 0);
+    free(s.data);
+}
+
 #define TEST(test, backend) {#test, test, backend}
 #define TEST_SUITE(backend) \
     TEST(test_multi_thread_destroy_backend,                       backend), \
@@ -539,7 +626,8 @@ static void test_multi_thread_get_fragment_size_and_destroy_backend(
     TEST(test_multi_thread_decode_and_destroy_backend,            backend), \
     TEST(test_multi_thread_reconstruct_and_destroy_backend,       backend), \
     TEST(test_multi_thread_fragments_needed_and_destroy_backend,  backend), \
-    TEST(test_multi_thread_get_fragment_size_and_destroy_backend, backend)
+    TEST(test_multi_thread_get_fragment_size_and_destroy_backend, backend), \
+    TEST(test_multi_thread_encode_while_creating_and_destroying,  backend)
 
 struct testcase testcases[] = {
     TEST_SUITE(EC_BACKEND_FLAT_XOR_HD),